@@ -1,26 +1,399 @@
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <vector>
 
 #include "cpumodel.h"
 #include "dump.h"
 #include "json.hpp"
+#include "load.h"
+#include "misc.h"
 #include "openga_helper.h"
+#include "recorder.h"
+#include "rescore.h"
 #include "sim.hpp"
+#include "trace_export.h"
 #include "workload.h"
 
 template <typename T>
 void DoOpt(Soc &soc, const Workload &work, const Workload &idle) {
-    auto nsga3_opt = OpengaAdapter<T>(&soc, &work, &idle, "./conf.json");
-    auto ret       = nsga3_opt.Optimize();
-    auto dumper    = Dumper<T>(soc, "./output/");
+    OpengaAdapter<T> nsga3_opt(&soc, &work, &idle, "./conf.json");
+    auto ret    = nsga3_opt.Optimize();
+    auto dumper = Dumper<T>(soc, "./output/");
     dumper.DumpToTXT(ret);
     dumper.DumpToCSV(ret);
     dumper.DumpToShellScript(ret);
     dumper.DumpToUperfJson(ret);
 }
 
-int main() {
+// 读取已有的参数文件，不运行优化只做一次仿真和评分
+template <typename T>
+void DoEval(Soc &soc, const Workload &work, const Workload &idle, const std::vector<std::string> &param_files) {
+    using namespace std;
+    auto loader = Loader<T>(soc);
+
+    vector<string>               names;
+    vector<typename T::Tunables> todo;
+    for (const auto &file : param_files) {
+        for (const auto &nt : loader.LoadFromFile(file)) {
+            names.push_back(file + ":" + nt.name);
+            todo.push_back(nt.tunable);
+        }
+    }
+
+    OpengaAdapter<T> evaluator(&soc, &work, &idle, "./conf.json");
+    auto ret = evaluator.Evaluate(todo);
+
+    const auto app_names = evaluator.GetAppNames();
+
+    cout << "\nTarget: " << soc.name_ << endl;
+    for (size_t i = 0; i < ret.size(); ++i) {
+        const auto &s = ret[i].score;
+        cout << names[i] << endl;
+        cout << "    performance: " << Double2Pct(s.performance);
+        cout << " battery_life: " << Double2Pct(s.battery_life);
+        cout << " idle_lasting: " << Double2Pct(s.idle_lasting);
+        cout << " feasible: " << (ret[i].feasible ? "yes" : "no") << endl;
+        // 按应用评估时列出每个应用的卡顿和续航，卡顿相对于默认参数的加权卡顿
+        for (size_t k = 0; k < ret[i].per_app.size(); ++k) {
+            const auto &a = ret[i].per_app[k];
+            cout << "        " << app_names[k] << " performance: " << Double2Pct(a.performance);
+            cout << " battery_life: " << Double2Pct(a.battery_life) << endl;
+        }
+    }
+}
+
+// 读取参数文件中的一组参数，@param可以用file:name选择其中的一组参数，默认第一组
+template <typename T>
+typename Loader<T>::NamedTunables LoadNamedTunables(const Soc &soc, const std::string &param) {
+    using namespace std;
+    string       file = param;
+    string       name;
+    const size_t pos = param.rfind(':');
+    if (pos != string::npos) {
+        file = param.substr(0, pos);
+        name = param.substr(pos + 1);
+    }
+
+    const auto list = Loader<T>(soc).LoadFromFile(file);
+    auto       it   = list.begin();
+    while (!name.empty() && it != list.end() && it->name != name)
+        ++it;
+    if (it == list.end()) {
+        cout << "Parameters not found: " << param << endl;
+        throw runtime_error("parameters not found");
+    }
+    return *it;
+}
+
+// 用参数文件中的一组参数仿真一次，把每个时间片的状态写入记录文件
+template <typename T>
+void DoTrace(Soc &soc, const Workload &work, const Workload &idle, const SimMiscConst &misc, const std::string &param,
+             const std::string &trace_file) {
+    using namespace std;
+    const auto nt = LoadNamedTunables<T>(soc, param);
+
+    // 与优化使用相同的参数类型，只是换成写入文件的记录策略
+    using Traced = Sim<typename T::Governor, typename T::Sched, typename T::Boost, TraceRecorder>;
+    TraceWriter   writer(trace_file, soc);
+    Traced        sim(nt.tunable, misc, TraceRecorder(&writer));
+    SimResultPack rp;
+    sim.Run(work, idle, soc, &rp);
+    cout << param << " -> " << trace_file << ", " << writer.GetRecordNum() << " records" << endl;
+}
+
+// 展开sweep.params的实验设计，每个点是各个参数的取值，grid为所有取值的组合，lhs为拉丁超立方抽样
+std::vector<std::vector<int>> ExpandSweepDesign(const nlohmann::json &cfg, std::vector<std::string> *names) {
+    using namespace std;
+    vector<int> mins, maxs, steps;
+    for (auto it = cfg["params"].begin(); it != cfg["params"].end(); ++it) {
+        names->push_back(it.key());
+        mins.push_back(it.value()["min"]);
+        maxs.push_back(it.value()["max"]);
+        steps.push_back(it.value().count("step") ? max(1, it.value()["step"].get<int>()) : 1);
+    }
+
+    const int           n_dim  = names->size();
+    const string        design = cfg["design"];
+    vector<vector<int>> points;
+    if (design == "grid") {
+        vector<int> p(mins);
+        for (bool done = (n_dim == 0); !done;) {
+            points.push_back(p);
+            done = true;
+            for (int i = 0; i < n_dim && done; ++i) {
+                p[i] += steps[i];
+                if (p[i] <= maxs[i])
+                    done = false;
+                else
+                    p[i] = mins[i];
+            }
+        }
+    } else if (design == "lhs") {
+        // 每一维分成samples层，每层恰好抽一个点，取值取整到step
+        const int                         n = cfg["samples"];
+        mt19937                           rng(cfg["seed"].get<int>());
+        uniform_real_distribution<double> dist(0.0, 1.0);
+        points.assign(n, vector<int>(n_dim));
+        for (int i = 0; i < n_dim; ++i) {
+            vector<int> strata(n);
+            for (int k = 0; k < n; ++k)
+                strata[k] = k;
+            shuffle(strata.begin(), strata.end(), rng);
+            for (int k = 0; k < n; ++k) {
+                const double v = mins[i] + (strata[k] + dist(rng)) / n * (maxs[i] - mins[i]);
+                points[k][i]   = min(maxs[i], mins[i] + (int)round((v - mins[i]) / steps[i]) * steps[i]);
+            }
+        }
+    } else {
+        cout << "Unknown sweep design: " << design << endl;
+        throw runtime_error("unknown sweep design");
+    }
+    return points;
+}
+
+// 以参数文件中的一组参数为基准，只改变sweep.params中的参数，评估所有点，结果按完成顺序写入CSV
+template <typename T>
+void DoSweep(Soc &soc, const Workload &work, const Workload &idle, const nlohmann::json &cfg,
+             const std::string &param) {
+    using namespace std;
+    const auto nt = LoadNamedTunables<T>(soc, param);
+
+    vector<string>               names;
+    const auto                   points = ExpandSweepDesign(cfg, &names);
+    OpengaAdapter<T>             evaluator(&soc, &work, &idle, "./conf.json");
+    vector<typename T::Tunables> todo(points.size(), nt.tunable);
+    vector<char>                 clamped(points.size());
+    int                          n_clamped = 0;
+    for (size_t k = 0; k < points.size(); ++k) {
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (!evaluator.SetTunableByName(&todo[k], names[i], points[k][i])) {
+                cout << "Unknown sweep parameter: " << names[i] << endl;
+                throw runtime_error("unknown sweep parameter");
+            }
+        }
+        // 与优化时一样修正参数，仿真的取值与CSV中的点不同时标记出来
+        clamped[k] = evaluator.ConstrainTunables(&todo[k]);
+        n_clamped += clamped[k];
+    }
+
+    const string out_file = "./output/" + soc.name_ + "_sweep.csv";
+    ofstream     ofs(out_file);
+    if (!ofs.good()) {
+        cout << "Sweep output file access ERROR: " << out_file << endl;
+        throw runtime_error("file access error");
+    }
+    ofs << "point";
+    for (const auto &name : names)
+        ofs << ',' << name;
+    ofs << ",performance,battery_life,idle_lasting,feasible,clamped" << endl;
+
+    cout << "\nTarget: " << soc.name_ << endl;
+    cout << "Sweeping " << points.size() << " points around " << param << endl;
+    if (n_clamped > 0)
+        cout << n_clamped << " points violate parameter constraints and are simulated with clamped values" << endl;
+
+    mutex out_mutex;
+    int   n_done = 0;
+    evaluator.EvaluateEach(todo, [&](int idx, const typename OpengaAdapter<T>::Result &r) {
+        lock_guard<mutex> lock(out_mutex);
+        ofs << idx;
+        for (const auto v : points[idx])
+            ofs << ',' << v;
+        ofs << ',' << Double2Pct(r.score.performance) << ',' << Double2Pct(r.score.battery_life) << ','
+            << Double2Pct(r.score.idle_lasting) << ',' << (r.feasible ? 1 : 0) << ',' << (clamped[idx] ? 1 : 0)
+            << endl;
+        if (++n_done % 100 == 0)
+            cout << n_done << "/" << points.size() << " points done" << endl;
+    });
+    cout << "Sweep results written to " << out_file << endl;
+}
+
+// 筛选对评分影响小的参数，输出固定这些参数的parameterRange覆盖项，已经固定的参数保留
+template <typename T>
+void DoScreen(Soc &soc, const Workload &work, const Workload &idle, const nlohmann::json &param_range) {
+    using namespace std;
+    OpengaAdapter<T> screener(&soc, &work, &idle, "./conf.json");
+    const auto       effects = screener.Screen();
+
+    nlohmann::json pinned = param_range.count("pinned") ? param_range["pinned"] : nlohmann::json::object();
+    nlohmann::json table  = nlohmann::json::array();
+    cout << "\nTarget: " << soc.name_ << endl;
+    cout << "influence  mu*(performance, battery_life, idle_lasting)  parameter" << endl;
+    for (const auto &e : effects) {
+        cout << (e.insensitive ? "  " : "* ") << e.influence << "  (" << e.mu_star[0] << ", " << e.mu_star[1] << ", "
+             << e.mu_star[2] << ")  " << e.name << endl;
+        if (e.insensitive)
+            pinned[e.name] = e.pin_value;
+        table.push_back({{"name", e.name},
+                         {"influence", e.influence},
+                         {"mu_star", {e.mu_star[0], e.mu_star[1], e.mu_star[2]}},
+                         {"sigma", {e.sigma[0], e.sigma[1], e.sigma[2]}},
+                         {"pinned", e.insensitive}});
+    }
+
+    nlohmann::json out;
+    out["parameterRange"]["pinned"] = pinned;
+    out["effects"]                  = table;
+
+    const string out_file = "./output/" + soc.name_ + "_screen.json";
+    ofstream     ofs(out_file);
+    ofs << out.dump(4) << endl;
+    cout << "Pinned overlay written to " << out_file << ", merge parameterRange.pinned into ./conf.json" << endl;
+}
+
+// 作为评估农场的工作进程，SOC模型和负载常驻内存，直到协调者断开
+template <typename T>
+void DoWorker(Soc &soc, const Workload &work, const Workload &idle, const std::string &host, int port) {
+    OpengaAdapter<T> worker(&soc, &work, &idle, "./conf.json");
+    worker.ServeFarm(host, port);
+}
+
+struct OptTask {
+    const Workload &work;
+    const Workload &idle;
+
+    template <typename T>
+    void Run(Soc &soc) const {
+        DoOpt<T>(soc, work, idle);
+    }
+};
+
+struct EvalTask {
+    const Workload &                work;
+    const Workload &                idle;
+    const std::vector<std::string> &param_files;
+
+    template <typename T>
+    void Run(Soc &soc) const {
+        DoEval<T>(soc, work, idle, param_files);
+    }
+};
+
+struct ScreenTask {
+    const Workload &      work;
+    const Workload &      idle;
+    const nlohmann::json &param_range;
+
+    template <typename T>
+    void Run(Soc &soc) const {
+        DoScreen<T>(soc, work, idle, param_range);
+    }
+};
+
+struct SweepTask {
+    const Workload &      work;
+    const Workload &      idle;
+    const nlohmann::json &cfg;
+    const std::string &   param;
+
+    template <typename T>
+    void Run(Soc &soc) const {
+        DoSweep<T>(soc, work, idle, cfg, param);
+    }
+};
+
+struct WorkerTask {
+    const Workload &   work;
+    const Workload &   idle;
+    const std::string &host;
+    const int          port;
+
+    template <typename T>
+    void Run(Soc &soc) const {
+        DoWorker<T>(soc, work, idle, host, port);
+    }
+};
+
+struct TraceTask {
+    const Workload &   work;
+    const Workload &   idle;
+    const SimMiscConst misc;
+    const std::string &param;
+    const std::string &trace_file;
+
+    template <typename T>
+    void Run(Soc &soc) const {
+        DoTrace<T>(soc, work, idle, misc, param, trace_file);
+    }
+};
+
+// 根据调度器类型和是否使用uperf选择仿真类型，@task需要提供成员函数模板Run<SimType>(Soc &)
+template <typename Task>
+void DispatchSim(Soc &soc, bool use_uperf, const Task &task) {
+    if (use_uperf) {
+        if (soc.GetSchedType() == Soc::kWalt) {
+            task.template Run<SimQcomUp>(soc);
+        }
+        if (soc.GetSchedType() == Soc::kPelt) {
+            task.template Run<SimUp>(soc);
+        }
+    } else {
+        if (soc.GetSchedType() == Soc::kWalt) {
+            task.template Run<SimQcomBL>(soc);
+        }
+        if (soc.GetSchedType() == Soc::kPelt) {
+            task.template Run<SimBL>(soc);
+        }
+    }
+}
+
+// scenario不为空时按scenarios中的应用列表和权重组合亮屏负载，否则读取合并负载
+Workload LoadOnscreenWorkload(const nlohmann::json &j) {
+    const std::string name = j.count("scenario") ? j["scenario"] : "";
+    if (name.empty())
+        return Workload(j["mergedWorkload"]);
+
+    if (!j["scenarios"].count(name)) {
+        using namespace std;
+        cout << "Scenario not found: " << name << endl;
+        throw runtime_error("scenario not found");
+    }
+
+    // 同一个应用在列表中出现多次时共享同一份负载数据
+    std::map<std::string, std::shared_ptr<const Workload>> loaded;
+    std::vector<std::shared_ptr<const Workload>>           parts;
+    std::vector<double>                                    weights;
+    for (const auto &app : j["scenarios"][name]) {
+        const std::string file   = app["file"];
+        const double      weight = app["weight"];
+        if (weight <= 0.0)
+            continue;
+        if (!loaded.count(file))
+            loaded[file] = std::make_shared<const Workload>(file);
+        parts.push_back(loaded[file]);
+        weights.push_back(weight);
+    }
+    return Workload(parts, weights);
+}
+
+void PrintUsage(void) {
+    using namespace std;
+    cout << "Usage:" << endl;
+    cout << "  wipe                                      optimize all todoModels in ./conf.json" << endl;
+    cout << "  wipe evaluate <soc_model> <param_file>... score existing parameters without optimizing" << endl;
+    cout << "                                            param_file: output/<soc>.json or output/<soc>/powercfg.sh"
+         << endl;
+    cout << "  wipe screen <soc_model>                   rank parameters by influence and pin insensitive ones" << endl;
+    cout << "  wipe sweep <soc_model> <param_file[:name]>" << endl;
+    cout << "                                            score the sweep design around one parameter set" << endl;
+    cout << "  wipe trace <soc_model> <param_file[:name]> <trace_file>" << endl;
+    cout << "                                            record per-quantum state of one parameter set" << endl;
+    cout << "  wipe trace-export <trace_file> <out_file> convert a trace to .csv or Perfetto-compatible .json" << endl;
+    cout << "  wipe rescore <soc_model> [simlog_file]    rescore saved simulation logs under rescore.grid settings"
+         << endl;
+    cout << "                                            simlog_file: output/<soc>_simlog.bin by default" << endl;
+    cout << "  wipe worker <soc_model> [host:port]       evaluate batches for a farm coordinator until it disconnects"
+         << endl;
+    cout << "                                            host:port: gaParameter.farm by default" << endl;
+}
+
+int main(int argc, char *argv[]) {
     nlohmann::json j;
     {
         std::ifstream ifs("./conf.json");
@@ -34,30 +407,138 @@ int main() {
     }
 
     auto todo_models = j["todoModels"];
-    auto workload    = j["mergedWorkload"];
     auto idleload    = j["idleWorkload"];
     auto use_uperf   = j["useUperf"];
 
-    Workload work(workload);
+    std::string action = (argc > 1) ? argv[1] : "optimize";
+
+    if (action == "evaluate") {
+        if (argc < 4) {
+            PrintUsage();
+            return 1;
+        }
+        Workload work = LoadOnscreenWorkload(j);
+        Workload idle(idleload);
+        Soc      soc(argv[2]);
+
+        std::vector<std::string> param_files(argv + 3, argv + argc);
+        DispatchSim(soc, use_uperf, EvalTask{work, idle, param_files});
+        return 0;
+    }
+
+    if (action == "screen") {
+        if (argc < 3) {
+            PrintUsage();
+            return 1;
+        }
+        Workload work = LoadOnscreenWorkload(j);
+        Workload idle(idleload);
+        Soc      soc(argv[2]);
+        DispatchSim(soc, use_uperf, ScreenTask{work, idle, j["parameterRange"]});
+        return 0;
+    }
+
+    if (action == "sweep") {
+        if (argc < 4) {
+            PrintUsage();
+            return 1;
+        }
+        Workload work = LoadOnscreenWorkload(j);
+        Workload idle(idleload);
+        Soc      soc(argv[2]);
+
+        const std::string param = argv[3];
+        DispatchSim(soc, use_uperf, SweepTask{work, idle, j["sweep"], param});
+        return 0;
+    }
+
+    if (action == "trace") {
+        if (argc < 5) {
+            PrintUsage();
+            return 1;
+        }
+        Workload     work = LoadOnscreenWorkload(j);
+        Workload     idle(idleload);
+        Soc          soc(argv[2]);
+        SimMiscConst misc;
+        misc.working_base_mw = j["miscSettings"]["sim.power.workingBase_mw"];
+        misc.idle_base_mw    = j["miscSettings"]["sim.power.idleBase_mw"];
+
+        const std::string param      = argv[3];
+        const std::string trace_file = argv[4];
+        DispatchSim(soc, use_uperf, TraceTask{work, idle, misc, param, trace_file});
+        return 0;
+    }
+
+    if (action == "trace-export") {
+        if (argc < 4) {
+            PrintUsage();
+            return 1;
+        }
+        const std::string out_file = argv[3];
+        if (out_file.size() > 5 && out_file.substr(out_file.size() - 5) == ".json")
+            ExportTraceToPerfetto(argv[2], out_file);
+        else
+            ExportTraceToCSV(argv[2], out_file);
+        return 0;
+    }
+
+    if (action == "rescore") {
+        if (argc < 3) {
+            PrintUsage();
+            return 1;
+        }
+        Workload          work = LoadOnscreenWorkload(j);
+        Workload          idle(idleload);
+        Soc               soc(argv[2]);
+        const std::string log_file = (argc > 3) ? argv[3] : "./output/" + soc.name_ + "_simlog.bin";
+
+        // 日志与当前的SOC模型、负载和仿真设置不一致时评分没有意义
+        const SimLog log = LoadSimLog(log_file);
+        if (log.context != SimLogContext(soc, work, idle, j)) {
+            using namespace std;
+            cout << "Simlog does not match the current model, workload or sim settings: " << log_file << endl;
+            return 1;
+        }
+        const nlohmann::json grid = j.count("rescore") ? j["rescore"]["grid"] : nlohmann::json::object();
+        Rescore(soc, work, log, j["miscSettings"], grid, "./output/" + soc.name_ + "_rescore.csv");
+        return 0;
+    }
+
+    if (action == "worker") {
+        if (argc < 3) {
+            PrintUsage();
+            return 1;
+        }
+        Workload work = LoadOnscreenWorkload(j);
+        Workload idle(idleload);
+        Soc      soc(argv[2]);
+
+        const auto &farm = j["gaParameter"]["farm"];
+        std::string host = farm["host"];
+        int         port = farm["port"];
+        if (argc > 3) {
+            const std::string addr = argv[3];
+            const size_t      pos  = addr.rfind(':');
+            host                   = addr.substr(0, pos);
+            if (pos != std::string::npos)
+                port = std::stoi(addr.substr(pos + 1));
+        }
+        DispatchSim(soc, use_uperf, WorkerTask{work, idle, host, port});
+        return 0;
+    }
+
+    if (action != "optimize") {
+        PrintUsage();
+        return 1;
+    }
+
+    Workload work = LoadOnscreenWorkload(j);
     Workload idle(idleload);
 
     for (const auto &model : todo_models) {
         Soc soc(model);
-        if (use_uperf) {
-            if (soc.GetSchedType() == Soc::kWalt) {
-                DoOpt<SimQcomUp>(soc, work, idle);
-            }
-            if (soc.GetSchedType() == Soc::kPelt) {
-                DoOpt<SimUp>(soc, work, idle);
-            }
-        } else {
-            if (soc.GetSchedType() == Soc::kWalt) {
-                DoOpt<SimQcomBL>(soc, work, idle);
-            }
-            if (soc.GetSchedType() == Soc::kPelt) {
-                DoOpt<SimBL>(soc, work, idle);
-            }
-        }
+        DispatchSim(soc, use_uperf, OptTask{work, idle});
     }
 
     return 0;
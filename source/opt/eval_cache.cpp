@@ -0,0 +1,158 @@
+#include "eval_cache.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#include "alloc_guard.h"
+
+const uint32_t kRecordMagic   = 0x57495045;  // "WIPE"
+const uint64_t kKeySeed       = 0xcbf29ce484222325ULL;
+const uint64_t kKeyCheckSeed  = 0x84222325cbf29ce4ULL;
+const uint64_t kRecordChkSeed = 0x9e3779b97f4a7c15ULL;
+
+uint64_t HashFile(const std::string &path, uint64_t seed) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs.good()) {
+        using namespace std;
+        cout << "EvalCache file access ERROR: " << path << endl;
+        throw runtime_error("file access error");
+    }
+    std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    return HashBytes(content.data(), content.size(), seed);
+}
+
+EvalCache::EvalCache(const std::string &cache_file, uint64_t context)
+    : cache_file_(cache_file), fd_(-1), context_(context), synced_size_(0) {
+    fd_ = open(cache_file.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        using namespace std;
+        cout << "EvalCache open failed, caching disabled: " << cache_file << endl;
+        return;
+    }
+    SyncFromFile();
+}
+
+void EvalCache::Reopen(void) {
+    if (fd_ < 0)
+        return;
+    close(fd_);
+    fd_ = open(cache_file_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+EvalCache::~EvalCache() {
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+uint64_t EvalCache::RecordCheck(const Record &r) {
+    return HashBytes(&r, offsetof(Record, check), kRecordChkSeed);
+}
+
+void EvalCache::SyncFromFile(void) {
+    struct stat st;
+    if (fstat(fd_, &st) != 0)
+        return;
+
+    const size_t file_size = st.st_size / sizeof(Record) * sizeof(Record);
+    if (file_size <= synced_size_)
+        return;
+
+    // mmap的起始偏移需要按页对齐
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t map_start = synced_size_ / page_size * page_size;
+    const size_t map_len   = file_size - map_start;
+
+    flock(fd_, LOCK_SH);
+    void *addr = mmap(nullptr, map_len, PROT_READ, MAP_SHARED, fd_, map_start);
+    if (addr != MAP_FAILED) {
+        const char *base = static_cast<const char *>(addr) + (synced_size_ - map_start);
+        const int   n    = (file_size - synced_size_) / sizeof(Record);
+        // 索引随缓存记录增长，这是缓存本身的存储，不计入评估的堆分配检查
+        AllocAllowedScope allow_index;
+        for (int i = 0; i < n; ++i) {
+            const Record *r = reinterpret_cast<const Record *>(base) + i;
+            if (r->magic != kRecordMagic || r->context != context_ || r->check != RecordCheck(*r))
+                continue;
+            Slot slot;
+            slot.key_check      = r->key_check;
+            slot.entry.c1       = r->c1;
+            slot.entry.c2       = r->c2;
+            slot.entry.c3       = r->c3;
+            slot.entry.feasible = r->feasible;
+            index_[r->key]      = slot;
+        }
+        munmap(addr, map_len);
+        synced_size_ = file_size;
+    }
+    flock(fd_, LOCK_UN);
+}
+
+bool EvalCache::Lookup(const std::vector<int> &key, Entry *entry) {
+    if (fd_ < 0)
+        return false;
+
+    const size_t   len       = key.size() * sizeof(int);
+    const uint64_t h         = HashBytes(key.data(), len, kKeySeed);
+    const uint64_t key_check = HashBytes(key.data(), len, kKeyCheckSeed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto                        it = index_.find(h);
+    if (it == index_.end()) {
+        // 其他进程可能已经评估过
+        SyncFromFile();
+        it = index_.find(h);
+    }
+    if (it == index_.end() || it->second.key_check != key_check)
+        return false;
+    *entry = it->second.entry;
+    return true;
+}
+
+void EvalCache::Insert(const std::vector<int> &key, const Entry &entry) {
+    if (fd_ < 0)
+        return;
+
+    const size_t len = key.size() * sizeof(int);
+
+    Record r;
+    r.magic     = kRecordMagic;
+    r.feasible  = entry.feasible;
+    r.context   = context_;
+    r.key       = HashBytes(key.data(), len, kKeySeed);
+    r.key_check = HashBytes(key.data(), len, kKeyCheckSeed);
+    r.c1        = entry.c1;
+    r.c2        = entry.c2;
+    r.c3        = entry.c3;
+    r.check     = RecordCheck(r);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    flock(fd_, LOCK_EX);
+    // 之前的写入被中断会留下不完整的记录，截断后再追加保证记录对齐
+    struct stat st;
+    if (fstat(fd_, &st) == 0 && st.st_size % sizeof(Record) != 0) {
+        if (ftruncate(fd_, st.st_size / sizeof(Record) * sizeof(Record)) != 0) {
+            flock(fd_, LOCK_UN);
+            return;
+        }
+    }
+    if (write(fd_, &r, sizeof(r)) != sizeof(r)) {
+        using namespace std;
+        cout << "EvalCache write failed" << endl;
+    }
+    flock(fd_, LOCK_UN);
+
+    Slot slot;
+    slot.key_check = r.key_check;
+    slot.entry     = entry;
+    AllocAllowedScope allow_index;
+    index_[r.key] = slot;
+}
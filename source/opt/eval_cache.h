@@ -0,0 +1,67 @@
+#ifndef __EVAL_CACHE_H
+#define __EVAL_CACHE_H
+
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hash.h"
+
+uint64_t HashFile(const std::string &path, uint64_t seed = kFnvOffset);
+
+// 持久化的评估结果缓存，只追加写入，读取时使用mmap
+// 同一主机上多个wipe进程可以共享同一个缓存文件，进程间使用flock互斥，进程内使用mutex互斥
+class EvalCache {
+public:
+    typedef struct _Entry {
+        double c1;
+        double c2;
+        double c3;
+        bool   feasible;
+    } Entry;
+
+    EvalCache() = delete;
+    // @context为仿真环境的哈希，不同SOC、负载和设置的记录在同一个文件中互不干扰
+    EvalCache(const std::string &cache_file, uint64_t context);
+    ~EvalCache();
+
+    bool Lookup(const std::vector<int> &key, Entry *entry);
+    void Insert(const std::vector<int> &key, const Entry &entry);
+    // fork之后在子进程中重新打开，flock按打开的文件区分，共享同一个描述符的进程之间不互斥
+    void Reopen(void);
+
+private:
+    // 固定64字节的记录，check为前面所有字段的哈希，用于跳过写入中断产生的损坏记录
+    typedef struct _Record {
+        uint32_t magic;
+        uint32_t feasible;
+        uint64_t context;
+        uint64_t key;
+        uint64_t key_check;
+        double   c1;
+        double   c2;
+        double   c3;
+        uint64_t check;
+    } Record;
+
+    typedef struct _Slot {
+        uint64_t key_check;
+        Entry    entry;
+    } Slot;
+
+    static uint64_t RecordCheck(const Record &r);
+    // 读入文件中尚未索引的记录，包括其他进程追加的
+    void SyncFromFile(void);
+
+    std::string                        cache_file_;
+    int                                fd_;
+    uint64_t                           context_;
+    size_t                             synced_size_;
+    std::mutex                         mutex_;
+    std::unordered_map<uint64_t, Slot> index_;
+};
+
+#endif
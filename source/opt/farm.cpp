@@ -0,0 +1,504 @@
+#include "farm.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+const uint32_t kFarmMagic      = 0x4d524657;  // "WFRM"
+const uint32_t kFarmHello      = 1;
+const uint32_t kFarmBatch      = 2;
+const uint32_t kFarmResult     = 3;
+const size_t   kFarmMaxPayload = 64 * 1024 * 1024;
+const size_t   kFarmCostLen    = 3 * sizeof(double) + sizeof(uint32_t);
+const int      kConnectRetry   = 60;   // 工作进程等待协调者开始监听的秒数
+const int      kEvalPollMs     = 100;  // 提交者检查工作进程数的间隔
+
+// 定长头部后面跟着payload_len字节的负载，握手为上下文，批次为n_items * item_len个int32，结果为n_items个评分
+typedef struct _FarmMsgHeader {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t batch_id;
+    uint32_t n_items;
+    uint32_t item_len;
+    uint32_t payload_len;
+} FarmMsgHeader;
+
+static std::vector<char> EncodeMsg(uint32_t type, uint32_t batch_id, uint32_t n_items, uint32_t item_len,
+                                   const std::vector<char> &payload) {
+    FarmMsgHeader h;
+    h.magic       = kFarmMagic;
+    h.type        = type;
+    h.batch_id    = batch_id;
+    h.n_items     = n_items;
+    h.item_len    = item_len;
+    h.payload_len = payload.size();
+
+    std::vector<char> msg(sizeof(h) + payload.size());
+    memcpy(msg.data(), &h, sizeof(h));
+    if (!payload.empty())
+        memcpy(msg.data() + sizeof(h), payload.data(), payload.size());
+    return msg;
+}
+
+static bool SendAll(int fd, const std::vector<char> &msg) {
+    size_t pos = 0;
+    while (pos < msg.size()) {
+        ssize_t ret = send(fd, msg.data() + pos, msg.size() - pos, MSG_NOSIGNAL);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        pos += ret;
+    }
+    return true;
+}
+
+static bool RecvAll(int fd, char *p, size_t len) {
+    size_t pos = 0;
+    while (pos < len) {
+        ssize_t ret = recv(fd, p + pos, len - pos, 0);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        pos += ret;
+    }
+    return true;
+}
+
+static bool IsValidHeader(const FarmMsgHeader &h) {
+    return h.magic == kFarmMagic && h.payload_len <= kFarmMaxPayload;
+}
+
+// 从缓冲区头部取出一条完整的消息，消息不完整或者格式错误时返回false，格式错误时置@bad
+static bool PopMsg(std::vector<char> *buf, FarmMsgHeader *h, std::vector<char> *payload, bool *bad) {
+    *bad = false;
+    if (buf->size() < sizeof(*h))
+        return false;
+    memcpy(h, buf->data(), sizeof(*h));
+    if (!IsValidHeader(*h)) {
+        *bad = true;
+        return false;
+    }
+    const size_t len = sizeof(*h) + h->payload_len;
+    if (buf->size() < len)
+        return false;
+    payload->assign(buf->begin() + sizeof(*h), buf->begin() + len);
+    buf->erase(buf->begin(), buf->begin() + len);
+    return true;
+}
+
+static void SetNoDelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+static addrinfo *Resolve(const std::string &host, int port, bool passive) {
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = passive ? AI_PASSIVE : 0;
+
+    addrinfo *res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) {
+        using namespace std;
+        cout << "Farm address resolve ERROR: " << host << ":" << port << endl;
+        throw runtime_error("address resolve error");
+    }
+    return res;
+}
+
+FarmCoordinator::FarmCoordinator(const FarmCfg &cfg, uint64_t context)
+    : cfg_(cfg),
+      context_(context),
+      listen_fd_(-1),
+      next_batch_id_(0),
+      pending_(std::max(1, cfg.queue_max)),
+      pending_head_(0),
+      pending_num_(0),
+      n_ready_(0),
+      no_worker_since_(Clock::now()),
+      stop_(false) {
+    addrinfo *res = Resolve(cfg_.host, cfg_.port, true);
+    for (addrinfo *ai = res; ai && listen_fd_ < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        // 依次优化多个SOC时每个SOC重新监听同一个端口
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 64) == 0) {
+            listen_fd_ = fd;
+            break;
+        }
+        close(fd);
+    }
+    freeaddrinfo(res);
+    if (listen_fd_ < 0) {
+        using namespace std;
+        cout << "Farm coordinator listen ERROR: " << cfg_.host << ":" << cfg_.port << endl;
+        throw runtime_error("socket listen error");
+    }
+
+    if (pipe2(wake_fds_, O_CLOEXEC | O_NONBLOCK) != 0) {
+        close(listen_fd_);
+        throw std::runtime_error("pipe error");
+    }
+
+    std::cout << "Farm coordinator listening on " << cfg_.host << ":" << cfg_.port << std::endl;
+    loop_thread_ = std::thread(&FarmCoordinator::Loop, this);
+}
+
+FarmCoordinator::~FarmCoordinator() {
+    stop_ = true;
+    Wake();
+    loop_thread_.join();
+
+    // 工作进程读到连接关闭后退出
+    for (const auto &c : conns_)
+        close(c.fd);
+    close(listen_fd_);
+    close(wake_fds_[0]);
+    close(wake_fds_[1]);
+}
+
+// 每个提交线程复用Job的存储空间，同样数量的参数组再次提交时没有堆分配
+void FarmCoordinator::Eval(const std::vector<std::vector<int>> &values, int n, std::vector<FarmCost> *costs) {
+    costs->assign(n, FarmCost{0.0, 0.0, 0.0, false, false});
+
+    static thread_local std::vector<Job> jobs;
+    jobs.resize(n);
+    int                          remaining = n;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (int i = 0; i < n; ++i) {
+        jobs[i] = {&values[i], &(*costs)[i], &remaining, 0};
+        while (!space_cv_.wait_for(lock, std::chrono::milliseconds(kEvalPollMs),
+                                   [this] { return (int)pending_num_ < cfg_.queue_max; }))
+            CheckWorkers(&remaining);
+        PushPending(&jobs[i], false);
+        Wake();
+    }
+    while (!done_cv_.wait_for(lock, std::chrono::milliseconds(kEvalPollMs), [&remaining] { return remaining == 0; }))
+        CheckWorkers(&remaining);
+}
+
+void FarmCoordinator::CheckWorkers(int *remaining) {
+    if (cfg_.no_worker_timeout_ms <= 0 || n_ready_ > 0 ||
+        Clock::now() - no_worker_since_ <= std::chrono::milliseconds(cfg_.no_worker_timeout_ms))
+        return;
+
+    // 没有工作进程时不会有在途的批次，本次调用的参数组都在等待队列中，原地压缩队列
+    size_t n_keep = 0;
+    for (size_t i = 0; i < pending_num_; ++i) {
+        Job *job = pending_[(pending_head_ + i) % pending_.size()];
+        if (job->remaining != remaining)
+            pending_[(pending_head_ + n_keep++) % pending_.size()] = job;
+    }
+    pending_num_ = n_keep;
+    space_cv_.notify_all();
+
+    using namespace std;
+    cout << "\nFarm has no worker for " << cfg_.no_worker_timeout_ms / 1000
+         << "s, start workers with wipe worker <soc_model> " << cfg_.host << ":" << cfg_.port << endl;
+    throw runtime_error("farm has no worker");
+}
+
+void FarmCoordinator::PushPending(Job *job, bool front) {
+    const size_t cap = pending_.size();
+    if (pending_num_ == cap) {
+        std::vector<Job *> grown(cap * 2);
+        for (size_t i = 0; i < pending_num_; ++i)
+            grown[i] = pending_[(pending_head_ + i) % cap];
+        pending_.swap(grown);
+        pending_head_ = 0;
+    }
+    if (front) {
+        pending_head_           = (pending_head_ + pending_.size() - 1) % pending_.size();
+        pending_[pending_head_] = job;
+    } else {
+        pending_[(pending_head_ + pending_num_) % pending_.size()] = job;
+    }
+    ++pending_num_;
+}
+
+FarmCoordinator::Job *FarmCoordinator::PopPending(void) {
+    Job *job      = pending_[pending_head_];
+    pending_head_ = (pending_head_ + 1) % pending_.size();
+    --pending_num_;
+    return job;
+}
+
+void FarmCoordinator::Wake(void) {
+    const char c = 0;
+    if (write(wake_fds_[1], &c, 1) < 0) {
+        // 管道已满时分发线程必然会被唤醒，可以忽略
+    }
+}
+
+void FarmCoordinator::Loop(void) {
+    std::vector<pollfd> pfds;
+    while (!stop_) {
+        pfds.clear();
+        pfds.push_back({listen_fd_, POLLIN, 0});
+        pfds.push_back({wake_fds_[0], POLLIN, 0});
+        for (const auto &c : conns_)
+            pfds.push_back({c.fd, POLLIN, 0});
+        if (poll(pfds.data(), pfds.size(), 100) < 0 && errno != EINTR)
+            break;
+
+        if (pfds[1].revents & POLLIN) {
+            char tmp[256];
+            while (read(wake_fds_[0], tmp, sizeof(tmp)) > 0) {
+            }
+        }
+
+        // 逆序遍历，断开的连接可以直接删除，新接受的连接不在本轮的pfds中
+        const auto now = Clock::now();
+        for (int i = (int)pfds.size() - 3; i >= 0; --i) {
+            bool ok = true;
+            if (pfds[i + 2].revents)
+                ok = Receive(&conns_[i]);
+            if (ok && TimedOut(conns_[i], now))
+                ok = false;
+            if (!ok)
+                Drop(i);
+        }
+
+        if (pfds[0].revents & POLLIN)
+            Accept();
+        Dispatch();
+    }
+}
+
+void FarmCoordinator::Accept(void) {
+    sockaddr_storage addr;
+    socklen_t        addr_len = sizeof(addr);
+    int              fd       = accept4(listen_fd_, (sockaddr *)&addr, &addr_len, SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+    SetNoDelay(fd);
+
+    char host[NI_MAXHOST], serv[NI_MAXSERV];
+    Conn c;
+    c.fd    = fd;
+    c.ready = false;
+    if (getnameinfo((sockaddr *)&addr, addr_len, host, sizeof(host), serv, sizeof(serv),
+                    NI_NUMERICHOST | NI_NUMERICSERV) == 0)
+        c.peer = std::string(host) + ":" + serv;
+    conns_.push_back(c);
+}
+
+bool FarmCoordinator::Receive(Conn *c) {
+    char    tmp[64 * 1024];
+    ssize_t len = recv(c->fd, tmp, sizeof(tmp), 0);
+    if (len <= 0)
+        return false;
+    c->rbuf.insert(c->rbuf.end(), tmp, tmp + len);
+
+    FarmMsgHeader     h;
+    std::vector<char> payload;
+    bool              bad;
+    while (PopMsg(&c->rbuf, &h, &payload, &bad)) {
+        if (h.type == kFarmHello) {
+            uint64_t ctx = 0;
+            if (c->ready || payload.size() != sizeof(ctx))
+                return false;
+            memcpy(&ctx, payload.data(), sizeof(ctx));
+            if (ctx != context_) {
+                std::cout << "\nFarm worker rejected, model, workload or settings mismatch: " << c->peer << std::endl;
+                return false;
+            }
+            c->ready = true;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++n_ready_;
+            }
+            std::cout << "\nFarm worker connected: " << c->peer << std::endl;
+            continue;
+        }
+
+        if (h.type != kFarmResult || !c->ready)
+            return false;
+        auto it = c->inflight.find(h.batch_id);
+        if (it == c->inflight.end() || h.n_items != it->second.jobs.size() ||
+            payload.size() != h.n_items * kFarmCostLen)
+            return false;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        const char *                p = payload.data();
+        for (auto job : it->second.jobs) {
+            uint32_t feasible;
+            memcpy(&job->cost->c1, p, sizeof(double));
+            memcpy(&job->cost->c2, p + sizeof(double), sizeof(double));
+            memcpy(&job->cost->c3, p + 2 * sizeof(double), sizeof(double));
+            memcpy(&feasible, p + 3 * sizeof(double), sizeof(feasible));
+            job->cost->feasible = feasible != 0;
+            p += kFarmCostLen;
+            --*job->remaining;
+        }
+        c->inflight.erase(it);
+        done_cv_.notify_all();
+    }
+    return !bad;
+}
+
+bool FarmCoordinator::TimedOut(const Conn &c, Clock::time_point now) const {
+    if (cfg_.batch_timeout_ms <= 0)
+        return false;
+    for (const auto &b : c.inflight) {
+        if (now - b.second.sent > std::chrono::milliseconds(cfg_.batch_timeout_ms)) {
+            std::cout << "\nFarm worker timed out: " << c.peer << std::endl;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FarmCoordinator::Drop(int idx) {
+    Conn &c = conns_[idx];
+    close(c.fd);
+
+    // 未完成的参数组放回队列头部，尽快重新发送
+    int n_requeue = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = c.inflight.rbegin(); it != c.inflight.rend(); ++it) {
+            for (auto job = it->second.jobs.rbegin(); job != it->second.jobs.rend(); ++job) {
+                if (++(*job)->n_retry > cfg_.retry_max) {
+                    (*job)->cost->failed = true;
+                    --*(*job)->remaining;
+                } else {
+                    PushPending(*job, true);
+                    ++n_requeue;
+                }
+            }
+        }
+        if (c.ready && --n_ready_ == 0)
+            no_worker_since_ = Clock::now();
+        done_cv_.notify_all();
+    }
+    if (c.ready)
+        std::cout << "\nFarm worker lost: " << c.peer << ", requeued " << n_requeue << " evaluations" << std::endl;
+    conns_.erase(conns_.begin() + idx);
+}
+
+// 轮流给每个空闲的工作进程发一批，直到队列为空或者所有工作进程的在途批数都达到上限
+void FarmCoordinator::Dispatch(void) {
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (int i = (int)conns_.size() - 1; i >= 0; --i) {
+            Conn &c = conns_[i];
+            if (!c.ready || (int)c.inflight.size() >= cfg_.max_inflight)
+                continue;
+
+            Batch b;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                while (pending_num_ > 0 && (int)b.jobs.size() < cfg_.batch_size)
+                    b.jobs.push_back(PopPending());
+            }
+            if (b.jobs.empty())
+                return;
+            space_cv_.notify_all();
+
+            const uint32_t    item_len = b.jobs[0]->values->size();
+            std::vector<char> payload(b.jobs.size() * item_len * sizeof(int32_t));
+            int32_t *         p = (int32_t *)payload.data();
+            for (const auto job : b.jobs) {
+                for (const auto v : *job->values)
+                    *p++ = v;
+            }
+            const uint32_t id = next_batch_id_++;
+            b.sent            = Clock::now();
+            c.inflight[id]    = b;
+            if (!SendAll(c.fd, EncodeMsg(kFarmBatch, id, b.jobs.size(), item_len, payload)))
+                Drop(i);
+            progress = true;
+        }
+    }
+}
+
+void RunFarmWorker(const std::string &host, int port, uint64_t context, const FarmEvalFunc &eval) {
+    using namespace std;
+
+    // 协调者可能还没有开始监听，每秒重试一次
+    int fd = -1;
+    for (int n_try = 0; fd < 0; ++n_try) {
+        addrinfo *res = Resolve(host, port, false);
+        for (addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(res);
+        if (fd < 0) {
+            if (n_try >= kConnectRetry) {
+                cout << "Farm worker connect ERROR: " << host << ":" << port << endl;
+                throw runtime_error("socket connect error");
+            }
+            sleep(1);
+        }
+    }
+    SetNoDelay(fd);
+
+    vector<char> hello(sizeof(context));
+    memcpy(hello.data(), &context, sizeof(context));
+    if (!SendAll(fd, EncodeMsg(kFarmHello, 0, 0, 0, hello))) {
+        close(fd);
+        throw runtime_error("socket send error");
+    }
+    cout << "Farm worker connected to " << host << ":" << port << endl;
+
+    int                 n_batch = 0;
+    int                 n_eval  = 0;
+    FarmMsgHeader       h;
+    vector<char>        payload;
+    vector<vector<int>> values;
+    vector<FarmCost>    costs;
+    while (RecvAll(fd, (char *)&h, sizeof(h)) && IsValidHeader(h) && h.type == kFarmBatch) {
+        payload.resize(h.payload_len);
+        if (!RecvAll(fd, payload.data(), payload.size()) ||
+            payload.size() != (size_t)h.n_items * h.item_len * sizeof(int32_t))
+            break;
+
+        const int32_t *p = (const int32_t *)payload.data();
+        values.assign(h.n_items, vector<int>(h.item_len));
+        for (auto &l : values) {
+            for (auto &v : l)
+                v = *p++;
+        }
+        costs.assign(h.n_items, FarmCost{0.0, 0.0, 0.0, false, false});
+        eval(values, &costs);
+
+        vector<char> result(h.n_items * kFarmCostLen);
+        char *       q = result.data();
+        for (const auto &c : costs) {
+            const uint32_t feasible = c.feasible;
+            memcpy(q, &c.c1, sizeof(double));
+            memcpy(q + sizeof(double), &c.c2, sizeof(double));
+            memcpy(q + 2 * sizeof(double), &c.c3, sizeof(double));
+            memcpy(q + 3 * sizeof(double), &feasible, sizeof(feasible));
+            q += kFarmCostLen;
+        }
+        if (!SendAll(fd, EncodeMsg(kFarmResult, h.batch_id, h.n_items, 0, result)))
+            break;
+        ++n_batch;
+        n_eval += h.n_items;
+    }
+    close(fd);
+    cout << "Farm worker finished, " << n_batch << " batches, " << n_eval << " evaluations" << endl;
+}
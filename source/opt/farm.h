@@ -0,0 +1,114 @@
+#ifndef __FARM_H
+#define __FARM_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 一组参数的评估结果，c1, c2, c3与OpengaAdapter::MiddleCost相同
+typedef struct _FarmCost {
+    double c1;
+    double c2;
+    double c3;
+    bool   feasible;
+    bool   failed;  // 重试次数用尽仍没有结果
+} FarmCost;
+
+using FarmEvalFunc = std::function<void(const std::vector<std::vector<int>> &, std::vector<FarmCost> *)>;
+
+typedef struct _FarmCfg {
+    std::string host;
+    int         port;
+    int         batch_size;            // 每批至多的参数组数
+    int         max_inflight;          // 每个工作进程同时在途的批数
+    int         queue_max;             // 等待发送的参数组数上限
+    int         retry_max;             // 每组参数因工作进程断开而重新发送的次数上限
+    int         batch_timeout_ms;      // 一批超过这个时间没有返回时断开该工作进程，0为不限制
+    int         no_worker_timeout_ms;  // 没有工作进程连接超过这个时间时评估失败，0为一直等待
+} FarmCfg;
+
+// 评估农场的协调者，把量化后的参数取值成批经TCP发给工作进程，工作进程常驻SOC模型和负载，只返回评分
+// 工作进程断开或者超时后它未完成的批次重新排队，等待发送的参数组数有上限，超过时提交者阻塞
+// 没有工作进程的时间超过no_worker_timeout_ms时提交者撤回自己的参数组并抛出异常，避免一直阻塞
+class FarmCoordinator {
+public:
+    FarmCoordinator() = delete;
+    // @context为仿真环境的哈希，与工作进程不一致时拒绝连接
+    FarmCoordinator(const FarmCfg &cfg, uint64_t context);
+    ~FarmCoordinator();
+
+    // 评估@values的前@n组参数，阻塞直到每组都有结果或者失败，可以在多个线程中同时调用
+    // 没有工作进程的时间超过no_worker_timeout_ms时抛出std::runtime_error
+    void Eval(const std::vector<std::vector<int>> &values, int n, std::vector<FarmCost> *costs);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    typedef struct _Job {
+        const std::vector<int> *values;
+        FarmCost *              cost;
+        int *                   remaining;  // 同一次Eval调用中还没有结果的参数组数
+        int                     n_retry;
+    } Job;
+
+    typedef struct _Batch {
+        std::vector<Job *> jobs;
+        Clock::time_point  sent;
+    } Batch;
+
+    typedef struct _Conn {
+        int                       fd;
+        bool                      ready;  // 已经收到上下文一致的握手
+        std::string               peer;
+        std::vector<char>         rbuf;
+        std::map<uint32_t, Batch> inflight;
+    } Conn;
+
+    // 以下只在分发线程中调用
+    void Loop(void);
+    void Accept(void);
+    bool Receive(Conn *c);
+    bool TimedOut(const Conn &c, Clock::time_point now) const;
+    void Drop(int idx);
+    void Dispatch(void);
+    void Wake(void);
+    // 等待发送的队列，调用时持有mutex_
+    void PushPending(Job *job, bool front);
+    Job *PopPending(void);
+    // 调用时持有mutex_，没有工作进程超时时撤回@remaining所属的参数组并抛出异常
+    void CheckWorkers(int *remaining);
+
+    FarmCfg  cfg_;
+    uint64_t context_;
+    int      listen_fd_;
+    int      wake_fds_[2];  // 提交者唤醒分发线程
+
+    std::vector<Conn> conns_;
+    uint32_t          next_batch_id_;
+
+    std::mutex              mutex_;  // 保护pending_和Job的结果
+    std::condition_variable space_cv_;
+    std::condition_variable done_cv_;
+    // 环形队列，容量预留queue_max，提交者入队时不会分配，只有重新排队超过容量时由分发线程扩容
+    std::vector<Job *> pending_;
+    size_t             pending_head_;
+    size_t             pending_num_;
+    int                n_ready_;          // 已握手的工作进程数
+    Clock::time_point  no_worker_since_;  // n_ready_变为0的时刻
+
+    std::atomic<bool> stop_;
+    std::thread       loop_thread_;
+};
+
+// 连接协调者，逐批调用@eval评估收到的参数取值，直到协调者断开
+void RunFarmWorker(const std::string &host, int port, uint64_t context, const FarmEvalFunc &eval);
+
+#endif
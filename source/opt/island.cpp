@@ -0,0 +1,88 @@
+#include "island.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+// 单个迁移个体约1KB，最终前沿逐个发送，64KB足够
+const int kMaxMessageLen = 64 * 1024;
+
+IslandChannel::IslandChannel(const std::string &socket_dir, int n_islands) : island_(0), owner_pid_(getpid()) {
+    for (int i = 0; i < n_islands; ++i) {
+        const std::string path =
+            socket_dir + "/wipe-" + std::to_string(owner_pid_) + "-" + std::to_string(i) + ".sock";
+
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            using namespace std;
+            cout << "Island socket path too long: " << path << endl;
+            throw runtime_error("socket path too long");
+        }
+        strcpy(addr.sun_path, path.c_str());
+
+        unlink(path.c_str());
+        int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+            using namespace std;
+            cout << "Island socket bind ERROR: " << path << endl;
+            throw runtime_error("socket bind error");
+        }
+        paths_.push_back(path);
+        fds_.push_back(fd);
+    }
+}
+
+IslandChannel::~IslandChannel() {
+    for (int fd : fds_) {
+        if (fd >= 0)
+            close(fd);
+    }
+    // 只由创建者清理套接字文件
+    if (getpid() == owner_pid_) {
+        for (const auto &path : paths_)
+            unlink(path.c_str());
+    }
+}
+
+void IslandChannel::Attach(int island) {
+    island_ = island;
+    for (size_t i = 0; i < fds_.size(); ++i) {
+        if ((int)i != island && fds_[i] >= 0) {
+            close(fds_[i]);
+            fds_[i] = -1;
+        }
+    }
+}
+
+bool IslandChannel::Send(int to, const std::vector<char> &msg, bool block) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, paths_[to].c_str());
+
+    const int flags = block ? 0 : MSG_DONTWAIT;
+    ssize_t   ret   = sendto(fds_[island_], msg.data(), msg.size(), flags, (sockaddr *)&addr, sizeof(addr));
+    return ret == (ssize_t)msg.size();
+}
+
+bool IslandChannel::Recv(std::vector<char> *msg, int timeout_ms) {
+    pollfd pfd;
+    pfd.fd     = fds_[island_];
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, timeout_ms) <= 0)
+        return false;
+
+    msg->resize(kMaxMessageLen);
+    ssize_t len = recv(fds_[island_], msg->data(), msg->size(), 0);
+    if (len <= 0)
+        return false;
+    msg->resize(len);
+    return true;
+}
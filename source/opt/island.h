@@ -0,0 +1,32 @@
+#ifndef __ISLAND_H
+#define __ISLAND_H
+
+#include <string>
+#include <vector>
+
+// 岛屿之间的本机通道，每个岛屿绑定一个Unix数据报套接字
+// 在fork之前创建全部套接字，保证任何岛屿发送时接收方都已经就绪
+class IslandChannel {
+public:
+    IslandChannel() = delete;
+    IslandChannel(const std::string &socket_dir, int n_islands);
+    ~IslandChannel();
+
+    // fork之后在各个进程中调用，只保留本岛屿的套接字
+    void Attach(int island);
+    // @block为false时接收方队列已满则丢弃，迁移是尽力而为的
+    bool Send(int to, const std::vector<char> &msg, bool block);
+    // 等待至多@timeout_ms毫秒，没有消息时返回false
+    bool Recv(std::vector<char> *msg, int timeout_ms);
+
+    int GetIsland(void) const { return island_; }
+    int GetIslandNum(void) const { return paths_.size(); }
+
+private:
+    std::vector<std::string> paths_;
+    std::vector<int>         fds_;
+    int                      island_;
+    int                      owner_pid_;
+};
+
+#endif
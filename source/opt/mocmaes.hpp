@@ -0,0 +1,312 @@
+#ifndef __MOCMAES_HPP
+#define __MOCMAES_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "optimizer.h"
+
+// (mu+mu)-MO-CMA-ES，每个个体带有自己的步长和协方差，在[0,1]^dim中搜索
+// 每一代每个父代产生一个后代，整批并行评估，按非支配排序和超体积贡献选出下一代
+// C. Igel, N. Hansen, S. Roth, Covariance Matrix Adaptation for Multi-objective Optimization, 2007
+// 协方差使用平方根因子及其逆的秩1更新，不需要每代做分解
+// T. Suttorp, N. Hansen, C. Igel, Efficient covariance matrix update for variable metric evolution strategies, 2009
+typedef struct _MoCmaesCfg {
+    double sigma;  // 初始步长，相对于[0,1]的搜索范围
+    int    mu;     // 父代数量，每个个体带有dim*dim的协方差因子，与openGA的种群大小分开设置
+} MoCmaesCfg;
+
+template <typename CostT>
+class MoCmaes {
+public:
+    using Cfg        = MoCmaesCfg;
+    using Individual = OptIndividual<CostT>;
+
+    MoCmaes(const OptProblem<CostT> &problem, const Cfg &cfg)
+        : problem_(problem), cfg_(cfg), dim_(problem.dim), rng_(problem.random_seed), uniform_(0.0, 1.0) {
+        const double n = dim_;
+        d_             = 1.0 + n / 2.0;
+        p_target_      = 1.0 / (5.0 + std::sqrt(0.5));
+        c_p_           = p_target_ / (2.0 + p_target_);
+        c_c_           = 2.0 / (n + 2.0);
+        c_cov_         = 2.0 / (n * n + 6.0);
+        p_thresh_      = 0.44;
+    }
+
+    // 返回最终的非支配解
+    std::vector<Individual> Solve(const Objectives &hv_ref) {
+        hv_ref_ = hv_ref;
+        InitPopulation();
+
+        const int mu = cfg_.mu;
+        for (int gen = 0; gen < problem_.generation_max; ++gen) {
+            // 先顺序采样整批后代，随机数的使用顺序固定，后代被选中前只有位置，不复制协方差
+            std::vector<Member> offspring(mu);
+            for (int k = 0; k < mu; ++k) {
+                const Member &parent = pop_[k];
+                Member &      child  = offspring[k];
+                child.x.resize(dim_);
+
+                std::vector<double> z(dim_);
+                for (auto &v : z)
+                    v = normal_(rng_);
+                for (int i = 0; i < dim_; ++i) {
+                    double sum = 0.0;
+                    for (int j = 0; j < dim_; ++j)
+                        sum += parent.a[i * dim_ + j] * z[j];
+                    // 超出范围的分量截断到边界
+                    child.x[i] = std::min(std::max(parent.x[i] + parent.sigma * sum, 0.0), 1.0);
+                }
+                child.ind.genes = problem_.from_unit(child.x);
+            }
+
+            std::vector<char> feasible = EvalBatch(&offspring);
+
+            // 父代和可行的后代一起参与选择，前mu个为父代，只按下标选择，不复制个体
+            std::vector<Objectives> objs;
+            std::vector<int>        parent_of;
+            for (int k = 0; k < mu; ++k)
+                objs.push_back(pop_[k].ind.objectives);
+            for (int k = 0; k < mu; ++k) {
+                if (feasible[k]) {
+                    objs.push_back(offspring[k].ind.objectives);
+                    parent_of.push_back(k);
+                }
+            }
+            std::vector<bool> selected = Select(objs, mu);
+
+            // 后代被选中即为成功，据此更新父代和后代的步长，选中的后代继承父代的步长和协方差后再更新
+            for (size_t m = 0; m < parent_of.size(); ++m) {
+                const int  k       = parent_of[m];
+                const bool success = selected[mu + m];
+                Member &   parent  = pop_[k];
+                if (success) {
+                    Member &child = offspring[k];
+                    child.sigma   = parent.sigma;
+                    child.p_succ  = parent.p_succ;
+                    child.pc      = parent.pc;
+                    child.a       = parent.a;
+                    child.a_inv   = parent.a_inv;
+
+                    std::vector<double> step(dim_);
+                    for (int i = 0; i < dim_; ++i)
+                        step[i] = (child.x[i] - parent.x[i]) / parent.sigma;
+                    UpdateStepSize(&child, true);
+                    UpdateCovariance(&child, step);
+                }
+                UpdateStepSize(&parent, success);
+            }
+            // 不可行的后代视为失败
+            for (int k = 0; k < mu; ++k) {
+                if (!feasible[k])
+                    UpdateStepSize(&pop_[k], false);
+            }
+
+            std::vector<Member> next;
+            for (int k = 0; k < mu; ++k) {
+                if (selected[k])
+                    next.push_back(std::move(pop_[k]));
+            }
+            for (size_t m = 0; m < parent_of.size(); ++m) {
+                if (selected[mu + m])
+                    next.push_back(std::move(offspring[parent_of[m]]));
+            }
+            pop_.swap(next);
+
+            if (problem_.report) {
+                std::vector<Objectives> front;
+                for (const auto &m : pop_)
+                    front.push_back(m.ind.objectives);
+                auto fronts = NonDominatedSort(front);
+                std::vector<Objectives> nd;
+                for (int i : fronts[0])
+                    nd.push_back(front[i]);
+                problem_.report(gen, nd);
+            }
+        }
+
+        std::vector<Individual> ret;
+        for (const auto &m : pop_)
+            ret.push_back(m.ind);
+        return ReduceToFront(ret, ret.size(), hv_ref);
+    }
+
+private:
+    typedef struct _Member {
+        Individual          ind;
+        std::vector<double> x;       // [0,1]^dim中的位置
+        double              sigma;   // 步长
+        double              p_succ;  // 平滑的成功率
+        std::vector<double> pc;      // 进化路径
+        std::vector<double> a;       // 协方差的平方根因子，C = A A^T，秩1更新后不再是三角矩阵
+        std::vector<double> a_inv;   // A的逆
+    } Member;
+
+    void InitPopulation(void) {
+        const int mu = cfg_.mu;
+        pop_.assign(mu, Member());
+
+        // 与openGA一致，不可行的初始个体重新生成直到可行
+        std::vector<int> pending;
+        for (int i = 0; i < mu; ++i)
+            pending.push_back(i);
+        while (!pending.empty()) {
+            std::vector<Member> batch(pending.size());
+            for (auto &m : batch) {
+                problem_.init(m.ind.genes, rnd01_);
+                m.x = problem_.to_unit(m.ind.genes);
+            }
+            std::vector<char> feasible = EvalBatch(&batch);
+
+            std::vector<int> retry;
+            for (size_t k = 0; k < pending.size(); ++k) {
+                if (feasible[k])
+                    pop_[pending[k]] = batch[k];
+                else
+                    retry.push_back(pending[k]);
+            }
+            pending.swap(retry);
+        }
+
+        for (auto &m : pop_) {
+            m.sigma  = cfg_.sigma;
+            m.p_succ = p_target_;
+            m.pc.assign(dim_, 0.0);
+            m.a.assign(dim_ * dim_, 0.0);
+            m.a_inv.assign(dim_ * dim_, 0.0);
+            for (int i = 0; i < dim_; ++i) {
+                m.a[i * dim_ + i]     = 1.0;
+                m.a_inv[i * dim_ + i] = 1.0;
+            }
+        }
+    }
+
+    std::vector<char> EvalBatch(std::vector<Member> *batch) {
+        std::vector<const ParamSeq *> genes;
+        for (const auto &m : *batch)
+            genes.push_back(&m.ind.genes);
+        std::vector<CostT> costs(batch->size());
+        std::vector<char>  feasible = problem_.eval_batch(genes, &costs);
+        for (size_t k = 0; k < batch->size(); ++k) {
+            auto &ind      = (*batch)[k].ind;
+            ind.cost       = costs[k];
+            ind.objectives = problem_.objectives(ind.cost);
+        }
+        return feasible;
+    }
+
+    // 按非支配层级依次选入，最后一层按超体积贡献逐个剔除
+    std::vector<bool> Select(const std::vector<Objectives> &objs, int mu) const {
+        std::vector<bool> selected(objs.size(), false);
+        int               n_selected = 0;
+        for (const auto &front : NonDominatedSort(objs)) {
+            if (n_selected >= mu)
+                break;
+            if (n_selected + (int)front.size() <= mu) {
+                for (int i : front)
+                    selected[i] = true;
+                n_selected += front.size();
+                continue;
+            }
+
+            std::vector<int> last = front;
+            while (n_selected + (int)last.size() > mu) {
+                std::vector<Objectives> pts;
+                for (int i : last)
+                    pts.push_back(objs[i]);
+                auto contrib = HypervolumeContrib2D(pts, hv_ref_);
+                last.erase(last.begin() + (std::min_element(contrib.begin(), contrib.end()) - contrib.begin()));
+            }
+            for (int i : last)
+                selected[i] = true;
+            break;
+        }
+        return selected;
+    }
+
+    void UpdateStepSize(Member *m, bool success) const {
+        m->p_succ = (1.0 - c_p_) * m->p_succ + c_p_ * (success ? 1.0 : 0.0);
+        m->sigma *= std::exp((m->p_succ - p_target_) / (d_ * (1.0 - p_target_)));
+        // 步长在搜索范围内才有意义
+        m->sigma = std::min(std::max(m->sigma, 1e-6), 1.0);
+    }
+
+    // C' = alpha * C + beta * v v^T，对应地更新A和A^-1
+    void UpdateCovariance(Member *m, const std::vector<double> &step) const {
+        double alpha;
+        if (m->p_succ < p_thresh_) {
+            const double c = std::sqrt(c_c_ * (2.0 - c_c_));
+            for (int i = 0; i < dim_; ++i)
+                m->pc[i] = (1.0 - c_c_) * m->pc[i] + c * step[i];
+            alpha = 1.0 - c_cov_;
+        } else {
+            for (int i = 0; i < dim_; ++i)
+                m->pc[i] = (1.0 - c_c_) * m->pc[i];
+            alpha = 1.0 - c_cov_ + c_cov_ * c_c_ * (2.0 - c_c_);
+        }
+        const double beta = c_cov_;
+
+        const auto &        v = m->pc;
+        std::vector<double> w(dim_, 0.0);
+        double              w2 = 0.0;
+        for (int i = 0; i < dim_; ++i) {
+            double sum = 0.0;
+            for (int j = 0; j < dim_; ++j)
+                sum += m->a_inv[i * dim_ + j] * v[j];
+            w[i] = sum;
+            w2 += sum * sum;
+        }
+
+        const double sa = std::sqrt(alpha);
+        if (w2 < 1e-300) {
+            for (auto &e : m->a)
+                e *= sa;
+            for (auto &e : m->a_inv)
+                e /= sa;
+            return;
+        }
+
+        const double root = std::sqrt(1.0 + beta / alpha * w2);
+        const double ka   = sa / w2 * (root - 1.0);
+        const double kb   = 1.0 / (sa * w2) * (1.0 - 1.0 / root);
+
+        // w^T A^-1
+        std::vector<double> wa(dim_, 0.0);
+        for (int i = 0; i < dim_; ++i) {
+            for (int j = 0; j < dim_; ++j)
+                wa[j] += w[i] * m->a_inv[i * dim_ + j];
+        }
+
+        for (int i = 0; i < dim_; ++i) {
+            for (int j = 0; j < dim_; ++j) {
+                m->a[i * dim_ + j]     = sa * m->a[i * dim_ + j] + ka * v[i] * w[j];
+                m->a_inv[i * dim_ + j] = m->a_inv[i * dim_ + j] / sa - kb * w[i] * wa[j];
+            }
+        }
+    }
+
+    double Rnd01(void) { return uniform_(rng_); }
+
+    OptProblem<CostT> problem_;
+    Cfg               cfg_;
+    int               dim_;
+
+    double d_;
+    double p_target_;
+    double c_p_;
+    double c_c_;
+    double c_cov_;
+    double p_thresh_;
+
+    Objectives          hv_ref_;
+    std::vector<Member> pop_;
+
+    std::mt19937_64                        rng_;
+    std::uniform_real_distribution<double> uniform_;
+    std::normal_distribution<double>       normal_;
+    RandomFunc                             rnd01_ = [this]() { return Rnd01(); };
+};
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef __MOEAD_HPP
+#define __MOEAD_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "optimizer.h"
+
+// MOEA/D，把多目标问题按均匀的权重向量分解成population个Tchebycheff子问题
+// 每一代为每个子问题生成一个后代，整批并行评估后再按子问题顺序更新邻域，结果与线程数无关
+// Q. Zhang, H. Li, MOEA/D: A Multiobjective Evolutionary Algorithm Based on Decomposition, 2007
+typedef struct _MoeadCfg {
+    int    neighbour_size;  // 邻域大小，父代和替换都在邻域内进行
+    double neighbour_prob;  // 从邻域而不是整个种群选择父代的概率
+    int    replace_max;     // 每个后代最多替换的子问题数量，保持多样性
+} MoeadCfg;
+
+template <typename CostT>
+class Moead {
+public:
+    using Cfg        = MoeadCfg;
+    using Individual = OptIndividual<CostT>;
+
+    Moead(const OptProblem<CostT> &problem, const Cfg &cfg)
+        : problem_(problem), cfg_(cfg), rng_(problem.random_seed), uniform_(0.0, 1.0) {}
+
+    // 返回最终的非支配解
+    std::vector<Individual> Solve(const Objectives &hv_ref) {
+        InitWeights();
+        InitPopulation();
+
+        for (int gen = 0; gen < problem_.generation_max; ++gen) {
+            // 先顺序生成整批后代，随机数的使用顺序固定
+            const int               n = problem_.population;
+            std::vector<Individual> offspring(n);
+            std::vector<bool>       from_neighbour(n);
+            for (int i = 0; i < n; ++i) {
+                from_neighbour[i] = Rnd01() < cfg_.neighbour_prob;
+                const int a       = PickParent(i, from_neighbour[i]);
+                int       b       = PickParent(i, from_neighbour[i]);
+                for (int n_try = 0; b == a && n_try < 8; ++n_try)
+                    b = PickParent(i, from_neighbour[i]);
+
+                offspring[i].genes = problem_.crossover(pop_[a].genes, pop_[b].genes, rnd01_);
+                if (Rnd01() <= problem_.mutation_rate)
+                    offspring[i].genes = problem_.mutate(offspring[i].genes, rnd01_, 1.0);
+            }
+
+            std::vector<char> feasible = EvalBatch(&offspring);
+
+            for (int i = 0; i < n; ++i) {
+                if (!feasible[i])
+                    continue;
+                UpdateIdealNadir(offspring[i].objectives);
+                UpdateSubproblems(i, from_neighbour[i], offspring[i]);
+            }
+
+            if (problem_.report)
+                problem_.report(gen, FrontObjectives(pop_));
+        }
+
+        return ReduceToFront(pop_, pop_.size(), hv_ref);
+    }
+
+private:
+    double Rnd01(void) { return uniform_(rng_); }
+
+    void InitWeights(void) {
+        const int n = problem_.population;
+        weights_.resize(n);
+        for (int i = 0; i < n; ++i) {
+            const double w = (n > 1) ? (double)i / (n - 1) : 0.5;
+            // 权重为0的分量会让Tchebycheff退化，用很小的值代替
+            weights_[i] = {std::max(w, 1e-6), std::max(1.0 - w, 1e-6)};
+        }
+
+        // 二维权重按序排列，相邻的子问题就是最近的权重向量
+        const int t = std::min(cfg_.neighbour_size, n);
+        neighbours_.resize(n);
+        for (int i = 0; i < n; ++i) {
+            const int start = std::min(std::max(i - t / 2, 0), n - t);
+            neighbours_[i].clear();
+            for (int k = start; k < start + t; ++k)
+                neighbours_[i].push_back(k);
+        }
+    }
+
+    void InitPopulation(void) {
+        const int n = problem_.population;
+        pop_.assign(n, Individual());
+
+        // 与openGA一致，不可行的初始个体重新生成直到可行
+        std::vector<int> pending;
+        for (int i = 0; i < n; ++i)
+            pending.push_back(i);
+        while (!pending.empty()) {
+            std::vector<Individual> batch(pending.size());
+            for (auto &ind : batch)
+                problem_.init(ind.genes, rnd01_);
+            std::vector<char> feasible = EvalBatch(&batch);
+
+            std::vector<int> retry;
+            for (size_t k = 0; k < pending.size(); ++k) {
+                if (feasible[k])
+                    pop_[pending[k]] = batch[k];
+                else
+                    retry.push_back(pending[k]);
+            }
+            pending.swap(retry);
+        }
+
+        ideal_ = pop_[0].objectives;
+        nadir_ = pop_[0].objectives;
+        for (const auto &ind : pop_)
+            UpdateIdealNadir(ind.objectives);
+    }
+
+    std::vector<char> EvalBatch(std::vector<Individual> *batch) {
+        std::vector<const ParamSeq *> genes;
+        for (const auto &ind : *batch)
+            genes.push_back(&ind.genes);
+        std::vector<CostT> costs(batch->size());
+        std::vector<char>  feasible = problem_.eval_batch(genes, &costs);
+        for (size_t k = 0; k < batch->size(); ++k) {
+            auto &ind      = (*batch)[k];
+            ind.cost       = costs[k];
+            ind.objectives = problem_.objectives(ind.cost);
+        }
+        return feasible;
+    }
+
+    int PickParent(int i, bool from_neighbour) {
+        if (from_neighbour) {
+            const auto &nb = neighbours_[i];
+            return nb[std::min((int)(Rnd01() * nb.size()), (int)nb.size() - 1)];
+        }
+        return std::min((int)(Rnd01() * pop_.size()), (int)pop_.size() - 1);
+    }
+
+    void UpdateIdealNadir(const Objectives &obj) {
+        for (size_t k = 0; k < obj.size(); ++k) {
+            ideal_[k] = std::min(ideal_[k], obj[k]);
+            nadir_[k] = std::max(nadir_[k], obj[k]);
+        }
+    }
+
+    // 归一化的Tchebycheff距离，两个目标的量纲不同
+    double Tchebycheff(const Objectives &obj, int i) const {
+        double ret = 0.0;
+        for (size_t k = 0; k < obj.size(); ++k) {
+            const double span = std::max(nadir_[k] - ideal_[k], 1e-12);
+            ret               = std::max(ret, weights_[i][k] * (obj[k] - ideal_[k]) / span);
+        }
+        return ret;
+    }
+
+    void UpdateSubproblems(int i, bool from_neighbour, const Individual &child) {
+        std::vector<int> candidates;
+        if (from_neighbour) {
+            candidates = neighbours_[i];
+        } else {
+            for (size_t k = 0; k < pop_.size(); ++k)
+                candidates.push_back(k);
+        }
+        std::shuffle(candidates.begin(), candidates.end(), rng_);
+
+        int n_replaced = 0;
+        for (int k : candidates) {
+            if (n_replaced >= cfg_.replace_max)
+                break;
+            if (Tchebycheff(child.objectives, k) < Tchebycheff(pop_[k].objectives, k)) {
+                pop_[k] = child;
+                ++n_replaced;
+            }
+        }
+    }
+
+    static std::vector<Objectives> FrontObjectives(const std::vector<Individual> &pop) {
+        std::vector<Objectives> objs;
+        for (const auto &ind : pop)
+            objs.push_back(ind.objectives);
+        auto                    fronts = NonDominatedSort(objs);
+        std::vector<Objectives> front;
+        for (int i : fronts[0])
+            front.push_back(objs[i]);
+        return front;
+    }
+
+    OptProblem<CostT> problem_;
+    Cfg               cfg_;
+
+    std::mt19937_64                        rng_;
+    std::uniform_real_distribution<double> uniform_;
+    RandomFunc                             rnd01_ = [this]() { return Rnd01(); };
+
+    std::vector<Individual>       pop_;
+    std::vector<Objectives>       weights_;
+    std::vector<std::vector<int>> neighbours_;
+    Objectives                    ideal_;
+    Objectives                    nadir_;
+};
+
+#endif
@@ -1,16 +1,65 @@
 #include "openga_helper.h"
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstring>
 #include <fstream>
 #include <functional>
-
+#include <numeric>
+#include <random>
+#include <regex>
+#include <set>
+#include <thread>
+#include <typeinfo>
+
+#include "alloc_guard.h"
 #include "interactive.h"
 #include "json.hpp"
+#include "parallel.h"
+
+int GeneLevelNum(const ParamDescElement &desc) {
+    return desc.levels.empty() ? (desc.range_end - desc.range_start + 1) : desc.levels.size();
+}
+
+int GeneLevelValue(const ParamDescElement &desc, int idx) {
+    return desc.levels.empty() ? (desc.range_start + idx) : desc.levels[idx];
+}
+
+// 整数基因转换为比例，经过Quantify之后得到的值与该档位的取值一致
+double GeneLevelToRatio(const ParamDescElement &desc, int idx) {
+    const int span = desc.range_end - desc.range_start;
+    if (span == 0)
+        return 0.0;
+    return (double)(GeneLevelValue(desc, idx) - desc.range_start) / span;
+}
+
+// 本线程是否完整仿真过一次基因序列，之后评估基因序列只使用已分配的缓冲区
+static thread_local bool param_seq_warmed_up = false;
+
+// 岛屿之间的消息，同一主机上直接使用本机字节序
+const uint32_t kIslandMagic   = 0x49534c44;  // "ISLD"
+const int      kIslandMigrant = 1;
+const int      kIslandFront   = 2;
+const int      kIslandDone    = 3;
+
+typedef struct _IslandMsgHeader {
+    uint32_t magic;
+    int32_t  type;
+    int32_t  island;
+    int32_t  n_simulated;
+    int32_t  n_genes;
+    double   cost[3];
+} IslandMsgHeader;
 
 template <typename SimType>
 OpengaAdapter<SimType>::OpengaAdapter(Soc *soc, const Workload *workload, const Workload *idleload,
                                       const std::string &ga_cfg_file)
-    : soc_(soc), workload_(workload), idleload_(idleload) {
+    : soc_(soc), workload_(workload), idleload_(idleload), batch_warmed_n_(0), n_simulated_(0) {
     ParseCfgFile(ga_cfg_file);
     InitDefaultScore();
 };
@@ -37,6 +86,86 @@ void OpengaAdapter<SimType>::ParseCfgFile(const std::string &ga_cfg_file) {
     ga_cfg_.eta                = p["eta"];
     ga_cfg_.thread_num         = p["threadNum"];
     ga_cfg_.random_seed        = p["randomSeed"];
+    ga_cfg_.integer_genome     = p.count("genome") && p["genome"] == "integer";
+    ga_cfg_.local_search_rounds = 0;
+    if (p.count("localSearch") && p["localSearch"]["enable"]) {
+        ga_cfg_.local_search_rounds   = p["localSearch"]["rounds"];
+        ga_cfg_.local_search_max_eval = p["localSearch"]["maxEvaluations"];
+    }
+    ga_cfg_.backend      = p.count("backend") ? p["backend"].get<std::string>() : "nsga3";
+    ga_cfg_.progress_log = p.count("progressLog") && p["progressLog"];
+    if (ga_cfg_.backend == "moead") {
+        ga_cfg_.moead.neighbour_size = p["moead"]["neighbourSize"];
+        ga_cfg_.moead.neighbour_prob = p["moead"]["neighbourProb"];
+        ga_cfg_.moead.replace_max    = p["moead"]["replaceMax"];
+    } else if (ga_cfg_.backend == "mocmaes") {
+        ga_cfg_.mocmaes.sigma = p["mocmaes"]["sigma"];
+        ga_cfg_.mocmaes.mu    = p["mocmaes"].count("mu") ? p["mocmaes"]["mu"].get<int>() : 32;
+    } else if (ga_cfg_.backend != "nsga3") {
+        using namespace std;
+        cout << "GA config unknown backend: " << ga_cfg_.backend << endl;
+        throw std::runtime_error("unknown backend");
+    }
+    ga_cfg_.island_num = 1;
+    if (p.count("island") && p["island"]["enable"]) {
+        ga_cfg_.island_num        = p["island"]["count"];
+        ga_cfg_.island_interval   = p["island"]["interval"];
+        ga_cfg_.island_migrants   = p["island"]["migrants"];
+        ga_cfg_.island_socket_dir = p["island"]["socketDir"];
+        if (ga_cfg_.backend != "nsga3") {
+            std::cout << "Island mode only supports nsga3 backend, disabled" << std::endl;
+            ga_cfg_.island_num = 1;
+        }
+    }
+    ga_cfg_.batch_size = 1;
+    ga_cfg_.batch_tile = 0;
+    if (p.count("batchEval") && p["batchEval"]["enable"]) {
+        ga_cfg_.batch_size = std::max(1, p["batchEval"]["candidates"].get<int>());
+        ga_cfg_.batch_tile = std::max(1, p["batchEval"]["tileSlices"].get<int>());
+        // openGA在生成每个后代的重试循环里逐个评估，没有成组评估的入口
+        if (ga_cfg_.backend == "nsga3")
+            std::cout << "nsga3 backend evaluates offspring one at a time, batchEval only applies to local search"
+                      << std::endl;
+    }
+    ga_cfg_.adaptive.enable = false;
+    if (p.count("adaptive") && p["adaptive"]["enable"]) {
+        const auto &a                           = p["adaptive"];
+        ga_cfg_.adaptive.enable                 = true;
+        ga_cfg_.adaptive.mutation_rate_min      = a["mutationRate"]["min"];
+        ga_cfg_.adaptive.mutation_rate_max      = std::min(1.0f, a["mutationRate"]["max"].get<float>());
+        ga_cfg_.adaptive.eta_min                = a["eta"]["min"];
+        ga_cfg_.adaptive.eta_max                = a["eta"]["max"];
+        ga_cfg_.adaptive.crossover_fraction_min = a["crossoverFraction"]["min"];
+        ga_cfg_.adaptive.crossover_fraction_max = std::min(1.0f, a["crossoverFraction"]["max"].get<float>());
+        ga_cfg_.adaptive.diversity_low          = a["diversityLow"];
+        ga_cfg_.adaptive.diversity_high         = a["diversityHigh"];
+        ga_cfg_.adaptive.stall_generations      = std::max(1, a["stallGenerations"].get<int>());
+        ga_cfg_.adaptive.step                   = std::max(1.0, a["step"].get<double>());
+        if (ga_cfg_.backend != "nsga3") {
+            std::cout << "Adaptive operator rates only support nsga3 backend, disabled" << std::endl;
+            ga_cfg_.adaptive.enable = false;
+        }
+    }
+    eta_ = ga_cfg_.eta;
+
+    // 工作进程读取同一个配置文件，只使用其中的地址
+    ga_cfg_.farm_enable = p.count("farm") && p["farm"]["enable"];
+    if (p.count("farm")) {
+        const auto &f                     = p["farm"];
+        ga_cfg_.farm_threads              = std::max(1, f["threads"].get<int>());
+        ga_cfg_.farm.host                 = f["host"];
+        ga_cfg_.farm.port                 = f["port"];
+        ga_cfg_.farm.batch_size           = std::max(1, f["batchSize"].get<int>());
+        ga_cfg_.farm.max_inflight         = std::max(1, f["maxInflight"].get<int>());
+        ga_cfg_.farm.queue_max            = std::max(1, f["queueMax"].get<int>());
+        ga_cfg_.farm.retry_max            = f["retryMax"];
+        ga_cfg_.farm.batch_timeout_ms     = f["batchTimeoutSec"].get<int>() * 1000;
+        ga_cfg_.farm.no_worker_timeout_ms = f["noWorkerTimeoutSec"].get<int>() * 1000;
+        if (ga_cfg_.farm_enable && ga_cfg_.island_num > 1) {
+            std::cout << "Farm mode does not support island mode, disabled" << std::endl;
+            ga_cfg_.farm_enable = false;
+        }
+    }
 
     // 解析结果的分数限制和可调占比
     auto misc              = j["miscSettings"];
@@ -48,18 +177,7 @@ void OpengaAdapter<SimType>::ParseCfgFile(const std::string &ga_cfg_file) {
     sim_misc_.working_base_mw = misc["sim.power.workingBase_mw"];
     sim_misc_.idle_base_mw    = misc["sim.power.idleBase_mw"];
 
-    rank_misc_.common_fraction     = misc["eval.perf.commonFraction"];
-    rank_misc_.render_fraction     = misc["eval.perf.renderFraction"];
-    rank_misc_.perf_partition_len  = misc["eval.perf.partitionLen"];
-    rank_misc_.batt_partition_len  = misc["eval.power.partitionLen"];
-    rank_misc_.seq_lag_l1          = misc["eval.perf.seqLagL1"];
-    rank_misc_.seq_lag_l2          = misc["eval.perf.seqLagL2"];
-    rank_misc_.seq_lag_max         = misc["eval.perf.seqLagMax"];
-    rank_misc_.seq_lag_l0_scale    = misc["eval.perf.seqLagL0Scale"];
-    rank_misc_.seq_lag_l1_scale    = misc["eval.perf.seqLagL1Scale"];
-    rank_misc_.seq_lag_l2_scale    = misc["eval.perf.seqLagL2Scale"];
-    rank_misc_.enough_penalty      = misc["eval.perf.enoughPenalty"];
-    rank_misc_.complexity_fraction = misc["eval.complexityFraction"];
+    rank_misc_ = ParseRankMisc(misc);
 
     // 解析参数搜索空间范围
     ParamDescCfg desc_cfg;
@@ -68,6 +186,7 @@ void OpengaAdapter<SimType>::ParseCfgFile(const std::string &ga_cfg_file) {
         ParamDescElement el;
         el.range_start = j["parameterRange"][key]["min"];
         el.range_end   = j["parameterRange"][key]["max"];
+        el.name        = key;
         return el;
     };
 
@@ -87,63 +206,235 @@ void OpengaAdapter<SimType>::ParseCfgFile(const std::string &ga_cfg_file) {
     desc_cfg.down_threshold            = get_range("down_threshold");
     desc_cfg.up_threshold              = get_range("up_threshold");
     desc_cfg.boost                     = get_range("boost");
+    if (j["parameterRange"].count("pinned"))
+        desc_cfg.pinned = j["parameterRange"]["pinned"].get<std::map<std::string, int>>();
+    desc_cfg.gear.breakpoints = 0;
+    desc_cfg.gear.monotone    = false;
+    if (j.count("gearEncoding")) {
+        desc_cfg.gear.breakpoints = std::max(0, j["gearEncoding"]["breakpoints"].get<int>());
+        desc_cfg.gear.monotone    = j["gearEncoding"]["monotone"];
+    }
 
     InitParamDesc(desc_cfg);
+
+    screen_trajectories_ = 16;
+    screen_levels_       = 4;
+    screen_threshold_    = 0.05;
+    if (j.count("screening")) {
+        screen_trajectories_ = j["screening"]["trajectories"];
+        screen_levels_       = std::max(2, j["screening"]["levels"].get<int>());
+        screen_threshold_    = j["screening"]["threshold"];
+    }
+
+    // 代理模型预筛选后代，需要在确定基因长度之后初始化
+    if (p.count("surrogate") && p["surrogate"]["enable"]) {
+        auto              s = p["surrogate"];
+        RffSurrogate::Cfg cfg;
+        cfg.n_features           = s["features"];
+        cfg.length_scale         = s["lengthScale"];
+        cfg.ridge                = s["ridge"];
+        cfg.min_samples          = s["minSamples"];
+        cfg.exploration_fraction = s["explorationFraction"];
+        cfg.margin               = s["margin"];
+        surrogate_.reset(new RffSurrogate(cfg, param_len_, 3, ga_cfg_.random_seed));
+    }
+
+    // 按应用分别评估，除最后一个应用外不接灭屏负载
+    per_app_threads_ = 1;
+    if (j.count("perAppEval") && j["perAppEval"]["enable"]) {
+        per_app_threads_ = j["perAppEval"]["threadNum"];
+        apps_            = LoadSrcWorkloads(*workload_, &app_scales_);
+        empty_idle_.reset(new Workload(*idleload_));
+        empty_idle_->windowed_load_.clear();
+    }
+
+    // 灭屏从初始状态开始仿真，灭屏负载没有触摸时输入升频不会触发，结果只取决于调速器和调度器参数
+    offscreen_reset_    = j.count("offscreenEval") && j["offscreenEval"]["canonicalReset"];
+    offscreen_parallel_ = false;
+    if (offscreen_reset_) {
+        offscreen_parallel_ = j["offscreenEval"]["parallel"];
+        if (!empty_idle_) {
+            empty_idle_.reset(new Workload(*idleload_));
+            empty_idle_->windowed_load_.clear();
+        }
+    }
+
+    // 这两种评估在构造时就启动常驻线程，fork出的岛屿进程里没有这些线程，第一次评估会一直等待
+    if (ga_cfg_.island_num > 1 && (!apps_.empty() || offscreen_parallel_)) {
+        std::cout << "Island mode does not support perAppEval or offscreenEval.parallel, disabled" << std::endl;
+        ga_cfg_.island_num = 1;
+    }
+
+    // 评估结果缓存，重复运行时跳过已经仿真过的参数
+    eval_settings_ = misc.dump() + (apps_.empty() ? "" : "perAppEval");
+    eval_settings_ += offscreen_reset_ ? "offscreenReset" : "";
+    if (j.count("evalCache") && j["evalCache"]["enable"])
+        InitEvalCache(j["evalCache"]["file"], eval_settings_);
+
+    // 优化结束后保存仿真日志，用于wipe rescore
+    simlog_enable_ = j.count("rescore") && j["rescore"]["enable"];
+    simlog_sample_ = simlog_enable_ ? j["rescore"]["sample"].get<int>() : 0;
+    simlog_ctx_    = simlog_enable_ ? SimLogContext(*soc_, *workload_, *idleload_, j) : 0;
+}
+
+template <typename SimType>
+uint64_t OpengaAdapter<SimType>::HashSimEnv(uint64_t seed, const std::string &settings) const {
+    const std::string sim_name = typeid(SimType).name();
+
+    uint64_t ctx = HashBytes(sim_name.data(), sim_name.size(), seed);
+    ctx          = HashFile(soc_->model_file_, ctx);
+    if (workload_->IsComposite()) {
+        for (const auto &seg : workload_->GetSegments()) {
+            ctx = HashFile(seg.work->workload_file_, ctx);
+            ctx = HashBytes(&seg.weight, sizeof(seg.weight), ctx);
+        }
+    } else {
+        ctx = HashFile(workload_->workload_file_, ctx);
+    }
+    ctx = HashFile(idleload_->workload_file_, ctx);
+    ctx = HashBytes(settings.data(), settings.size(), ctx);
+    // 固定参数不在染色体上，也就不在缓存键中，把它们的位置和取值计入上下文
+    // 只计入取值时固定参数换了位置上下文不变，而键中第i个基因对应的参数已经变了
+    for (int i = 0; i < (int)full_desc_.size(); ++i) {
+        const auto &desc = full_desc_[i];
+        if (desc.range_start != desc.range_end)
+            continue;
+        ctx = HashBytes(&i, sizeof(i), ctx);
+        ctx = HashBytes(&desc.range_start, sizeof(desc.range_start), ctx);
+    }
+    // 分段编码时同样的基因翻译出不同的参数
+    if (gear_cfg_.breakpoints > 0) {
+        ctx = HashBytes(&gear_cfg_.breakpoints, sizeof(gear_cfg_.breakpoints), ctx);
+        ctx = HashBytes(&gear_cfg_.monotone, sizeof(gear_cfg_.monotone), ctx);
+    }
+    return ctx;
+}
+
+template <typename SimType>
+void OpengaAdapter<SimType>::InitEvalCache(const std::string &cache_file, const std::string &misc_settings) {
+    // 仿真或评分的逻辑有变化时递增，使旧的缓存记录失效
+    const uint32_t kEvalCacheVersion = 3;
+
+    const uint64_t ctx = HashSimEnv(HashBytes(&kEvalCacheVersion, sizeof(kEvalCacheVersion)), misc_settings);
+    eval_cache_.reset(new EvalCache(cache_file, ctx));
+}
+
+template <typename SimType>
+uint64_t OpengaAdapter<SimType>::FarmContext(void) const {
+    const uint32_t kFarmVersion = 2;
+
+    // 档位翻译为参数取值时依赖每个参数的范围，不只是固定参数
+    uint64_t ctx = HashSimEnv(HashBytes(&kFarmVersion, sizeof(kFarmVersion)), eval_settings_);
+    for (const auto &desc : full_desc_) {
+        ctx = HashBytes(&desc.range_start, sizeof(desc.range_start), ctx);
+        ctx = HashBytes(&desc.range_end, sizeof(desc.range_end), ctx);
+        if (!desc.levels.empty())
+            ctx = HashBytes(desc.levels.data(), desc.levels.size() * sizeof(int), ctx);
+    }
+    return HashBytes(&param_len_, sizeof(param_len_), ctx);
 }
 
 template <typename SimType>
 void OpengaAdapter<SimType>::InitParamSeq(ParamSeq &p, const RandomFunc &rnd01) {
     p.reserve(param_len_);
     for (int i = 0; i < param_len_; ++i) {
-        p.push_back(rnd01());
+        if (ga_cfg_.integer_genome) {
+            const int n = GeneLevelNum(param_desc_[i]);
+            p.push_back(std::min((int)(rnd01() * n), n - 1));
+        } else {
+            p.push_back(rnd01());
+        }
     }
 }
 
 // mutPolynomialBounded
 // Polynomial mutation as implemented in original NSGA-II algorithm in C by Deb.
-template <typename SimType>
-ParamSeq OpengaAdapter<SimType>::Mutate(const ParamSeq &X_base, const RandomFunc &rnd01, double shrink_scale) {
-    // 假设X1，X2等长
-    const int    size    = X_base.size();
-    const double eta     = ga_cfg_.eta;
+double PolyMutateGene(double x, double eta, const std::function<double(void)> &rnd01) {
     const double eta_1   = eta + 1.0;
     const double mut_pow = 1.0 / eta_1;
-    ParamSeq     ret(size);
+    const double delta_1 = x;
+    const double delta_2 = 1.0 - x;
+    const double rnd     = rnd01();
+    double       delta_q, val;
+
+    if (rnd < 0.5) {
+        val     = 2.0 * rnd + (1.0 - 2.0 * rnd) * std::pow(1.0 - delta_1, eta_1);
+        delta_q = std::pow(val, mut_pow) - 1.0;
+    } else {
+        val     = 2.0 * (1.0 - rnd) + 2.0 * (rnd - 0.5) * std::pow(1.0 - delta_2, eta_1);
+        delta_q = 1.0 - std::pow(val, mut_pow);
+    }
+
+    return std::min(std::max(x + delta_q, 0.0), 1.0);
+}
+
+// cxSimulatedBinaryBounded
+// Executes a simulated binary crossover that modify in-place the input individuals. The simulated binary crossover
+// expects :term:`sequence` individuals of floating point numbers
+double SbxGene(double a, double b, double eta, const std::function<double(void)> &rnd01) {
+    const double eta_1 = eta + 1.0;
+    const double x1    = std::min(a, b);
+    const double x2    = std::max(a, b);
+    const double rnd   = rnd01();
+    const double x2_x1 = x2 - x1;
+    double       beta_q;
+
+    double beta  = 1.0 + (2.0 * x1 / x2_x1);
+    double alpha = 2.0 - std::pow(beta, -eta_1);
+    if (rnd <= 1.0 / alpha) {
+        beta_q = std::pow(rnd * alpha, 1.0 / eta_1);
+    } else {
+        beta_q = std::pow(1.0 / (2.0 - rnd * alpha), 1.0 / eta_1);
+    }
+
+    double c1 = 0.5 * (x1 + x2 - beta_q * x2_x1);
+
+    beta  = 1.0 + (2.0 * (1.0 - x2) / x2_x1);
+    alpha = 2.0 - std::pow(beta, -eta_1);
+    if (rnd <= 1.0 / alpha) {
+        beta_q = std::pow(rnd * alpha, 1.0 / eta_1);
+    } else {
+        beta_q = std::pow(1.0 / (2.0 - rnd * alpha), 1.0 / eta_1);
+    }
+
+    double c2 = 0.5 * (x1 + x2 + beta_q * x2_x1);
+
+    c1 = std::min(std::max(c1, 0.0), 1.0);
+    c2 = std::min(std::max(c2, 0.0), 1.0);
+
+    if (rnd01() <= 0.5) {
+        return c2;
+    } else {
+        return c1;
+    }
+}
+
+template <typename SimType>
+ParamSeq OpengaAdapter<SimType>::Mutate(const ParamSeq &X_base, const RandomFunc &rnd01, double shrink_scale) {
+    if (ga_cfg_.integer_genome)
+        return MutateInteger(X_base, rnd01);
+
+    const int size = X_base.size();
+    ParamSeq  ret(size);
 
     for (int idx = 0; idx < size; ++idx) {
         if (rnd01() >= 0.5) {
             ret[idx] = X_base[idx];
             continue;
         }
-
-        const double delta_1 = X_base[idx];
-        const double delta_2 = 1.0 - X_base[idx];
-        const double rnd     = rnd01();
-        double       delta_q, val;
-
-        if (rnd < 0.5) {
-            val     = 2.0 * rnd + (1.0 - 2.0 * rnd) * std::pow(1.0 - delta_1, eta_1);
-            delta_q = std::pow(val, mut_pow) - 1.0;
-        } else {
-            val     = 2.0 * (1.0 - rnd) + 2.0 * (rnd - 0.5) * std::pow(1.0 - delta_2, eta_1);
-            delta_q = 1.0 - std::pow(val, mut_pow);
-        }
-
-        ret[idx] = std::min(std::max(X_base[idx] + delta_q, 0.0), 1.0);
+        ret[idx] = PolyMutateGene(X_base[idx], eta_, rnd01);
     }
     return ret;
 }
 
-// cxSimulatedBinaryBounded
-// Executes a simulated binary crossover that modify in-place the input individuals. The simulated binary crossover
-// expects :term:`sequence` individuals of floating point numbers
 template <typename SimType>
 ParamSeq OpengaAdapter<SimType>::Crossover(const ParamSeq &X1, const ParamSeq &X2, const RandomFunc &rnd01) {
+    if (ga_cfg_.integer_genome)
+        return CrossoverInteger(X1, X2, rnd01);
+
     // 假设X1，X2等长
-    const int    size  = X1.size();
-    const double eta   = ga_cfg_.eta;
-    const double eta_1 = eta + 1.0;
-    ParamSeq     ret(size);
+    const int size = X1.size();
+    ParamSeq  ret(size);
 
     for (int idx = 0; idx < size; ++idx) {
         if (rnd01() >= 0.5) {
@@ -154,95 +445,810 @@ ParamSeq OpengaAdapter<SimType>::Crossover(const ParamSeq &X1, const ParamSeq &X
             ret[idx] = X2[idx];
             continue;
         }
+        ret[idx] = SbxGene(X1[idx], X2[idx], eta_, rnd01);
+    }
+    return ret;
+}
 
-        const double x1    = std::min(X1[idx], X2[idx]);
-        const double x2    = std::max(X1[idx], X2[idx]);
-        const double rnd   = rnd01();
-        const double x2_x1 = x2 - x1;
-        double       beta_q;
+template <typename SimType>
+void OpengaAdapter<SimType>::MO_report_generation(int                                             generation_number,
+                                                  const EA::GenerationType<ParamSeq, MiddleCost> &last_generation,
+                                                  const std::vector<unsigned int> &               pareto_front) {
+    std::vector<Objectives> front;
+    for (const auto &idx : pareto_front) {
+        if (!last_generation.chromosomes[idx].middle_costs.screened)
+            front.push_back(last_generation.chromosomes[idx].objectives);
+    }
+    OnGeneration(generation_number, front);
+}
 
-        double beta  = 1.0 + (2.0 * x1 / x2_x1);
-        double alpha = 2.0 - std::pow(beta, -eta_1);
-        if (rnd <= 1.0 / alpha) {
-            beta_q = std::pow(rnd * alpha, 1.0 / eta_1);
-        } else {
-            beta_q = std::pow(1.0 / (2.0 - rnd * alpha), 1.0 / eta_1);
+template <typename SimType>
+void OpengaAdapter<SimType>::OnGeneration(int generation_number, const std::vector<Objectives> &front) {
+    // 一代结束后没有并发的评估，可以安全地更新代理模型
+    if (surrogate_) {
+        surrogate_->Fit();
+        front_objectives_ = front;
+    }
+
+    if (ga_cfg_.progress_log) {
+        std::cout << "Generation " << generation_number << ", simulations " << n_simulated_ << ", hypervolume "
+                  << Hypervolume2D(front, HypervolumeRef()) << std::endl;
+    }
+}
+
+template <typename SimType>
+double OpengaAdapter<SimType>::PopulationDiversity(const EA::GenerationType<ParamSeq, MiddleCost> &gen) const {
+    const int n = gen.chromosomes.size();
+    if (n < 2 || param_len_ == 0)
+        return 0.0;
+
+    std::vector<double> sum(param_len_, 0.0);
+    std::vector<double> sum_sq(param_len_, 0.0);
+    ParamSeq            buf;
+    for (const auto &c : gen.chromosomes) {
+        const ParamSeq &r = GenesToRatios(c.genes, &buf);
+        for (int i = 0; i < param_len_; ++i) {
+            sum[i] += r[i];
+            sum_sq[i] += r[i] * r[i];
+        }
+    }
+
+    double diversity = 0.0;
+    for (int i = 0; i < param_len_; ++i) {
+        const double mean = sum[i] / n;
+        diversity += std::sqrt(std::max(0.0, sum_sq[i] / n - mean * mean));
+    }
+    return diversity / param_len_;
+}
+
+// 多样性不足或者前沿停滞时增加变异、减小eta使后代离父代更远、增加每代的后代数量，
+// 多样性充足并且前沿仍在改进时反向调整，每代的仿真次数随之减少
+template <typename SimType>
+void OpengaAdapter<SimType>::AdaptOperators(GA_Type &ga_obj) {
+    const auto &cfg = ga_cfg_.adaptive;
+    const auto &gen = ga_obj.last_generation;
+
+    std::vector<Objectives> front;
+    for (const auto &i : gen.fronts[0])
+        front.push_back(gen.chromosomes[i].objectives);
+    const double hv        = Hypervolume2D(front, HypervolumeRef());
+    const double diversity = PopulationDiversity(gen);
+
+    if (ga_obj.generation_step <= 0) {
+        diversity_init_   = std::max(diversity, 1e-9);
+        best_hypervolume_ = hv;
+        n_stall_          = 0;
+        return;
+    }
+
+    bool improved = false;
+    if (hv > best_hypervolume_) {
+        best_hypervolume_ = hv;
+        n_stall_          = 0;
+        improved          = true;
+    } else {
+        ++n_stall_;
+    }
+
+    const double rel_diversity = diversity / diversity_init_;
+    double       scale         = 1.0;
+    if (rel_diversity < cfg.diversity_low || n_stall_ >= cfg.stall_generations) {
+        scale = cfg.step;
+        // 新的设置需要几代才能体现效果
+        if (n_stall_ >= cfg.stall_generations)
+            n_stall_ = 0;
+    } else if (improved && rel_diversity > cfg.diversity_high) {
+        scale = 1.0 / cfg.step;
+    }
+
+    auto clamp = [](double v, double lo, double hi) { return std::min(std::max(v, lo), hi); };
+    ga_obj.mutation_rate = clamp(ga_obj.mutation_rate * scale, cfg.mutation_rate_min, cfg.mutation_rate_max);
+    ga_obj.crossover_fraction =
+        clamp(ga_obj.crossover_fraction * scale, cfg.crossover_fraction_min, cfg.crossover_fraction_max);
+    eta_ = clamp(eta_ / scale, cfg.eta_min, cfg.eta_max);
+
+    if (ga_cfg_.progress_log) {
+        std::cout << "Generation " << ga_obj.generation_step << ", diversity " << rel_diversity << ", mutation rate "
+                  << ga_obj.mutation_rate << ", eta " << eta_ << ", crossover fraction " << ga_obj.crossover_fraction
+                  << std::endl;
+    }
+}
+
+template <typename SimType>
+bool OpengaAdapter<SimType>::IsWorthSimulating(const ParamSeq &param_seq, const ParamSeq &ratios,
+                                               MiddleCost *predicted) {
+    if (!surrogate_->IsReady())
+        return true;
+
+    const auto &cfg = surrogate_->GetCfg();
+
+    // 按基因序列的哈希决定是否探索，多线程下结果与评估顺序无关
+    const uint64_t h = HashBytes(param_seq.data(), param_seq.size() * sizeof(double));
+    if ((h >> 11) * (1.0 / (1ULL << 53)) < cfg.exploration_fraction)
+        return true;
+
+    double y[3];
+    surrogate_->Predict(ratios, y);
+
+    // 与CalcMultiObjectives相同的目标，都是越小越好
+    const double f1 = y[0];
+    const double f2 = -(misc_.work_fraction * y[1] + misc_.idle_fraction * y[2]);
+    const double m1 = cfg.margin * surrogate_->GetRmse(0);
+    const double m2 =
+        cfg.margin * (misc_.work_fraction * surrogate_->GetRmse(1) + misc_.idle_fraction * surrogate_->GetRmse(2));
+
+    // 被前沿上的某个点以超过预测误差的幅度支配，认为明显较差
+    bool skip = false;
+    for (const auto &q : front_objectives_) {
+        if (q[0] <= f1 - m1 && q[1] <= f2 - m2) {
+            skip = true;
+            break;
         }
+    }
+    surrogate_->CountScreened(skip);
+    if (skip)
+        *predicted = {y[0], y[1], y[2], true};
+    return !skip;
+}
 
-        double c1 = 0.5 * (x1 + x2 - beta_q * x2_x1);
+template <typename SimType>
+bool OpengaAdapter<SimType>::EvalParamSeq(const ParamSeq &param_seq, MiddleCost &result) {
+    NoAllocScope no_alloc("EvalParamSeq", param_seq_warmed_up);
+    return EvalCachedParamSeq(param_seq, true, result);
+}
 
-        beta  = 1.0 + (2.0 * (1.0 - x2) / x2_x1);
-        alpha = 2.0 - std::pow(beta, -eta_1);
-        if (rnd <= 1.0 / alpha) {
-            beta_q = std::pow(rnd * alpha, 1.0 / eta_1);
+template <typename SimType>
+bool OpengaAdapter<SimType>::EvalCachedParamSeq(const ParamSeq &param_seq, bool allow_screen, MiddleCost &result) {
+    // 缓存命中和筛掉的分支用到的缓冲区是仿真分支的子集，线程第一次仿真之后整个评估不应有堆分配
+    NoAllocScope no_alloc("EvalCachedParamSeq", param_seq_warmed_up);
+
+    // 量化的取值放在单元素的数组中，农场可以直接使用，整数基因的比例也复用本线程的缓冲区
+    static thread_local std::vector<std::vector<int>> keys(1);
+    static thread_local std::vector<FarmCost>         costs;
+    static thread_local ParamSeq                      ratio_buf;
+
+    const std::vector<int> &key    = keys[0];
+    const ParamSeq &        ratios = surrogate_ ? GenesToRatios(param_seq, &ratio_buf) : param_seq;
+
+    // 量化后相同的基因序列翻译出的参数完全一致，可以直接使用缓存的结果
+    EvalCache::Entry e;
+    if (eval_cache_ || farm_)
+        QuantizeParamSeq(param_seq, &keys[0]);
+
+    bool pass;
+    if (eval_cache_ && eval_cache_->Lookup(key, &e)) {
+        result = {e.c1, e.c2, e.c3, false};
+        pass   = e.feasible;
+    } else {
+        // 返回false时openGA会重新生成这个后代，筛掉的个体以预测的评分留在种群中，被前沿支配，不写入缓存和代理模型
+        if (allow_screen && surrogate_ && !IsWorthSimulating(param_seq, ratios, &result))
+            return true;
+
+        if (farm_) {
+            farm_->Eval(keys, 1, &costs);
+            // 重试次数用尽时与批量评估一样使用占位评分，不写入缓存和代理模型
+            if (costs[0].failed) {
+                result = UnsimulatedCost();
+                return true;
+            }
+            result = {costs[0].c1, costs[0].c2, costs[0].c3};
+            pass   = costs[0].feasible;
         } else {
-            beta_q = std::pow(1.0 / (2.0 - rnd * alpha), 1.0 / eta_1);
+            pass = EvalTunables(TranslateParamSeq(param_seq), result);
         }
+        ++n_simulated_;
+        if (eval_cache_)
+            eval_cache_->Insert(key, {result.c1, result.c2, result.c3, pass});
+        param_seq_warmed_up = true;
+    }
 
-        double c2 = 0.5 * (x1 + x2 + beta_q * x2_x1);
+    if (surrogate_) {
+        const double y[3] = {result.c1, result.c2, result.c3};
+        surrogate_->AddSample(ratios, y);
+    }
+    return pass;
+}
 
-        c1 = std::min(std::max(c1, 0.0), 1.0);
-        c2 = std::min(std::max(c2, 0.0), 1.0);
+template <typename SimType>
+std::vector<char> OpengaAdapter<SimType>::EvalParamSeqBatch(const std::vector<const ParamSeq *> &seqs,
+                                                            bool allow_screen, std::vector<MiddleCost> *results) {
+    const int         n = seqs.size();
+    std::vector<char> feasible(n, 0);
+    // 没有写入结果的个体也有确定的评分，与代理模型筛掉的个体一样不进入前沿
+    for (int i = 0; i < n; ++i)
+        (*results)[i] = UnsimulatedCost();
+
+    // 返回值之外的缓冲区都是成员或者线程的，个体数不超过之前见过的最大值时调用者线程不应有堆分配
+    // 农场模式下要求之前有同样多的个体交给农场仿真过，提交队列的容量才足够
+    const bool   warmed = n <= batch_warmed_n_;
+    NoAllocScope no_alloc("EvalParamSeqBatch", warmed);
+    if (!batch_pool_)
+        batch_pool_.reset(new WorkerPool(ga_cfg_.thread_num));
+    if ((int)batch_keys_.size() < n) {
+        batch_keys_.resize(n);
+        batch_values_.resize(n);
+        for (int i = 0; i < n; ++i) {
+            batch_keys_[i].reserve(param_len_);
+            batch_values_[i].reserve(param_len_);
+        }
+        batch_need_sim_.resize(n);
+        batch_todo_.reserve(n);
+        batch_costs_.reserve(n);
+    }
 
-        if (rnd01() <= 0.5) {
-            ret[idx] = c2;
-        } else {
-            ret[idx] = c1;
+    if (ga_cfg_.batch_size <= 1 && !farm_) {
+        batch_pool_->Run(n, [&](int idx, int) {
+            feasible[idx] = EvalCachedParamSeq(*seqs[idx], allow_screen, (*results)[idx]) && !(*results)[idx].screened;
+        });
+        batch_warmed_n_ = std::max(batch_warmed_n_, n);
+        return feasible;
+    }
+
+    // 与EvalCachedParamSeq的逻辑一致，只是把需要仿真的个体留到后面成组仿真
+    auto &keys     = batch_keys_;
+    auto &need_sim = batch_need_sim_;
+    batch_pool_->Run(n, [&](int idx, int) {
+        static thread_local bool     lookup_warmed = false;
+        static thread_local ParamSeq buf;
+        NoAllocScope                 no_alloc_task("EvalParamSeqBatch lookup", lookup_warmed);
+        lookup_warmed = true;
+
+        EvalCache::Entry e;
+        need_sim[idx] = 0;
+        if (eval_cache_ || farm_)
+            QuantizeParamSeq(*seqs[idx], &keys[idx]);
+        if (eval_cache_ && eval_cache_->Lookup(keys[idx], &e)) {
+            (*results)[idx] = {e.c1, e.c2, e.c3};
+            feasible[idx]   = e.feasible;
+            if (surrogate_) {
+                const double y[3] = {e.c1, e.c2, e.c3};
+                surrogate_->AddSample(GenesToRatios(*seqs[idx], &buf), y);
+            }
+        } else if (!allow_screen || !surrogate_ ||
+                   IsWorthSimulating(*seqs[idx], GenesToRatios(*seqs[idx], &buf), &(*results)[idx])) {
+            need_sim[idx] = 1;
         }
+    });
+
+    auto &todo = batch_todo_;
+    todo.clear();
+    for (int i = 0; i < n; ++i) {
+        if (need_sim[i])
+            todo.push_back(i);
     }
-    return ret;
+
+    auto finish = [&](int idx, const MiddleCost &c, bool pass) {
+        static thread_local ParamSeq buf;
+        (*results)[idx] = c;
+        feasible[idx]   = pass;
+        if (eval_cache_)
+            eval_cache_->Insert(keys[idx], {c.c1, c.c2, c.c3, pass});
+        if (surrogate_) {
+            const double y[3] = {c.c1, c.c2, c.c3};
+            surrogate_->AddSample(GenesToRatios(*seqs[idx], &buf), y);
+        }
+    };
+
+    const int n_todo = todo.size();
+    if (farm_) {
+        // 一次提交所有需要仿真的个体，由协调者分批发给工作进程，复用预留的量化取值
+        auto &values = batch_values_;
+        auto &costs  = batch_costs_;
+        for (int k = 0; k < n_todo; ++k)
+            values[k] = keys[todo[k]];
+        farm_->Eval(values, n_todo, &costs);
+        n_simulated_ += n_todo;
+        for (int k = 0; k < n_todo; ++k) {
+            // 重试次数用尽时保留初始化的占位评分，不写入缓存
+            if (!costs[k].failed)
+                finish(todo[k], {costs[k].c1, costs[k].c2, costs[k].c3}, costs[k].feasible);
+        }
+        batch_warmed_n_ = std::max(batch_warmed_n_, n_todo);
+        return feasible;
+    }
+
+    const int n_group = (n_todo + ga_cfg_.batch_size - 1) / ga_cfg_.batch_size;
+    batch_pool_->Run(n_group, [&](int g, int) {
+        const int begin = g * ga_cfg_.batch_size;
+        const int end   = std::min(begin + ga_cfg_.batch_size, n_todo);
+
+        // 组的大小不超过这个线程之前见过的最大值时不应有堆分配
+        static thread_local int                                     group_warmed_n = 0;
+        static thread_local std::vector<typename SimType::Tunables> ts;
+        static thread_local std::vector<MiddleCost>                 costs;
+        static thread_local std::vector<char>                       pass;
+        NoAllocScope no_alloc_task("EvalParamSeqBatch group", end - begin <= group_warmed_n);
+        group_warmed_n = std::max(group_warmed_n, end - begin);
+
+        ts.clear();
+        for (int k = begin; k < end; ++k)
+            ts.push_back(TranslateParamSeq(*seqs[todo[k]]));
+        costs.resize(ts.size());
+        EvalTunablesBatch(ts, &costs, &pass);
+        n_simulated_ += ts.size();
+
+        for (int k = begin; k < end; ++k)
+            finish(todo[k], costs[k - begin], pass[k - begin]);
+    });
+    batch_warmed_n_ = std::max(batch_warmed_n_, n);
+    return feasible;
 }
 
 template <typename SimType>
-void OpengaAdapter<SimType>::MO_report_generation(int                                             generation_number,
-                                                  const EA::GenerationType<ParamSeq, MiddleCost> &last_generation,
-                                                  const std::vector<unsigned int> &               pareto_front) {
-    return;
+bool OpengaAdapter<SimType>::EvalTunables(const typename SimType::Tunables &t, MiddleCost &result) {
+    if (!apps_.empty())
+        return EvalTunablesPerApp(t, result, nullptr);
+
+    // 线程第一次评估时分配复用的缓冲区，之后的评估不应有堆分配
+    static thread_local bool warmed_up = false;
+    NoAllocScope             no_alloc("EvalTunables", warmed_up);
+    warmed_up = true;
+
+    static thread_local SimResultPack rp;
+    rp.onscreen.capacity.clear();
+    rp.onscreen.power.clear();
+    rp.onscreen.capacity.reserve(workload_->GetWindowNum());
+    rp.onscreen.power.reserve(workload_->GetWindowNum());
+
+    RunTunables(t, *workload_, true, &rp);
+    return RankResult(rp, result);
 }
 
 template <typename SimType>
-bool OpengaAdapter<SimType>::EvalParamSeq(const ParamSeq &param_seq, MiddleCost &result) {
-    typename SimType::Tunables t = TranslateParamSeq(param_seq);
+void OpengaAdapter<SimType>::EvalTunablesBatch(const std::vector<typename SimType::Tunables> &ts,
+                                               std::vector<MiddleCost> *results, std::vector<char> *pass) {
+    const int n = ts.size();
+
+    // 每个线程复用仿真结果的缓冲区，组的大小不超过之前见过的最大值时不应有堆分配
+    static thread_local int warmed_n = 0;
+    NoAllocScope            no_alloc("EvalTunablesBatch", n <= warmed_n);
+    warmed_n = std::max(warmed_n, n);
+
+    pass->resize(n);
+    if (!apps_.empty()) {
+        for (int i = 0; i < n; ++i)
+            (*pass)[i] = EvalTunablesPerApp(ts[i], (*results)[i], nullptr);
+        return;
+    }
 
-    SimResultPack rp;
-    rp.onscreen.capacity.reserve(workload_->windowed_load_.size());
-    rp.onscreen.power.reserve(workload_->windowed_load_.size());
+    static thread_local std::vector<SimType>         sims;
+    static thread_local std::vector<SimResultPack>   rps;
+    static thread_local std::vector<SimResultPack *> rp_ptrs;
+    sims.clear();
+    rp_ptrs.clear();
+    if ((int)rps.size() < n)
+        rps.resize(n);
+    for (int i = 0; i < n; ++i) {
+        sims.emplace_back(ts[i], sim_misc_);
+        rps[i].onscreen.capacity.clear();
+        rps[i].onscreen.power.clear();
+        rps[i].onscreen.capacity.reserve(workload_->GetWindowNum());
+        rps[i].onscreen.power.reserve(workload_->GetWindowNum());
+        rp_ptrs.push_back(&rps[i]);
+    }
 
-    SimType sim(t, sim_misc_);
-    sim.Run(*workload_, *idleload_, *soc_, &rp);
+    // 灭屏从初始状态开始时成组仿真只推进亮屏，灭屏逐个单独仿真
+    SimType::RunBatch(sims, *workload_, offscreen_reset_ ? *empty_idle_ : *idleload_, *soc_, rp_ptrs,
+                      ga_cfg_.batch_tile);
+    for (int i = 0; i < n; ++i) {
+        if (offscreen_reset_)
+            rps[i].offscreen_pwr = OffscreenPower(ts[i]);
+        (*pass)[i] = RankResult(rps[i], (*results)[i]);
+    }
+}
+
+template <typename SimType>
+bool OpengaAdapter<SimType>::RankResult(const SimResultPack &rp, MiddleCost &result) {
     Rank rank(default_score_, rank_misc_);
     auto score = rank.Eval(*workload_, *idleload_, rp, *soc_, false);
 
-    result.c1 = score.performance;
-    result.c2 = score.battery_life;
-    result.c3 = score.idle_lasting;
+    result = {score.performance, score.battery_life, score.idle_lasting, false};
 
     bool pass = (score.idle_lasting > misc_.idle_lasting_min) && (score.performance < misc_.performance_max);
     return pass;
 }
 
+template <typename SimType>
+void OpengaAdapter<SimType>::RunTunables(const typename SimType::Tunables &t, const Workload &work, bool with_idle,
+                                         SimResultPack *rp) {
+    SimType sim(t, sim_misc_);
+    if (!with_idle) {
+        sim.Run(work, *empty_idle_, *soc_, rp);
+        return;
+    }
+    if (!offscreen_reset_) {
+        sim.Run(work, *idleload_, *soc_, rp);
+        return;
+    }
+
+    // 灭屏不接着亮屏的状态，两者互不依赖，合并负载评估时灭屏交给这次评估的常驻工作线程，亮屏在调用者线程中仿真
+    // 按应用评估时灭屏已经是单独的任务，这里只在调用者线程中依次仿真
+    if (!offscreen_parallel_ || !apps_.empty()) {
+        sim.Run(work, *empty_idle_, *soc_, rp);
+        rp->offscreen_pwr = OffscreenPower(t);
+        return;
+    }
+    EvalWorkers *w         = AcquireEvalWorkers();
+    auto         offscreen = [&](int, int) {
+        static thread_local bool warmed = false;
+        NoAllocScope             no_alloc("OffscreenPower", warmed);
+        warmed           = true;
+        w->offscreen_pwr = OffscreenPower(t);
+    };
+    w->pool->Start(1, offscreen);
+    sim.Run(work, *empty_idle_, *soc_, rp);
+    w->pool->Wait();
+    rp->offscreen_pwr = w->offscreen_pwr;
+    ReleaseEvalWorkers(w);
+}
+
+template <typename SimType>
+uint64_t OpengaAdapter<SimType>::OffscreenPower(const typename SimType::Tunables &t) {
+    static thread_local SimResultPack rp;
+    typename SimType::State           end;
+    SimType                           sim(t, sim_misc_);
+    sim.Resume(*empty_idle_, 0, 0, idleload_, *soc_, &idle_start_, &end, &rp);
+    return rp.offscreen_pwr;
+}
+
+// 调度器初始时大核活跃，调速器初始在最高频率，灭屏耗电会取决于大核和高负载的参数
+// 改为小核活跃，两个集群和调速器都在最低频率，没有升频，与实际灭屏时的状态更接近
+template <typename SimType>
+void OpengaAdapter<SimType>::InitIdleStart(void) {
+    SimResultPack rp;
+    SimType       sim(GenerateDefaultTunables(), sim_misc_);
+    sim.Resume(*empty_idle_, 0, 0, nullptr, *soc_, nullptr, &idle_start_, &rp);
+
+    Cluster::State *                   cls[] = {&idle_start_.little, &idle_start_.big};
+    typename SimType::Governor::State *gov[] = {&idle_start_.little_governor, &idle_start_.big_governor};
+    for (int i = 0; i < 2; ++i) {
+        cls[i]->busy_pct                 = 0;
+        cls[i]->cur_freq                 = cls[i]->min_freq;
+        cls[i]->cur_opp_idx              = cls[i]->min_opp_idx;
+        gov[i]->target_freq              = cls[i]->min_freq;
+        gov[i]->floor_freq               = cls[i]->min_freq;
+        gov[i]->max_freq_hyst_start_time = INT_MIN / 2;  // 最高频率的迟滞已经过期
+    }
+    idle_start_.sched.active_cluster = 0;
+
+    const auto &little   = soc_->clusters_[soc_->GetLittleClusterIdx()].model_;
+    idle_start_.capacity = idle_start_.little.min_freq * little.efficiency * 100;
+}
+
+template <typename SimType>
+bool OpengaAdapter<SimType>::EvalTunablesPerApp(const typename SimType::Tunables &t, MiddleCost &result,
+                                                std::vector<Rank::Score> *per_app) {
+    // 调用者线程第一次评估时分配复用的缓冲区，之后除了填写@per_app整个评估不应有堆分配，工作线程各自检查
+    static thread_local bool warmed_up = false;
+    NoAllocScope             no_alloc("EvalTunablesPerApp", warmed_up);
+    warmed_up = true;
+
+    const int    n = apps_.size();
+    EvalWorkers *w = AcquireEvalWorkers();
+
+    auto rank_app = [&](int idx) {
+        const bool      last = (idx == n - 1);
+        const Workload &idle = last ? *idleload_ : *empty_idle_;
+        Rank            rank(app_refs_[idx].ref, app_refs_[idx].misc);
+        auto            score = rank.Eval(*apps_[idx], idle, w->rps[idx], *soc_, false);
+
+        w->lag[idx]       = score.performance;
+        w->pwr_ratio[idx] = 1.0 / score.battery_life;
+        if (last)
+            w->idle_lasting = score.idle_lasting;
+    };
+
+    // 灭屏从初始状态开始时，最后一个应用的灭屏作为单独的任务，与各个应用的亮屏同时仿真
+    // 工作线程常驻，任务动态分配给空闲的线程，每个线程第一次执行某个应用时按它的负载长度分配缓冲区
+    const int n_task = offscreen_reset_ ? n + 1 : n;
+    w->pool->Run(n_task, [&](int idx, int worker) {
+        char &       warmed = w->warmed[worker * (n + 1) + idx];
+        NoAllocScope no_alloc("EvalTunablesPerApp task", warmed);
+        warmed = true;
+
+        if (idx == n) {
+            w->offscreen_pwr = OffscreenPower(t);
+            return;
+        }
+        const bool     last = (idx == n - 1);
+        SimResultPack &rp   = w->rps[idx];
+        rp.onscreen.capacity.clear();
+        rp.onscreen.power.clear();
+        RunTunables(t, *apps_[idx], last && !offscreen_reset_, &rp);
+        if (!last || !offscreen_reset_)
+            rank_app(idx);
+    });
+    if (offscreen_reset_) {
+        w->rps[n - 1].offscreen_pwr = w->offscreen_pwr;
+        rank_app(n - 1);
+    }
+
+    // 卡顿相对于默认参数的加权卡顿，避免默认参数在某个应用上不卡顿时无法归一化
+    double perf = 0.0;
+    double pwr  = 0.0;
+    for (int i = 0; i < n; ++i) {
+        perf += app_refs_[i].weight * w->lag[i] / app_lag_ref_;
+        pwr += app_refs_[i].weight * w->pwr_ratio[i];
+    }
+
+    result = {perf, 1.0 / pwr, w->idle_lasting, false};
+
+    if (per_app) {
+        AllocAllowedScope allow_per_app;
+        per_app->resize(n);
+        for (int i = 0; i < n; ++i) {
+            const double idle_lasting = (i == n - 1) ? w->idle_lasting : 0.0;
+            (*per_app)[i]             = {w->lag[i] / app_lag_ref_, 1.0 / w->pwr_ratio[i], idle_lasting, {}};
+        }
+    }
+    ReleaseEvalWorkers(w);
+
+    bool pass = (result.c3 > misc_.idle_lasting_min) && (result.c1 < misc_.performance_max);
+    return pass;
+}
+
+template <typename SimType>
+void OpengaAdapter<SimType>::InitAppRefs(void) {
+    typename SimType::Tunables t = GenerateDefaultTunables();
+
+    // 权重为应用在场景中的权重乘以负载长度
+    double total_len = 0.0;
+    for (size_t i = 0; i < apps_.size(); ++i)
+        total_len += app_scales_[i] * apps_[i]->windowed_load_.size();
+
+    const int n = apps_.size();
+    app_refs_.resize(n);
+    InitEvalWorkers(ga_cfg_.thread_num);
+    EvalWorkers *w = AcquireEvalWorkers();
+    w->pool->Run(n, [&](int idx, int) {
+        const Workload &app  = *apps_[idx];
+        const Workload &idle = (idx == n - 1) ? *idleload_ : *empty_idle_;
+        AppRef &        r    = app_refs_[idx];
+
+        // 单个应用的负载可能比分区短，分区长度不超过序列长度
+        const int n_window        = app.windowed_load_.size();
+        const int n_render        = app.render_load_.size();
+        r.misc                    = rank_misc_;
+        r.misc.perf_partition_len = std::max(1, std::min({r.misc.perf_partition_len, n_window, n_render}));
+        r.misc.batt_partition_len = std::max(1, std::min(r.misc.batt_partition_len, n_window));
+        r.weight                  = app_scales_[idx] * n_window / total_len;
+
+        SimResultPack &rp = w->rps[idx];
+        rp.onscreen.capacity.clear();
+        rp.onscreen.power.clear();
+        RunTunables(t, app, idx == n - 1, &rp);
+        const Rank::Score init_score = {1.0, 1.0, 1.0, {}};
+        Rank              rank(init_score, r.misc);
+        r.ref = rank.Eval(app, idle, rp, *soc_, true);
+
+        // 之后的评分中卡顿取绝对值，续航和待机相对于默认参数
+        r.lag              = r.ref.performance;
+        r.ref.performance  = 1.0;
+        r.ref.battery_life = 1.0;
+    });
+    ReleaseEvalWorkers(w);
+
+    app_lag_ref_ = 0.0;
+    for (const auto &r : app_refs_)
+        app_lag_ref_ += r.weight * r.lag;
+    if (app_lag_ref_ <= 0.0)
+        app_lag_ref_ = 1.0;
+}
+
+template <typename SimType>
+void OpengaAdapter<SimType>::InitEvalWorkers(int n) {
+    std::lock_guard<std::mutex> lock(eval_workers_mutex_);
+    while ((int)eval_workers_.size() < n) {
+        eval_workers_.push_back(NewEvalWorkers());
+        idle_eval_workers_.push_back(eval_workers_.back().get());
+    }
+    idle_eval_workers_.reserve(eval_workers_.size());
+}
+
+template <typename SimType>
+std::unique_ptr<typename OpengaAdapter<SimType>::EvalWorkers> OpengaAdapter<SimType>::NewEvalWorkers(void) const {
+    const int n = apps_.size();
+
+    std::unique_ptr<EvalWorkers> w(new EvalWorkers);
+    w->pool.reset(new WorkerPool(std::max(1, std::min(per_app_threads_, n + (offscreen_reset_ ? 1 : 0)))));
+    w->rps.resize(n);
+    for (int i = 0; i < n; ++i) {
+        w->rps[i].onscreen.capacity.reserve(apps_[i]->windowed_load_.size());
+        w->rps[i].onscreen.power.reserve(apps_[i]->windowed_load_.size());
+    }
+    w->lag.resize(n);
+    w->pwr_ratio.resize(n);
+    w->warmed.assign(w->pool->GetThreadNum() * (n + 1), false);
+    w->idle_lasting  = 0.0;
+    w->offscreen_pwr = 0;
+    return w;
+}
+
+// 同时进行的评估多于预先创建的组数时，例如线程数设置变化，临时创建一组，之后一直保留
+template <typename SimType>
+typename OpengaAdapter<SimType>::EvalWorkers *OpengaAdapter<SimType>::AcquireEvalWorkers(void) {
+    std::lock_guard<std::mutex> lock(eval_workers_mutex_);
+    if (idle_eval_workers_.empty()) {
+        AllocAllowedScope allow_new;
+        eval_workers_.push_back(NewEvalWorkers());
+        idle_eval_workers_.reserve(eval_workers_.size());
+        return eval_workers_.back().get();
+    }
+    EvalWorkers *w = idle_eval_workers_.back();
+    idle_eval_workers_.pop_back();
+    return w;
+}
+
+template <typename SimType>
+void OpengaAdapter<SimType>::ReleaseEvalWorkers(EvalWorkers *w) {
+    std::lock_guard<std::mutex> lock(eval_workers_mutex_);
+    idle_eval_workers_.push_back(w);
+}
+
 template <typename SimType>
 void OpengaAdapter<SimType>::InitDefaultScore() {
     typename SimType::Tunables t = GenerateDefaultTunables();
     Rank::Score                s = {1.0, 1.0, 1.0};
 
     SimResultPack rp;
-    rp.onscreen.capacity.reserve(workload_->windowed_load_.size());
-    rp.onscreen.power.reserve(workload_->windowed_load_.size());
-
-    SimType sim(t, sim_misc_);
-    sim.Run(*workload_, *idleload_, *soc_, &rp);
+    rp.onscreen.capacity.reserve(workload_->GetWindowNum());
+    rp.onscreen.power.reserve(workload_->GetWindowNum());
+
+    if (offscreen_reset_)
+        InitIdleStart();
+    if (offscreen_parallel_ && apps_.empty())
+        InitEvalWorkers(ga_cfg_.thread_num);
+    RunTunables(t, *workload_, true, &rp);
     Rank rank(s, rank_misc_);
     default_score_ = rank.Eval(*workload_, *idleload_, rp, *soc_, true);
+
+    if (!apps_.empty())
+        InitAppRefs();
 }
 
 template <typename SimType>
 std::vector<typename OpengaAdapter<SimType>::Result> OpengaAdapter<SimType>::Optimize(void) {
-    using namespace std::placeholders;
     EA::Chronometer timer;
     timer.tic();
 
-    GA_Type ga_obj(ga_cfg_.random_seed);
+    std::cout << "\nTarget: " << soc_->name_ << std::endl;
+    std::cout << "Chromosome length: " << param_len_ << " (" << full_desc_.size() - param_len_ << " pinned)"
+              << std::endl;
+    std::cout << "Backend: " << ga_cfg_.backend << std::endl;
+
+    // 农场模式下本地线程只等待工作进程返回结果，线程数决定同时在途的参数组数
+    const int thread_num = ga_cfg_.thread_num;
+    if (ga_cfg_.farm_enable) {
+        farm_.reset(new FarmCoordinator(ga_cfg_.farm, FarmContext()));
+        ga_cfg_.thread_num = ga_cfg_.farm_threads;
+    }
+
+    std::vector<FrontMember> front;
+    if (ga_cfg_.backend == "moead")
+        front = OptimizeMoead();
+    else if (ga_cfg_.backend == "mocmaes")
+        front = OptimizeMoCmaes();
+    else
+        front = OptimizeNsga3();
+
+    std::cout << "\nOptimized in " << timer.toc() << " seconds." << std::endl;
+    std::vector<Objectives> front_objs;
+    for (const auto &m : front)
+        front_objs.push_back(m.objectives);
+    std::cout << "Simulations: " << n_simulated_ << ", front size: " << front.size()
+              << ", hypervolume: " << Hypervolume2D(front_objs, HypervolumeRef()) << std::endl;
+    if (surrogate_) {
+        std::cout << "Surrogate skipped " << surrogate_->GetSkippedNum() << " of " << surrogate_->GetScreenedNum()
+                  << " screened offspring." << std::endl;
+    }
+
+    if (ga_cfg_.local_search_rounds > 0) {
+        timer.tic();
+        front = LocalSearch(front);
+        std::cout << "Local search refined in " << timer.toc() << " seconds." << std::endl;
+    }
+
+    // 仿真日志需要完整的仿真序列，在本地仿真
+    farm_.reset();
+    ga_cfg_.thread_num = thread_num;
+
+    if (simlog_enable_)
+        SaveSimLogs(front);
+
+    std::vector<Result> ret;
+    ret.reserve(front.size());
+    for (const auto &m : front) {
+        Result r;
+        r.tunable            = TranslateParamSeq(m.genes);
+        r.score.performance  = m.cost.c1;
+        r.score.battery_life = m.cost.c2;
+        r.score.idle_lasting = m.cost.c3;
+        r.feasible           = true;
+        ret.push_back(r);
+    }
+
+    return ret;
+}
+
+template <typename SimType>
+void OpengaAdapter<SimType>::SaveSimLogs(const std::vector<FrontMember> &front) {
+    if (!apps_.empty()) {
+        std::cout << "Simulation logs are not supported with perAppEval, skipped" << std::endl;
+        return;
+    }
+
+    EA::Chronometer timer;
+    timer.tic();
+
+    std::vector<typename SimType::Tunables> ts;
+    SimLog                                  log;
+    log.context = simlog_ctx_;
+    ts.push_back(GenerateDefaultTunables());
+    log.labels.push_back("default");
+    for (size_t i = 0; i < front.size(); ++i) {
+        ts.push_back(TranslateParamSeq(front[i].genes));
+        log.labels.push_back("front#" + std::to_string(i));
+    }
+    // 随机采样的参数覆盖前沿以外的区域，评分设置改变后前沿可能移到那里
+    std::mt19937                           rng(ga_cfg_.random_seed);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    const RandomFunc                       rnd01 = [&]() { return dist(rng); };
+    for (int i = 0; i < simlog_sample_; ++i) {
+        ParamSeq p;
+        InitParamSeq(p, rnd01);
+        ts.push_back(TranslateParamSeq(p));
+        log.labels.push_back("sample#" + std::to_string(i));
+    }
+
+    const int n = ts.size();
+    log.rps.resize(n);
+    ParallelFor(n, ga_cfg_.thread_num, [&](int idx) {
+        log.rps[idx].onscreen.capacity.reserve(workload_->GetWindowNum());
+        log.rps[idx].onscreen.power.reserve(workload_->GetWindowNum());
+        RunTunables(ts[idx], *workload_, true, &log.rps[idx]);
+    });
+
+    const std::string log_file = "./output/" + soc_->name_ + "_simlog.bin";
+    SaveSimLog(log_file, log);
+    std::cout << "Simulation logs of " << n << " parameter sets saved to " << log_file << " in " << timer.toc()
+              << " seconds." << std::endl;
+}
+
+template <typename SimType>
+std::vector<typename OpengaAdapter<SimType>::FrontMember> OpengaAdapter<SimType>::OptimizeNsga3(void) {
+    using namespace std::placeholders;
+
+    // 岛屿模式下fork出其他岛屿进程，会启动常驻线程的评估方式已经在解析配置时关闭了岛屿模式，此时还没有启动任何线程
+    std::unique_ptr<IslandChannel> channel;
+    std::vector<int>               children;
+    int                            island = 0;
+    if (ga_cfg_.island_num > 1) {
+        std::cout << "Islands: " << ga_cfg_.island_num << ", migration every " << ga_cfg_.island_interval
+                  << " generations" << std::endl;
+        channel.reset(new IslandChannel(ga_cfg_.island_socket_dir, ga_cfg_.island_num));
+        for (int i = 1; i < ga_cfg_.island_num; ++i) {
+            const int pid = fork();
+            if (pid < 0)
+                throw std::runtime_error("fork failed");
+            if (pid == 0) {
+                island = i;
+                children.clear();
+                break;
+            }
+            children.push_back(pid);
+        }
+        channel->Attach(island);
+        if (island != 0) {
+            // 进度只由岛屿0输出
+            if (!freopen("/dev/null", "w", stdout))
+                std::cout.setstate(std::ios::failbit);
+            if (eval_cache_)
+                eval_cache_->Reopen();
+        }
+    }
+
+    // 每个岛屿使用独立的随机数序列
+    IslandGa ga_obj(ga_cfg_.random_seed + island * 0x9e3779b97f4a7c15ULL);
     ga_obj.problem_mode            = EA::GA_MODE::NSGA_III;
     ga_obj.verbose                 = false;
     ga_obj.population              = ga_cfg_.population;
@@ -260,32 +1266,524 @@ std::vector<typename OpengaAdapter<SimType>::Result> OpengaAdapter<SimType>::Opt
     ga_obj.N_threads               = ga_cfg_.thread_num;
     ga_obj.idle_delay_us           = 1;  // switch between threads quickly
 
-    if (ga_cfg_.thread_num > 1) {
-        ga_obj.multi_threading   = true;
-        ga_obj.dynamic_threading = true;
-    }
+    if (ga_cfg_.thread_num > 1) {
+        ga_obj.multi_threading   = true;
+        ga_obj.dynamic_threading = true;
+    }
+
+    if (channel || ga_cfg_.adaptive.enable) {
+        ga_obj.solve_init();
+        if (ga_cfg_.adaptive.enable)
+            AdaptOperators(ga_obj);
+        while (ga_obj.solve_next_generation() == EA::StopReason::Undefined) {
+            if (ga_cfg_.adaptive.enable)
+                AdaptOperators(ga_obj);
+            if (channel && (ga_obj.generation_step + 1) % ga_cfg_.island_interval == 0)
+                Migrate(ga_obj, channel.get());
+        }
+    } else {
+        ga_obj.solve();
+    }
+
+    // 筛掉的个体被上一代的前沿支配，只有前沿成员在拥挤时被淘汰后才可能留在前沿，没有仿真过不能输出
+    std::vector<FrontMember> front;
+    for (const auto &i : ga_obj.last_generation.fronts[0]) {
+        const auto &chromosome = ga_obj.last_generation.chromosomes[i];
+        if (!chromosome.middle_costs.screened)
+            front.push_back({chromosome.genes, chromosome.middle_costs, chromosome.objectives});
+    }
+    if (!channel)
+        return front;
+
+    if (island != 0) {
+        // 阻塞发送保证最终前沿完整送达，之后直接退出，不执行后续的局部搜索和输出
+        for (const auto &m : front)
+            channel->Send(0, EncodeMember(kIslandFront, island, m), true);
+        channel->Send(0, EncodeMember(kIslandDone, island, FrontMember()), true);
+        _exit(0);
+    }
+    return GatherFronts(front, channel.get(), children);
+}
+
+template <typename SimType>
+std::vector<char> OpengaAdapter<SimType>::EncodeMember(int type, int island, const FrontMember &m) const {
+    IslandMsgHeader h;
+    h.magic       = kIslandMagic;
+    h.type        = type;
+    h.island      = island;
+    h.n_simulated = n_simulated_;
+    h.n_genes     = m.genes.size();
+    h.cost[0]     = m.cost.c1;
+    h.cost[1]     = m.cost.c2;
+    h.cost[2]     = m.cost.c3;
+
+    std::vector<char> msg(sizeof(h) + m.genes.size() * sizeof(double));
+    memcpy(msg.data(), &h, sizeof(h));
+    if (!m.genes.empty())
+        memcpy(msg.data() + sizeof(h), m.genes.data(), m.genes.size() * sizeof(double));
+    return msg;
+}
+
+template <typename SimType>
+bool OpengaAdapter<SimType>::DecodeMember(const std::vector<char> &msg, int *type, int *island, int *n_simulated,
+                                          FrontMember *m) const {
+    IslandMsgHeader h;
+    if (msg.size() < sizeof(h))
+        return false;
+    memcpy(&h, msg.data(), sizeof(h));
+    if (h.magic != kIslandMagic || msg.size() != sizeof(h) + h.n_genes * sizeof(double))
+        return false;
+    if (h.n_genes != 0 && h.n_genes != param_len_)
+        return false;
+
+    *type        = h.type;
+    *island      = h.island;
+    *n_simulated = h.n_simulated;
+    m->genes.resize(h.n_genes);
+    if (h.n_genes)
+        memcpy(m->genes.data(), msg.data() + sizeof(h), h.n_genes * sizeof(double));
+    m->cost       = {h.cost[0], h.cost[1], h.cost[2]};
+    m->objectives = CostToObjectives(m->cost);
+    return true;
+}
+
+template <typename SimType>
+void OpengaAdapter<SimType>::Migrate(IslandGa &ga_obj, IslandChannel *channel) {
+    auto &gen = ga_obj.last_generation;
+
+    // 按第一个目标排序后均匀挑选，覆盖整个前沿，没有仿真过的个体不迁出
+    std::vector<unsigned int> best;
+    for (unsigned int i : gen.fronts[0]) {
+        if (!gen.chromosomes[i].middle_costs.screened)
+            best.push_back(i);
+    }
+    std::sort(best.begin(), best.end(), [&gen](unsigned int a, unsigned int b) {
+        return gen.chromosomes[a].objectives < gen.chromosomes[b].objectives;
+    });
+    const int n_send = std::min((int)best.size(), ga_cfg_.island_migrants);
+    const int next   = (channel->GetIsland() + 1) % channel->GetIslandNum();
+    for (int k = 0; k < n_send; ++k) {
+        const auto &c = gen.chromosomes[best[(size_t)k * best.size() / n_send]];
+        channel->Send(next, EncodeMember(kIslandMigrant, channel->GetIsland(), {c.genes, c.middle_costs, c.objectives}),
+                      false);
+    }
+
+    // 从最后一个前沿开始替换，之后是第一个前沿中拥挤距离最小的个体，保留前沿的两端
+    std::vector<unsigned int> victims;
+    for (size_t f = gen.fronts.size() - 1; f > 0; --f)
+        victims.insert(victims.end(), gen.fronts[f].begin(), gen.fronts[f].end());
+    std::vector<unsigned int> front = gen.fronts[0];
+    std::sort(front.begin(), front.end(), [&gen](unsigned int a, unsigned int b) {
+        return gen.chromosomes[a].objectives < gen.chromosomes[b].objectives;
+    });
+    if (front.size() > 2) {
+        const auto &                                 lo = gen.chromosomes[front.front()].objectives;
+        const auto &                                 hi = gen.chromosomes[front.back()].objectives;
+        std::vector<std::pair<double, unsigned int>> crowding;
+        for (size_t k = 1; k + 1 < front.size(); ++k) {
+            const auto &prev = gen.chromosomes[front[k - 1]].objectives;
+            const auto &next = gen.chromosomes[front[k + 1]].objectives;
+            double      d    = 0.0;
+            for (size_t o = 0; o < prev.size(); ++o)
+                d += std::abs(next[o] - prev[o]) / std::max(std::abs(hi[o] - lo[o]), 1e-12);
+            crowding.push_back({d, front[k]});
+        }
+        std::sort(crowding.begin(), crowding.end());
+        for (const auto &c : crowding)
+            victims.push_back(c.second);
+    }
+
+    // 先结束的岛屿的前沿和结束消息可能在迁移时收到，保留下来由GatherFronts处理
+    std::vector<char> msg;
+    size_t            n_replaced = 0;
+    int               n_dropped  = 0;
+    while (channel->Recv(&msg, 0)) {
+        int         type, from, n_sim;
+        FrontMember m;
+        if (!DecodeMember(msg, &type, &from, &n_sim, &m))
+            continue;
+        if (type == kIslandFront || type == kIslandDone) {
+            island_backlog_.push_back(msg);
+            continue;
+        }
+        if (type != kIslandMigrant)
+            continue;
+        if (n_replaced >= victims.size()) {
+            ++n_dropped;
+            continue;
+        }
+        auto &c        = gen.chromosomes[victims[n_replaced++]];
+        c.genes        = m.genes;
+        c.middle_costs = m.cost;
+        c.objectives   = m.objectives;
+    }
+
+    // 下一代按last_generation的前沿和选择概率挑选父代
+    if (n_replaced > 0)
+        ga_obj.rank_population(gen);
+    if (n_dropped > 0) {
+        std::cout << "Island " << channel->GetIsland() << " dropped " << n_dropped << " migrants, no member to replace"
+                  << std::endl;
+    }
+}
+
+template <typename SimType>
+std::vector<typename OpengaAdapter<SimType>::FrontMember> OpengaAdapter<SimType>::GatherFronts(
+    const std::vector<FrontMember> &front, IslandChannel *channel, const std::vector<int> &children) {
+    std::vector<FrontMember> merged = front;
+    std::vector<bool>        done(children.size() + 1, false);
+    std::vector<int>         n_member(children.size() + 1, 0);
+    size_t                   n_done = 0;
+
+    n_member[0] = front.size();
+    std::reverse(island_backlog_.begin(), island_backlog_.end());
+    while (n_done < children.size()) {
+        std::vector<char> msg;
+        bool              received = !island_backlog_.empty();
+        if (received) {
+            msg = std::move(island_backlog_.back());
+            island_backlog_.pop_back();
+        } else {
+            received = channel->Recv(&msg, 1000);
+        }
+        if (received) {
+            int         type, from, n_sim;
+            FrontMember m;
+            if (!DecodeMember(msg, &type, &from, &n_sim, &m) || from <= 0 || from > (int)children.size())
+                continue;
+            if (type == kIslandFront) {
+                merged.push_back(m);
+                ++n_member[from];
+            } else if (type == kIslandDone && !done[from]) {
+                done[from] = true;
+                n_simulated_ += n_sim;
+                ++n_done;
+            }
+            continue;
+        }
+        // 队列为空时检查是否有岛屿异常退出，正常退出的岛屿在退出前已经送达了全部消息
+        for (size_t i = 0; i < children.size(); ++i) {
+            if (!done[i + 1] && waitpid(children[i], nullptr, WNOHANG) == children[i]) {
+                std::cout << "Island " << i + 1 << " exited without result" << std::endl;
+                done[i + 1] = true;
+                ++n_done;
+            }
+        }
+    }
+    for (int pid : children)
+        waitpid(pid, nullptr, 0);
+
+    // 每个岛屿的前沿至少有一个个体，没有收到说明消息丢失了
+    for (size_t i = 0; i < n_member.size(); ++i) {
+        if (n_member[i] == 0)
+            std::cout << "Island " << i << " front missing from the merged result" << std::endl;
+    }
+
+    return ReduceToFront(merged, ga_cfg_.population, HypervolumeRef());
+}
+
+template <typename SimType>
+std::vector<typename OpengaAdapter<SimType>::FrontMember> OpengaAdapter<SimType>::OptimizeMoead(void) {
+    Moead<MiddleCost> moead(MakeProblem(true), ga_cfg_.moead);
+    return moead.Solve(HypervolumeRef());
+}
+
+template <typename SimType>
+std::vector<typename OpengaAdapter<SimType>::FrontMember> OpengaAdapter<SimType>::OptimizeMoCmaes(void) {
+    // 被筛掉的后代会被当作失败而缩小步长，因此不使用代理模型
+    MoCmaes<MiddleCost> cmaes(MakeProblem(false), ga_cfg_.mocmaes);
+    return cmaes.Solve(HypervolumeRef());
+}
+
+template <typename SimType>
+OptProblem<typename OpengaAdapter<SimType>::MiddleCost> OpengaAdapter<SimType>::MakeProblem(bool allow_screen) {
+    using namespace std::placeholders;
+
+    OptProblem<MiddleCost> prob;
+    prob.dim                = param_len_;
+    prob.population         = ga_cfg_.population;
+    prob.generation_max     = ga_cfg_.generation_max;
+    prob.thread_num         = ga_cfg_.thread_num;
+    prob.random_seed        = ga_cfg_.random_seed;
+    prob.crossover_fraction = ga_cfg_.crossover_fraction;
+    prob.mutation_rate      = ga_cfg_.mutation_rate;
+
+    prob.eval_batch = [this, allow_screen](const std::vector<const ParamSeq *> &seqs, std::vector<MiddleCost> *c) {
+        return EvalParamSeqBatch(seqs, allow_screen, c);
+    };
+    prob.objectives = std::bind(&OpengaAdapter<SimType>::CostToObjectives, this, _1);
+    prob.init       = std::bind(&OpengaAdapter<SimType>::InitParamSeq, this, _1, _2);
+    prob.mutate     = std::bind(&OpengaAdapter<SimType>::Mutate, this, _1, _2, _3);
+    prob.crossover  = std::bind(&OpengaAdapter<SimType>::Crossover, this, _1, _2, _3);
+    prob.report     = std::bind(&OpengaAdapter<SimType>::OnGeneration, this, _1, _2);
+
+    // 整数基因在[0,1]中按档位均匀分布
+    prob.from_unit = [this](const std::vector<double> &x) {
+        ParamSeq p(param_len_);
+        for (int i = 0; i < param_len_; ++i) {
+            const double v = std::min(std::max(x[i], 0.0), 1.0);
+            p[i]           = ga_cfg_.integer_genome ? std::round(v * (GeneLevelNum(param_desc_[i]) - 1)) : v;
+        }
+        return p;
+    };
+    prob.to_unit = [this](const ParamSeq &p) {
+        std::vector<double> x(param_len_);
+        for (int i = 0; i < param_len_; ++i) {
+            const int n = GeneLevelNum(param_desc_[i]);
+            x[i]        = ga_cfg_.integer_genome ? ((n > 1) ? p[i] / (n - 1) : 0.0) : p[i];
+        }
+        return x;
+    };
+    return prob;
+}
+
+template <typename SimType>
+std::vector<typename OpengaAdapter<SimType>::FrontMember> OpengaAdapter<SimType>::LocalSearch(
+    const std::vector<FrontMember> &front) {
+    std::vector<FrontMember>      archive = front;
+    std::set<std::vector<int>>    visited;
+    std::vector<std::vector<int>> expand;
+
+    for (const auto &m : archive) {
+        auto levels = GenesToLevels(m.genes);
+        visited.insert(levels);
+        expand.push_back(levels);
+    }
+
+    std::mt19937_64 rng(ga_cfg_.random_seed);
+
+    int n_evaluated = 0;
+    for (int round = 0; round < ga_cfg_.local_search_rounds && !expand.empty(); ++round) {
+        // 每个待展开成员的每个参数加减一档，例如hispeed_freq相邻的频点，target_loads[i]加减1
+        std::vector<std::vector<int>> neighbours;
+        for (const auto &levels : expand) {
+            for (int i = 0; i < param_len_; ++i) {
+                const int n = GeneLevelNum(param_desc_[i]);
+                for (int dir : {-1, 1}) {
+                    auto nb = levels;
+                    nb[i] += dir;
+                    if (nb[i] < 0 || nb[i] >= n || visited.count(nb))
+                        continue;
+                    visited.insert(nb);
+                    neighbours.push_back(nb);
+                }
+            }
+        }
+
+        // 超出评估预算时随机保留一部分邻居
+        const int budget = ga_cfg_.local_search_max_eval - n_evaluated;
+        if ((int)neighbours.size() > budget) {
+            std::shuffle(neighbours.begin(), neighbours.end(), rng);
+            neighbours.resize(std::max(budget, 0));
+        }
+
+        // 分批在多个线程中评估
+        std::vector<FrontMember>      evaluated(neighbours.size());
+        std::vector<const ParamSeq *> genes;
+        for (size_t i = 0; i < neighbours.size(); ++i) {
+            evaluated[i].genes = LevelsToGenes(neighbours[i]);
+            genes.push_back(&evaluated[i].genes);
+        }
+        std::vector<MiddleCost> costs(neighbours.size());
+        std::vector<char>       feasible = EvalParamSeqBatch(genes, false, &costs);
+        for (size_t i = 0; i < evaluated.size(); ++i) {
+            evaluated[i].cost       = costs[i];
+            evaluated[i].objectives = CostToObjectives(costs[i]);
+        }
+        n_evaluated += neighbours.size();
+
+        // 先用当前前沿过滤，剩下的少量候选再与前沿合并求非支配集
+        std::vector<FrontMember> merged = archive;
+        const size_t             n_old  = merged.size();
+        for (size_t i = 0; i < evaluated.size(); ++i) {
+            if (!feasible[i])
+                continue;
+            const auto &obj       = evaluated[i].objectives;
+            bool        dominated = false;
+            for (const auto &m : archive) {
+                if (Dominates(m.objectives, obj) || m.objectives == obj) {
+                    dominated = true;
+                    break;
+                }
+            }
+            if (!dominated)
+                merged.push_back(evaluated[i]);
+        }
+
+        archive.clear();
+        expand.clear();
+        for (size_t i = 0; i < merged.size(); ++i) {
+            bool dominated = false;
+            for (size_t j = 0; j < merged.size() && !dominated; ++j)
+                dominated = Dominates(merged[j].objectives, merged[i].objectives);
+            if (dominated)
+                continue;
+            archive.push_back(merged[i]);
+            if (i >= n_old)
+                expand.push_back(GenesToLevels(merged[i].genes));
+        }
+    }
+
+    std::cout << "Local search evaluated " << n_evaluated << " neighbours, front " << front.size() << " -> "
+              << archive.size() << std::endl;
+    return archive;
+}
+
+template <typename SimType>
+std::vector<typename OpengaAdapter<SimType>::Result> OpengaAdapter<SimType>::Evaluate(
+    const std::vector<typename SimType::Tunables> &tunables) {
+    std::vector<Result> ret(tunables.size());
+    EvaluateEach(tunables, [&](int idx, const Result &r) { ret[idx] = r; });
+    return ret;
+}
+
+template <typename SimType>
+void OpengaAdapter<SimType>::EvaluateEach(const std::vector<typename SimType::Tunables> &tunables,
+                                          const std::function<void(int, const Result &)> &on_done) {
+    ParallelFor(tunables.size(), ga_cfg_.thread_num, [&](int idx) {
+        MiddleCost cost;
+        Result     r;
+        r.tunable = tunables[idx];
+        if (apps_.empty())
+            r.feasible = EvalTunables(r.tunable, cost);
+        else
+            r.feasible = EvalTunablesPerApp(r.tunable, cost, &r.per_app);
+        r.score.performance  = cost.c1;
+        r.score.battery_life = cost.c2;
+        r.score.idle_lasting = cost.c3;
+        on_done(idx, r);
+    });
+}
 
+// 量化的取值换回基因后与本地优化走同一条评估路径，工作进程自己的缓存和成组仿真设置同样生效
+template <typename SimType>
+void OpengaAdapter<SimType>::ServeFarm(const std::string &host, int port) {
     std::cout << "\nTarget: " << soc_->name_ << std::endl;
-    std::cout << "Chromosome length: " << param_len_ << std::endl;
+    RunFarmWorker(host, port, FarmContext(),
+                  [this](const std::vector<std::vector<int>> &values, std::vector<FarmCost> *costs) {
+                      const int                     n = values.size();
+                      std::vector<ParamSeq>         seqs;
+                      std::vector<const ParamSeq *> ptrs;
+                      for (const auto &q : values)
+                          seqs.push_back(QuantizedToGenes(q));
+                      for (const auto &s : seqs)
+                          ptrs.push_back(&s);
+
+                      std::vector<MiddleCost> results(n);
+                      const auto              pass = EvalParamSeqBatch(ptrs, false, &results);
+                      for (int i = 0; i < n; ++i)
+                          (*costs)[i] = {results[i].c1, results[i].c2, results[i].c3, pass[i] != 0, false};
+                  });
+}
 
-    ga_obj.solve();
+template <typename SimType>
+std::vector<std::string> OpengaAdapter<SimType>::GetAppNames(void) const {
+    std::vector<std::string> names;
+    for (const auto &app : apps_)
+        names.push_back(app->src_.empty() ? app->workload_file_ : app->src_[0]);
+    return names;
+}
 
-    std::cout << "\nOptimized in " << timer.toc() << " seconds." << std::endl;
+template <typename SimType>
+std::vector<typename OpengaAdapter<SimType>::GeneEffect> OpengaAdapter<SimType>::Screen(void) {
+    EA::Chronometer timer;
+    timer.tic();
 
-    std::vector<Result> ret;
-    ret.reserve(ga_obj.last_generation.fronts[0].size());
-    auto paretofront_indices = ga_obj.last_generation.fronts[0];
-    for (const auto &i : paretofront_indices) {
-        Result      r;
-        const auto &chromosome = ga_obj.last_generation.chromosomes[i];
-        r.tunable              = TranslateParamSeq(chromosome.genes);
-        r.score.performance    = chromosome.middle_costs.c1;
-        r.score.battery_life   = chromosome.middle_costs.c2;
-        r.score.idle_lasting   = chromosome.middle_costs.c3;
-        ret.push_back(r);
+    // Morris设计，每条轨迹从p档网格上的随机点出发，按随机顺序每次只改变一个参数delta
+    const int    n_traj  = screen_trajectories_;
+    const int    n_grid  = screen_levels_;
+    const int    n_step  = param_len_;
+    const double delta   = n_grid / (2.0 * (n_grid - 1));
+    const auto   to_lvls = [&](const std::vector<double> &x) {
+        std::vector<int> levels(param_len_);
+        for (int i = 0; i < param_len_; ++i) {
+            const int n = GeneLevelNum(param_desc_[i]);
+            levels[i]   = std::min((int)std::round(x[i] * (n - 1)), n - 1);
+        }
+        return levels;
+    };
+
+    std::mt19937                       rng(ga_cfg_.random_seed);
+    std::uniform_int_distribution<int> grid_dist(0, n_grid - 1);
+    std::vector<std::vector<int>>      levels;  // [轨迹 * (n_step + 1) + 步]
+    std::vector<int>                   moved;   // 每一步改变的参数
+    for (int t = 0; t < n_traj; ++t) {
+        std::vector<double> x(param_len_);
+        for (auto &v : x)
+            v = (double)grid_dist(rng) / (n_grid - 1);
+        std::vector<int> order(param_len_);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), rng);
+
+        levels.push_back(to_lvls(x));
+        for (int i : order) {
+            x[i] = (x[i] + delta <= 1.0) ? x[i] + delta : x[i] - delta;
+            levels.push_back(to_lvls(x));
+            moved.push_back(i);
+        }
     }
 
-    return ret;
+    // 所有点一起评估，经过缓存和成组仿真，不使用代理模型筛选
+    std::vector<ParamSeq> seqs;
+    for (const auto &l : levels)
+        seqs.push_back(LevelsToGenes(l));
+    std::vector<const ParamSeq *> ptrs;
+    for (const auto &s : seqs)
+        ptrs.push_back(&s);
+    std::vector<MiddleCost> costs(seqs.size());
+    EvalParamSeqBatch(ptrs, false, &costs);
+
+    // 基本效应按参数实际变化的比例计算，档位少的参数取整后可能没有变化，跳过
+    std::vector<GeneEffect>            effects(param_len_);
+    std::vector<std::array<double, 3>> sum(param_len_), sum_abs(param_len_), sum_sq(param_len_);
+    std::vector<int>                   n_effect(param_len_, 0);
+    for (int t = 0; t < n_traj; ++t) {
+        for (int s = 0; s < n_step; ++s) {
+            const int   i    = moved[t * n_step + s];
+            const auto &from = levels[t * (n_step + 1) + s];
+            const auto &to   = levels[t * (n_step + 1) + s + 1];
+            const double d   = GeneLevelToRatio(param_desc_[i], to[i]) - GeneLevelToRatio(param_desc_[i], from[i]);
+            if (d == 0.0)
+                continue;
+            const auto & a     = costs[t * (n_step + 1) + s];
+            const auto & b     = costs[t * (n_step + 1) + s + 1];
+            const double ee[3] = {(b.c1 - a.c1) / d, (b.c2 - a.c2) / d, (b.c3 - a.c3) / d};
+            for (int k = 0; k < 3; ++k) {
+                sum[i][k] += ee[k];
+                sum_abs[i][k] += std::fabs(ee[k]);
+                sum_sq[i][k] += ee[k] * ee[k];
+            }
+            ++n_effect[i];
+        }
+    }
+
+    double max_mu[3] = {0.0, 0.0, 0.0};
+    for (int i = 0; i < param_len_; ++i) {
+        GeneEffect &e = effects[i];
+        e.name        = param_desc_[i].name;
+        e.pin_value   = GeneLevelValue(param_desc_[i], GeneLevelNum(param_desc_[i]) / 2);
+        for (int k = 0; k < 3; ++k) {
+            const int    n    = std::max(1, n_effect[i]);
+            const double mean = sum[i][k] / n;
+            e.mu_star[k]      = sum_abs[i][k] / n;
+            e.sigma[k]        = std::sqrt(std::max(0.0, sum_sq[i][k] / n - mean * mean));
+            max_mu[k]         = std::max(max_mu[k], e.mu_star[k]);
+        }
+    }
+    for (auto &e : effects) {
+        e.influence = 0.0;
+        for (int k = 0; k < 3; ++k) {
+            if (max_mu[k] > 0.0)
+                e.influence = std::max(e.influence, e.mu_star[k] / max_mu[k]);
+        }
+        e.insensitive = e.influence < screen_threshold_;
+    }
+    std::stable_sort(effects.begin(), effects.end(),
+                     [](const GeneEffect &a, const GeneEffect &b) { return a.influence > b.influence; });
+
+    std::cout << "Screened " << param_len_ << " parameters with " << seqs.size() << " evaluations ("
+              << n_simulated_ << " simulated) in " << timer.toc() << " seconds." << std::endl;
+    return effects;
 }
 
 int Quantify(double ratio, const ParamDescElement &desc) {
@@ -309,6 +1807,107 @@ int QuatLargeParam(double ratio, int step, const ParamDescElement &desc) {
     return (Quantify(ratio, desc) / step) * step;
 }
 
+// 频率参数经过QuatFreqParam向下取到频点，整数模式下直接以范围内的频点为档位
+ParamDescElement FreqParamDesc(const Cluster &cluster, int range_start, int range_end, const std::string &name) {
+    ParamDescElement desc = {range_start, range_end, {}, name};
+
+    const int lowest = cluster.freq_floor_to_opp(range_start);
+    for (const auto &opp : cluster.model_.opp_model) {
+        if (opp.freq >= lowest && opp.freq <= range_end)
+            desc.levels.push_back(opp.freq);
+    }
+    return desc;
+}
+
+// 参数经过QuatLargeParam按@step向下取整，整数模式下以@step的倍数为档位
+ParamDescElement StepParamDesc(const ParamDescElement &range, int step) {
+    ParamDescElement desc = range;
+    for (int v = range.range_start / step * step; v <= range.range_end; v += step)
+        desc.levels.push_back(v);
+    return desc;
+}
+
+// 时长类参数以10ms为单位，仿真时取整到20ms的timer_rate
+int RoundTimerTicks(int v) {
+    const double timer_quantum = 2;  // timer_rate 固定为20ms
+    return std::max(1.0, std::round(v / timer_quantum));
+}
+
+// 时长类参数经过RoundTimerTicks取整，整数模式下每个取整结果只保留最小的取值为档位，相邻档位的仿真结果不同
+ParamDescElement TimeParamDesc(const ParamDescElement &range) {
+    ParamDescElement desc = range;
+    for (int v = range.range_start; v <= range.range_end; ++v) {
+        if (desc.levels.empty() || RoundTimerTicks(v) != RoundTimerTicks(desc.levels.back()))
+            desc.levels.push_back(v);
+    }
+    return desc;
+}
+
+// 按集群展开的参数名加上集群序号，@idx不小于0时再加上数组下标
+ParamDescElement ClusterParamDesc(const ParamDescElement &range, int cluster_idx, int idx = -1) {
+    ParamDescElement desc = range;
+    desc.name             = "c" + std::to_string(cluster_idx) + "." + range.name;
+    if (idx >= 0)
+        desc.name += "[" + std::to_string(idx) + "]";
+    return desc;
+}
+
+template <typename SimType>
+void OpengaAdapter<SimType>::StepGene(ParamSeq &p, int idx, int dir) const {
+    const int n   = GeneLevelNum(param_desc_[idx]);
+    int       val = (int)p[idx] + dir;
+    if (val < 0 || val >= n)
+        val = (int)p[idx] - dir;
+    p[idx] = std::min(std::max(val, 0), n - 1);
+}
+
+// 在归一化的档位上做多项式变异后取整，取整后没有变化的基因至少变化一档，保证后代与父代不同
+template <typename SimType>
+ParamSeq OpengaAdapter<SimType>::MutateInteger(const ParamSeq &X_base, const RandomFunc &rnd01) {
+    const int size = X_base.size();
+    ParamSeq  ret  = X_base;
+
+    for (int idx = 0; idx < size; ++idx) {
+        const int n = GeneLevelNum(param_desc_[idx]);
+        if (rnd01() >= 0.5 || n < 2)
+            continue;
+
+        const double x = X_base[idx] / (n - 1);
+        const double y = PolyMutateGene(x, eta_, rnd01);
+        ret[idx]       = std::round(y * (n - 1));
+        if (ret[idx] == X_base[idx])
+            StepGene(ret, idx, (y >= x) ? 1 : -1);
+    }
+
+    if (ret == X_base) {
+        const int idx = std::min((int)(rnd01() * size), size - 1);
+        StepGene(ret, idx, (rnd01() < 0.5) ? 1 : -1);
+    }
+    return ret;
+}
+
+// 在归一化的档位上做SBX后取整，与任一父代相同时随机挑选基因变化一档直到不同
+template <typename SimType>
+ParamSeq OpengaAdapter<SimType>::CrossoverInteger(const ParamSeq &X1, const ParamSeq &X2, const RandomFunc &rnd01) {
+    const int size = X1.size();
+    ParamSeq  ret  = X1;
+
+    for (int idx = 0; idx < size; ++idx) {
+        const int n = GeneLevelNum(param_desc_[idx]);
+        if (rnd01() >= 0.5 || X1[idx] == X2[idx])
+            continue;
+
+        const double c = SbxGene(X1[idx] / (n - 1), X2[idx] / (n - 1), eta_, rnd01);
+        ret[idx]       = std::round(c * (n - 1));
+    }
+
+    for (int n_try = 0; (ret == X1 || ret == X2) && n_try < 4 * size; ++n_try) {
+        const int idx = std::min((int)(rnd01() * size), size - 1);
+        StepGene(ret, idx, (rnd01() < 0.5) ? 1 : -1);
+    }
+    return ret;
+}
+
 template <typename T>
 void DefineBlock(ParamDesc &desc, const ParamDescCfg &p, const Soc *soc) {
     return;
@@ -319,25 +1918,58 @@ T TranslateBlock(ParamSeq::const_iterator &it_seq, ParamDesc::const_iterator &it
     return T();
 }
 
+// 频点表按分段常数编码的调速器参数，没有频点表的类型与DefineBlock相同
+template <typename T>
+void DefineGearBlock(ParamDesc &desc, const ParamDescCfg &p, const Soc *soc) {
+    DefineBlock<T>(desc, p, soc);
+}
+
+template <typename T>
+T TranslateGearBlock(ParamSeq::const_iterator &it_seq, ParamDesc::const_iterator &it_desc, const Soc *soc,
+                     const GearCfg &gear) {
+    return TranslateBlock<T>(it_seq, it_desc, soc);
+}
+
+// 时长类参数取整到一个timer_rate
+void RoundGovernorTimes(GovernorTs<Interactive> &t, const Soc *soc) {
+    int idx = 0;
+    for (const auto &cluster : soc->clusters_) {
+        auto &tunable = t.t[idx];
+
+        tunable.min_sample_time     = RoundTimerTicks(tunable.min_sample_time);
+        tunable.max_freq_hysteresis = RoundTimerTicks(tunable.max_freq_hysteresis);
+
+        int n_opp   = cluster.model_.opp_model.size();
+        int n_above = std::min(ABOVE_DELAY_MAX_LEN, n_opp);
+
+        for (int i = 0; i < n_above; ++i) {
+            tunable.above_hispeed_delay[i] = RoundTimerTicks(tunable.above_hispeed_delay[i]);
+        }
+        idx++;
+    }
+}
+
 template <>
 void DefineBlock<GovernorTs<Interactive>>(ParamDesc &desc, const ParamDescCfg &p, const Soc *soc) {
+    int idx = 0;
     for (const auto &cluster : soc->clusters_) {
-        ParamDescElement hispeed_freq_desc = {cluster.model_.min_freq, cluster.model_.max_freq};
-        desc.push_back(hispeed_freq_desc);
-        desc.push_back(p.go_hispeed_load);
-        desc.push_back(p.min_sample_time);
-        desc.push_back(p.max_freq_hysteresis);
+        auto hispeed_freq = FreqParamDesc(cluster, cluster.model_.min_freq, cluster.model_.max_freq, "hispeed_freq");
+        desc.push_back(ClusterParamDesc(hispeed_freq, idx));
+        desc.push_back(ClusterParamDesc(p.go_hispeed_load, idx));
+        desc.push_back(ClusterParamDesc(TimeParamDesc(p.min_sample_time), idx));
+        desc.push_back(ClusterParamDesc(TimeParamDesc(p.max_freq_hysteresis), idx));
 
         int n_opp         = cluster.model_.opp_model.size();
         int n_above       = std::min(ABOVE_DELAY_MAX_LEN, n_opp);
         int n_targetloads = std::min(TARGET_LOAD_MAX_LEN, n_opp);
 
         for (int i = 0; i < n_above; ++i) {
-            desc.push_back(p.above_hispeed_delay);
+            desc.push_back(ClusterParamDesc(TimeParamDesc(p.above_hispeed_delay), idx, i));
         }
         for (int i = 0; i < n_targetloads; ++i) {
-            desc.push_back(p.target_loads);
+            desc.push_back(ClusterParamDesc(p.target_loads, idx, i));
         }
+        idx++;
     }
 }
 
@@ -366,25 +1998,98 @@ GovernorTs<Interactive> TranslateBlock(ParamSeq::const_iterator &it_seq, ParamDe
         idx++;
     }
 
-    // 时长类参数取整到一个timer_rate
-    idx = 0;
+    RoundGovernorTimes(t, soc);
+    return t;
+}
+
+// 一个频点表的分段数，表长为1时只有第0段
+int GearNum(const GearCfg &gear, int n_table) {
+    return std::max(1, std::min(gear.breakpoints, n_table));
+}
+
+// 第0段从频点0开始，只有取值基因，之后每段依次为起始频点序号和取值
+void DefineGearTable(ParamDesc &desc, const ParamDescElement &value, int cluster_idx, int n_table,
+                     const GearCfg &gear) {
+    const ParamDescElement named = ClusterParamDesc(value, cluster_idx);
+    for (int k = 0; k < GearNum(gear, n_table); ++k) {
+        if (k > 0) {
+            ParamDescElement at = {1, n_table - 1, {}, named.name + ".at" + std::to_string(k)};
+            desc.push_back(at);
+        }
+        ParamDescElement v = named;
+        v.name += ".gear" + std::to_string(k);
+        desc.push_back(v);
+    }
+}
+
+// 各段按起始频点排序，每个频点取起始频点不大于它的最后一段的取值，@quat为取值的量化方式
+template <typename Quat>
+void TranslateGearTable(ParamSeq::const_iterator &it_seq, ParamDesc::const_iterator &it_desc, int n_table,
+                        const GearCfg &gear, const Quat &quat, uint8_t *table) {
+    std::pair<int, int> gears[TARGET_LOAD_MAX_LEN > ABOVE_DELAY_MAX_LEN ? TARGET_LOAD_MAX_LEN : ABOVE_DELAY_MAX_LEN];
+
+    const int n_gear = GearNum(gear, n_table);
+    for (int k = 0; k < n_gear; ++k) {
+        const int at = (k > 0) ? Quantify(*it_seq++, *it_desc++) : 0;
+        gears[k]     = {at, quat(*it_seq++, *it_desc++)};
+    }
+    // 起始频点相同时序号大的段覆盖前面的段
+    std::stable_sort(gears, gears + n_gear,
+                     [](const std::pair<int, int> &a, const std::pair<int, int> &b) { return a.first < b.first; });
+
+    int k = 0;
+    for (int i = 0; i < n_table; ++i) {
+        while (k + 1 < n_gear && gears[k + 1].first <= i)
+            ++k;
+        table[i] = gears[k].second;
+        if (gear.monotone && i > 0)
+            table[i] = std::max(table[i], table[i - 1]);
+    }
+}
+
+template <>
+void DefineGearBlock<GovernorTs<Interactive>>(ParamDesc &desc, const ParamDescCfg &p, const Soc *soc) {
+    int idx = 0;
     for (const auto &cluster : soc->clusters_) {
-        auto & tunable       = t.t[idx];
-        double timer_quantum = 2;  // timer_rate 固定为20ms
+        auto hispeed_freq = FreqParamDesc(cluster, cluster.model_.min_freq, cluster.model_.max_freq, "hispeed_freq");
+        desc.push_back(ClusterParamDesc(hispeed_freq, idx));
+        desc.push_back(ClusterParamDesc(p.go_hispeed_load, idx));
+        desc.push_back(ClusterParamDesc(TimeParamDesc(p.min_sample_time), idx));
+        desc.push_back(ClusterParamDesc(TimeParamDesc(p.max_freq_hysteresis), idx));
 
-        tunable.min_sample_time     = std::max(1.0, std::round(tunable.min_sample_time / timer_quantum));
-        tunable.max_freq_hysteresis = std::max(1.0, std::round(tunable.max_freq_hysteresis / timer_quantum));
+        int n_opp         = cluster.model_.opp_model.size();
+        int n_above       = std::min(ABOVE_DELAY_MAX_LEN, n_opp);
+        int n_targetloads = std::min(TARGET_LOAD_MAX_LEN, n_opp);
 
-        int n_opp   = cluster.model_.opp_model.size();
-        int n_above = std::min(ABOVE_DELAY_MAX_LEN, n_opp);
+        DefineGearTable(desc, TimeParamDesc(p.above_hispeed_delay), idx, n_above, p.gear);
+        DefineGearTable(desc, p.target_loads, idx, n_targetloads, p.gear);
+        idx++;
+    }
+}
 
-        for (int i = 0; i < n_above; ++i) {
-            tunable.above_hispeed_delay[i] = std::max(1.0, std::round(tunable.above_hispeed_delay[i] / timer_quantum));
-        }
+template <>
+GovernorTs<Interactive> TranslateGearBlock(ParamSeq::const_iterator &it_seq, ParamDesc::const_iterator &it_desc,
+                                           const Soc *soc, const GearCfg &gear) {
+    GovernorTs<Interactive> t;
+
+    int idx = 0;
+    for (const auto &cluster : soc->clusters_) {
+        t.t[idx].hispeed_freq        = QuatFreqParam(*it_seq++, cluster, *it_desc++);
+        t.t[idx].go_hispeed_load     = QuatLoadParam(*it_seq++, *it_desc++);
+        t.t[idx].min_sample_time     = Quantify(*it_seq++, *it_desc++);
+        t.t[idx].max_freq_hysteresis = Quantify(*it_seq++, *it_desc++);
+
+        int n_opp         = cluster.model_.opp_model.size();
+        int n_above       = std::min(ABOVE_DELAY_MAX_LEN, n_opp);
+        int n_targetloads = std::min(TARGET_LOAD_MAX_LEN, n_opp);
+
+        TranslateGearTable(it_seq, it_desc, n_above, gear, Quantify, t.t[idx].above_hispeed_delay);
+        TranslateGearTable(it_seq, it_desc, n_targetloads, gear, QuatLoadParam, t.t[idx].target_loads);
         idx++;
     }
 
-    return std::move(t);
+    RoundGovernorTimes(t, soc);
+    return t;
 }
 
 template <>
@@ -397,22 +2102,66 @@ void DefineBlock<WaltHmp::Tunables>(ParamDesc &desc, const ParamDescCfg &p, cons
     desc.push_back(p.timer_rate);
 }
 
+// 参数之间的约束，TranslateBlock和按名称修改参数后都要满足，参数被修改时返回true
+template <typename T>
+bool ConstrainBlock(T *t, const Soc *soc) {
+    return false;
+}
+
+template <>
+bool ConstrainBlock<WaltHmp::Tunables>(WaltHmp::Tunables *t, const Soc *soc) {
+    int down = t->sched_downmigrate;
+    int up   = std::max(t->sched_downmigrate, t->sched_upmigrate);
+    // sdm625和sdm820使用平衡型负载迁移
+    if (soc->clusters_.size() < 2 || soc->clusters_[soc->GetLittleClusterIdx()].model_.core_num == 2) {
+        down = 45;
+        up   = 45;
+    }
+    const bool changed   = (down != t->sched_downmigrate) || (up != t->sched_upmigrate);
+    t->sched_downmigrate = down;
+    t->sched_upmigrate   = up;
+    return changed;
+}
+
+template <>
+bool ConstrainBlock<PeltHmp::Tunables>(PeltHmp::Tunables *t, const Soc *soc) {
+    const bool changed = t->up_threshold < t->down_threshold;
+    t->up_threshold    = std::max(t->down_threshold, t->up_threshold);
+    return changed;
+}
+
+template <typename T>
+bool ConstrainUperfBlock(T *t, const Soc *soc) {
+    bool changed = t->sched_up < t->sched_down;
+    t->sched_up  = std::max(t->sched_down, t->sched_up);
+    for (int idx = 0; idx < (int)soc->clusters_.size(); ++idx) {
+        changed |= t->max_freq[idx] < t->min_freq[idx];
+        t->max_freq[idx] = std::max(t->min_freq[idx], t->max_freq[idx]);
+    }
+    return changed;
+}
+
+template <>
+bool ConstrainBlock<UperfBoostWalt::Tunables>(UperfBoostWalt::Tunables *t, const Soc *soc) {
+    return ConstrainUperfBlock(t, soc);
+}
+
+template <>
+bool ConstrainBlock<UperfBoostPelt::Tunables>(UperfBoostPelt::Tunables *t, const Soc *soc) {
+    return ConstrainUperfBlock(t, soc);
+}
+
 template <>
 WaltHmp::Tunables TranslateBlock(ParamSeq::const_iterator &it_seq, ParamDesc::const_iterator &it_desc, const Soc *soc) {
     WaltHmp::Tunables t;
     t.sched_downmigrate         = QuatLoadParam(*it_seq++, *it_desc++);
     t.sched_upmigrate           = QuatLoadParam(*it_seq++, *it_desc++);
-    t.sched_upmigrate           = std::max(t.sched_downmigrate, t.sched_upmigrate);
     t.sched_ravg_hist_size      = Quantify(*it_seq++, *it_desc++);
     t.sched_window_stats_policy = Quantify(*it_seq++, *it_desc++);
     t.sched_boost               = Quantify(*it_seq++, *it_desc++);
     t.timer_rate                = Quantify(*it_seq++, *it_desc++);
-    // sdm625和sdm820使用平衡型负载迁移
-    if (soc->clusters_.size() < 2 || soc->clusters_[soc->GetLittleClusterIdx()].model_.core_num == 2) {
-        t.sched_downmigrate = 45;
-        t.sched_upmigrate   = 45;
-    }
-    return std::move(t);
+    ConstrainBlock(&t, soc);
+    return t;
 }
 
 template <>
@@ -429,20 +2178,21 @@ PeltHmp::Tunables TranslateBlock(ParamSeq::const_iterator &it_seq, ParamDesc::co
     PeltHmp::Tunables t;
     t.down_threshold     = Quantify(*it_seq++, *it_desc++);
     t.up_threshold       = Quantify(*it_seq++, *it_desc++);
-    t.up_threshold       = std::max(t.down_threshold, t.up_threshold);
     t.load_avg_period_ms = Quantify(*it_seq++, *it_desc++);
     t.boost              = Quantify(*it_seq++, *it_desc++);
     t.timer_rate         = Quantify(*it_seq++, *it_desc++);
-    return std::move(t);
+    ConstrainBlock(&t, soc);
+    return t;
 }
 
 template <>
 void DefineBlock<InputBoostWalt::Tunables>(ParamDesc &desc, const ParamDescCfg &p, const Soc *soc) {
+    int idx = 0;
     for (const auto &cluster : soc->clusters_) {
-        ParamDescElement input_freq = {cluster.model_.min_freq, cluster.model_.max_freq};
-        desc.push_back(input_freq);
+        auto boost_freq = FreqParamDesc(cluster, cluster.model_.min_freq, cluster.model_.max_freq, "boost_freq");
+        desc.push_back(ClusterParamDesc(boost_freq, idx++));
     }
-    desc.push_back(p.input_duration);
+    desc.push_back(StepParamDesc(p.input_duration, 10));
 }
 
 template <>
@@ -455,16 +2205,17 @@ InputBoostWalt::Tunables TranslateBlock(ParamSeq::const_iterator &it_seq, ParamD
         t.boost_freq[idx++] = QuatFreqParam(*it_seq++, cluster, *it_desc++);
     t.duration_quantum = QuatLargeParam(*it_seq++, 10, *it_desc++);
 
-    return std::move(t);
+    return t;
 }
 
 template <>
 void DefineBlock<InputBoostPelt::Tunables>(ParamDesc &desc, const ParamDescCfg &p, const Soc *soc) {
+    int idx = 0;
     for (const auto &cluster : soc->clusters_) {
-        ParamDescElement input_freq = {cluster.model_.min_freq, cluster.model_.max_freq};
-        desc.push_back(input_freq);
+        auto boost_freq = FreqParamDesc(cluster, cluster.model_.min_freq, cluster.model_.max_freq, "boost_freq");
+        desc.push_back(ClusterParamDesc(boost_freq, idx++));
     }
-    desc.push_back(p.input_duration);
+    desc.push_back(StepParamDesc(p.input_duration, 10));
 }
 
 template <>
@@ -477,19 +2228,21 @@ InputBoostPelt::Tunables TranslateBlock(ParamSeq::const_iterator &it_seq, ParamD
         t.boost_freq[idx++] = QuatFreqParam(*it_seq++, cluster, *it_desc++);
     t.duration_quantum = QuatLargeParam(*it_seq++, 10, *it_desc++);
 
-    return std::move(t);
+    return t;
 }
 
 template <>
 void DefineBlock<UperfBoostWalt::Tunables>(ParamDesc &desc, const ParamDescCfg &p, const Soc *soc) {
+    int idx = 0;
     for (const auto &cluster : soc->clusters_) {
         // 最大频率不能限制太多，否则影响突发性能，选择0.7*最大主频和1.2g较高的值
         int max_freq_floor = 0.7 * cluster.model_.max_freq;
         max_freq_floor     = std::min(std::max(1200, max_freq_floor), cluster.model_.max_freq);
-        auto min_range     = ParamDescElement{cluster.model_.min_freq, cluster.model_.max_freq};
-        auto max_range     = ParamDescElement{max_freq_floor, cluster.model_.max_freq};
-        desc.push_back(min_range);
-        desc.push_back(max_range);
+        auto min_range     = FreqParamDesc(cluster, cluster.model_.min_freq, cluster.model_.max_freq, "min_freq");
+        auto max_range     = FreqParamDesc(cluster, max_freq_floor, cluster.model_.max_freq, "max_freq");
+        desc.push_back(ClusterParamDesc(min_range, idx));
+        desc.push_back(ClusterParamDesc(max_range, idx));
+        idx++;
     }
     desc.push_back(p.sched_downmigrate);
     desc.push_back(p.sched_upmigrate);
@@ -505,30 +2258,31 @@ UperfBoostWalt::Tunables TranslateBlock(ParamSeq::const_iterator &it_seq, ParamD
     for (const auto &cluster : soc->clusters_) {
         t.min_freq[idx] = QuatFreqParam(*it_seq++, cluster, *it_desc++);
         t.max_freq[idx] = QuatFreqParam(*it_seq++, cluster, *it_desc++);
-        t.max_freq[idx] = std::max(t.min_freq[idx], t.max_freq[idx]);
         ++idx;
     }
     t.sched_down = Quantify(*it_seq++, *it_desc++);
     t.sched_up   = Quantify(*it_seq++, *it_desc++);
-    t.sched_up   = std::max(t.sched_down, t.sched_up);
+    ConstrainBlock(&t, soc);
     // auto iblk    = TranslateBlock<GovernorTs<Interactive>>(it_seq, it_desc, soc);
     // t.little     = iblk.t[soc->GetLittleClusterIdx()];
     // t.big        = iblk.t[soc->GetBigClusterIdx()];
     t.enabled = true;
 
-    return std::move(t);
+    return t;
 }
 
 template <>
 void DefineBlock<UperfBoostPelt::Tunables>(ParamDesc &desc, const ParamDescCfg &p, const Soc *soc) {
+    int idx = 0;
     for (const auto &cluster : soc->clusters_) {
         // 最大频率不能限制太多，否则影响突发性能，选择0.66*最大主频和1.2g较高的值
         int max_freq_floor = 0.66 * cluster.model_.max_freq;
         max_freq_floor     = std::min(std::max(1200, max_freq_floor), cluster.model_.max_freq);
-        auto min_range     = ParamDescElement{cluster.model_.min_freq, cluster.model_.max_freq};
-        auto max_range     = ParamDescElement{max_freq_floor, cluster.model_.max_freq};
-        desc.push_back(min_range);
-        desc.push_back(max_range);
+        auto min_range     = FreqParamDesc(cluster, cluster.model_.min_freq, cluster.model_.max_freq, "min_freq");
+        auto max_range     = FreqParamDesc(cluster, max_freq_floor, cluster.model_.max_freq, "max_freq");
+        desc.push_back(ClusterParamDesc(min_range, idx));
+        desc.push_back(ClusterParamDesc(max_range, idx));
+        idx++;
     }
     desc.push_back(p.down_threshold);
     desc.push_back(p.up_threshold);
@@ -544,18 +2298,193 @@ UperfBoostPelt::Tunables TranslateBlock(ParamSeq::const_iterator &it_seq, ParamD
     for (const auto &cluster : soc->clusters_) {
         t.min_freq[idx] = QuatFreqParam(*it_seq++, cluster, *it_desc++);
         t.max_freq[idx] = QuatFreqParam(*it_seq++, cluster, *it_desc++);
-        t.max_freq[idx] = std::max(t.min_freq[idx], t.max_freq[idx]);
         ++idx;
     }
     t.sched_down = Quantify(*it_seq++, *it_desc++);
     t.sched_up   = Quantify(*it_seq++, *it_desc++);
-    t.sched_up   = std::max(t.sched_down, t.sched_up);
+    ConstrainBlock(&t, soc);
     // auto iblk    = TranslateBlock<GovernorTs<Interactive>>(it_seq, it_desc, soc);
     // t.little     = iblk.t[soc->GetLittleClusterIdx()];
     // t.big        = iblk.t[soc->GetBigClusterIdx()];
     t.enabled = true;
 
-    return std::move(t);
+    return t;
+}
+
+// 解析"c1.target_loads[3]"形式的参数名，没有集群序号或数组下标时为-1
+bool ParseParamName(const std::string &name, int *cluster_idx, std::string *key, int *idx) {
+    static const std::regex name_re("^(?:c(\\d+)\\.)?(\\w+)(?:\\[(\\d+)\\])?$");
+
+    std::smatch m;
+    if (!std::regex_match(name, m, name_re))
+        return false;
+    *cluster_idx = m[1].matched ? std::stoi(m[1]) : -1;
+    *key         = m[2];
+    *idx         = m[3].matched ? std::stoi(m[3]) : -1;
+    return true;
+}
+
+// 按DefineBlock中的参数名修改参数，@value的单位与parameterRange相同，量化方式与TranslateBlock相同
+template <typename T>
+bool SetNamedParam(T *t, const std::string &name, int value, const Soc *soc) {
+    return false;
+}
+
+template <>
+bool SetNamedParam<GovernorTs<Interactive>>(GovernorTs<Interactive> *t, const std::string &name, int value,
+                                            const Soc *soc) {
+    int         cluster_idx, idx;
+    std::string key;
+    if (!ParseParamName(name, &cluster_idx, &key, &idx) || cluster_idx < 0 ||
+        cluster_idx >= (int)soc->clusters_.size())
+        return false;
+
+    const auto &cluster    = soc->clusters_[cluster_idx];
+    auto &      g          = t->t[cluster_idx];
+    const int   n_opp      = cluster.model_.opp_model.size();
+    const int   time_value = RoundTimerTicks(value);
+
+    // 没有下标时修改整个频点表
+    auto set_table = [idx](uint8_t *table, int n, int v) {
+        if (idx >= n)
+            return false;
+        for (int i = std::max(idx, 0); i < (idx < 0 ? n : idx + 1); ++i)
+            table[i] = v;
+        return true;
+    };
+
+    if (key == "hispeed_freq")
+        g.hispeed_freq = cluster.freq_floor_to_opp(value);
+    else if (key == "go_hispeed_load")
+        g.go_hispeed_load = value;
+    else if (key == "min_sample_time")
+        g.min_sample_time = time_value;
+    else if (key == "max_freq_hysteresis")
+        g.max_freq_hysteresis = time_value;
+    else if (key == "above_hispeed_delay")
+        return set_table(g.above_hispeed_delay, std::min(ABOVE_DELAY_MAX_LEN, n_opp), time_value);
+    else if (key == "target_loads")
+        return set_table(g.target_loads, std::min(TARGET_LOAD_MAX_LEN, n_opp), value);
+    else
+        return false;
+    return true;
+}
+
+template <>
+bool SetNamedParam<WaltHmp::Tunables>(WaltHmp::Tunables *t, const std::string &name, int value, const Soc *soc) {
+    if (name == "sched_downmigrate")
+        t->sched_downmigrate = value;
+    else if (name == "sched_upmigrate")
+        t->sched_upmigrate = value;
+    else if (name == "sched_ravg_hist_size")
+        t->sched_ravg_hist_size = value;
+    else if (name == "sched_window_stats_policy")
+        t->sched_window_stats_policy = value;
+    else if (name == "sched_boost")
+        t->sched_boost = value;
+    else if (name == "timer_rate")
+        t->timer_rate = value;
+    else
+        return false;
+    return true;
+}
+
+template <>
+bool SetNamedParam<PeltHmp::Tunables>(PeltHmp::Tunables *t, const std::string &name, int value, const Soc *soc) {
+    if (name == "down_threshold")
+        t->down_threshold = value;
+    else if (name == "up_threshold")
+        t->up_threshold = value;
+    else if (name == "load_avg_period_ms")
+        t->load_avg_period_ms = value;
+    else if (name == "boost")
+        t->boost = value;
+    else if (name == "timer_rate")
+        t->timer_rate = value;
+    else
+        return false;
+    return true;
+}
+
+template <typename T>
+bool SetNamedInputBoostParam(T *t, const std::string &name, int value, const Soc *soc) {
+    int         cluster_idx, idx;
+    std::string key;
+    if (!ParseParamName(name, &cluster_idx, &key, &idx))
+        return false;
+    if (key == "boost_freq" && cluster_idx >= 0 && cluster_idx < (int)soc->clusters_.size())
+        t->boost_freq[cluster_idx] = soc->clusters_[cluster_idx].freq_floor_to_opp(value);
+    else if (key == "input_duration" && cluster_idx < 0)
+        t->duration_quantum = (value / 10) * 10;
+    else
+        return false;
+    return true;
+}
+
+template <>
+bool SetNamedParam<InputBoostWalt::Tunables>(InputBoostWalt::Tunables *t, const std::string &name, int value,
+                                             const Soc *soc) {
+    return SetNamedInputBoostParam(t, name, value, soc);
+}
+
+template <>
+bool SetNamedParam<InputBoostPelt::Tunables>(InputBoostPelt::Tunables *t, const std::string &name, int value,
+                                             const Soc *soc) {
+    return SetNamedInputBoostParam(t, name, value, soc);
+}
+
+// uperf的迁移阈值在walt和pelt下分别沿用两种调度器的参数名
+template <typename T>
+bool SetNamedUperfParam(T *t, const std::string &name, int value, const Soc *soc, const std::string &down_name,
+                        const std::string &up_name) {
+    int         cluster_idx, idx;
+    std::string key;
+    if (!ParseParamName(name, &cluster_idx, &key, &idx))
+        return false;
+    const bool has_cluster = cluster_idx >= 0 && cluster_idx < (int)soc->clusters_.size();
+    if (key == "min_freq" && has_cluster)
+        t->min_freq[cluster_idx] = soc->clusters_[cluster_idx].freq_floor_to_opp(value);
+    else if (key == "max_freq" && has_cluster)
+        t->max_freq[cluster_idx] = soc->clusters_[cluster_idx].freq_floor_to_opp(value);
+    else if (name == down_name)
+        t->sched_down = value;
+    else if (name == up_name)
+        t->sched_up = value;
+    else
+        return false;
+    return true;
+}
+
+template <>
+bool SetNamedParam<UperfBoostWalt::Tunables>(UperfBoostWalt::Tunables *t, const std::string &name, int value,
+                                             const Soc *soc) {
+    return SetNamedUperfParam(t, name, value, soc, "sched_downmigrate", "sched_upmigrate");
+}
+
+template <>
+bool SetNamedParam<UperfBoostPelt::Tunables>(UperfBoostPelt::Tunables *t, const std::string &name, int value,
+                                             const Soc *soc) {
+    return SetNamedUperfParam(t, name, value, soc, "down_threshold", "up_threshold");
+}
+
+template <typename SimType>
+bool OpengaAdapter<SimType>::SetTunableByName(typename SimType::Tunables *t, const std::string &name,
+                                              int value) const {
+    const std::string boost_prefix = "boost.";
+    if (name.compare(0, boost_prefix.size(), boost_prefix) == 0) {
+        return t->has_boost &&
+               SetNamedParam<typename SimType::Boost::Tunables>(&t->boost, name.substr(boost_prefix.size()), value, soc_);
+    }
+    return SetNamedParam<GovernorTs<typename SimType::Governor>>(&t->governor, name, value, soc_) ||
+           SetNamedParam<typename SimType::Sched::Tunables>(&t->sched, name, value, soc_);
+}
+
+template <typename SimType>
+bool OpengaAdapter<SimType>::ConstrainTunables(typename SimType::Tunables *t) const {
+    bool changed = ConstrainBlock(&t->sched, soc_);
+    if (t->has_boost)
+        changed |= ConstrainBlock(&t->boost, soc_);
+    return changed;
 }
 
 template <typename Boost>
@@ -584,13 +2513,66 @@ bool IsSupportBoost<UperfBoostWalt>(const Soc *soc) {
 }
 
 template <typename SimType>
-typename SimType::Tunables OpengaAdapter<SimType>::TranslateParamSeq(const ParamSeq &p) const {
+const ParamSeq &OpengaAdapter<SimType>::GenesToRatios(const ParamSeq &p, ParamSeq *buf) const {
+    if (!ga_cfg_.integer_genome)
+        return p;
+
+    buf->resize(param_len_);
+    for (int i = 0; i < param_len_; ++i)
+        (*buf)[i] = GeneLevelToRatio(param_desc_[i], p[i]);
+    return *buf;
+}
+
+template <typename SimType>
+std::vector<int> OpengaAdapter<SimType>::GenesToLevels(const ParamSeq &p) const {
+    std::vector<int> levels(param_len_);
+    for (int i = 0; i < param_len_; ++i) {
+        const auto &desc = param_desc_[i];
+        if (ga_cfg_.integer_genome) {
+            levels[i] = p[i];
+            continue;
+        }
+        // 与Translate时的取整一致，取不大于量化值的最大档位
+        const int v = Quantify(p[i], desc);
+        if (desc.levels.empty()) {
+            levels[i] = std::min(std::max(v - desc.range_start, 0), GeneLevelNum(desc) - 1);
+        } else {
+            auto it   = std::upper_bound(desc.levels.begin(), desc.levels.end(), v);
+            levels[i] = std::max((int)(it - desc.levels.begin()) - 1, 0);
+        }
+    }
+    return levels;
+}
+
+template <typename SimType>
+ParamSeq OpengaAdapter<SimType>::LevelsToGenes(const std::vector<int> &levels) const {
+    ParamSeq p(param_len_);
+    for (int i = 0; i < param_len_; ++i) {
+        if (ga_cfg_.integer_genome)
+            p[i] = levels[i];
+        else
+            p[i] = GeneLevelToRatio(param_desc_[i], levels[i]);
+    }
+    return p;
+}
+
+template <typename SimType>
+typename SimType::Tunables OpengaAdapter<SimType>::TranslateParamSeq(const ParamSeq &genes) const {
     typename SimType::Tunables t;
 
+    // 固定参数不在染色体上，比例为0时Quantify得到range_start，每个线程复用展开后的序列
+    static thread_local ParamSeq p;
+    p.assign(full_desc_.size(), 0.0);
+    for (int i = 0; i < param_len_; ++i)
+        p[gene_slot_[i]] = ga_cfg_.integer_genome ? GeneLevelToRatio(param_desc_[i], genes[i]) : genes[i];
+
     ParamSeq::const_iterator  it_seq  = p.begin();
-    ParamDesc::const_iterator it_desc = param_desc_.begin();
+    ParamDesc::const_iterator it_desc = full_desc_.begin();
     // cpufreq调速器参数上下限
-    t.governor = TranslateBlock<GovernorTs<typename SimType::Governor>>(it_seq, it_desc, soc_);
+    if (gear_cfg_.breakpoints > 0)
+        t.governor = TranslateGearBlock<GovernorTs<typename SimType::Governor>>(it_seq, it_desc, soc_, gear_cfg_);
+    else
+        t.governor = TranslateBlock<GovernorTs<typename SimType::Governor>>(it_seq, it_desc, soc_);
     // sched任务调度器参数上下限
     t.sched = TranslateBlock<typename SimType::Sched::Tunables>(it_seq, it_desc, soc_);
     // 是否启用boost
@@ -602,16 +2584,71 @@ typename SimType::Tunables OpengaAdapter<SimType>::TranslateParamSeq(const Param
     return t;
 }
 
+template <typename SimType>
+void OpengaAdapter<SimType>::QuantizeParamSeq(const ParamSeq &p, std::vector<int> *q) const {
+    q->resize(param_len_);
+    for (int i = 0; i < param_len_; ++i) {
+        if (ga_cfg_.integer_genome)
+            (*q)[i] = GeneLevelValue(param_desc_[i], p[i]);
+        else
+            (*q)[i] = Quantify(p[i], param_desc_[i]);
+    }
+}
+
+template <typename SimType>
+ParamSeq OpengaAdapter<SimType>::QuantizedToGenes(const std::vector<int> &q) const {
+    ParamSeq p(param_len_);
+    for (int i = 0; i < param_len_; ++i) {
+        const auto &desc = param_desc_[i];
+        const int   span = desc.range_end - desc.range_start;
+        if (!ga_cfg_.integer_genome)
+            p[i] = span ? (double)(q[i] - desc.range_start) / span : 0.0;
+        else if (desc.levels.empty())
+            p[i] = q[i] - desc.range_start;
+        else
+            p[i] = std::lower_bound(desc.levels.begin(), desc.levels.end(), q[i]) - desc.levels.begin();
+    }
+    return p;
+}
+
 template <typename SimType>
 void OpengaAdapter<SimType>::InitParamDesc(const ParamDescCfg &p) {
-    // cpufreq调速器参数上下限
-    DefineBlock<GovernorTs<typename SimType::Governor>>(param_desc_, p, soc_);
+    // cpufreq调速器参数上下限，频点表可以按分段常数编码
+    gear_cfg_ = p.gear;
+    if (gear_cfg_.breakpoints > 0)
+        DefineGearBlock<GovernorTs<typename SimType::Governor>>(full_desc_, p, soc_);
+    else
+        DefineBlock<GovernorTs<typename SimType::Governor>>(full_desc_, p, soc_);
     // sched任务调度器参数上下限
-    DefineBlock<typename SimType::Sched::Tunables>(param_desc_, p, soc_);
+    DefineBlock<typename SimType::Sched::Tunables>(full_desc_, p, soc_);
     // 是否启用boost
     if (IsSupportBoost<typename SimType::Boost>(soc_)) {
-        // boost升频参数上下限
-        DefineBlock<typename SimType::Boost::Tunables>(param_desc_, p, soc_);
+        // boost升频参数上下限，uperf也有迁移阈值，参数名加上前缀以区分
+        const size_t boost_begin = full_desc_.size();
+        DefineBlock<typename SimType::Boost::Tunables>(full_desc_, p, soc_);
+        for (size_t i = boost_begin; i < full_desc_.size(); ++i)
+            full_desc_[i].name = "boost." + full_desc_[i].name;
+    }
+    // 按参数名固定的参数，取值与parameterRange中的min/max相同
+    for (const auto &pin : p.pinned) {
+        bool found = false;
+        for (auto &desc : full_desc_) {
+            if (desc.name != pin.first)
+                continue;
+            desc.range_start = pin.second;
+            desc.range_end   = pin.second;
+            desc.levels.clear();
+            found = true;
+        }
+        if (!found)
+            std::cout << "Pinned parameter not found, ignored: " << pin.first << std::endl;
+    }
+    // 上下限相同的参数是固定值，不放进染色体，减少搜索维度
+    for (size_t i = 0; i < full_desc_.size(); ++i) {
+        if (full_desc_[i].range_start == full_desc_[i].range_end)
+            continue;
+        param_desc_.push_back(full_desc_[i]);
+        gene_slot_.push_back(i);
     }
     param_len_ = param_desc_.size();
 }
@@ -626,7 +2663,8 @@ typename SimType::Tunables OpengaAdapter<SimType>::GenerateDefaultTunables(void)
     // sched任务调度器参数上下限
     t.sched = typename SimType::Sched::Tunables();
     // 是否启用boost
-    if (IsSupportBoost<typename SimType::Boost>(soc_)) {
+    t.has_boost = IsSupportBoost<typename SimType::Boost>(soc_);
+    if (t.has_boost) {
         // boost升频参数上下限
         t.boost = typename SimType::Boost::Tunables(soc_);
     }
@@ -1,18 +1,32 @@
 #ifndef __OPENGA_HELPER_H
 #define __OPENGA_HELPER_H
 
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "cpumodel.h"
+#include "eval_cache.h"
+#include "farm.h"
 #include "hmp_pelt.h"
 #include "hmp_walt.h"
 #include "input_boost.h"
 #include "interactive.h"
+#include "island.h"
+#include "mocmaes.hpp"
+#include "moead.hpp"
 #include "openga.hpp"
+#include "optimizer.h"
+#include "parallel.h"
 #include "rank.h"
+#include "rescore.h"
 #include "sim.hpp"
 #include "sim_types.h"
+#include "surrogate.h"
 #include "workload.h"
 
 using InputBoostWalt = InputBoost<Interactive, WaltHmp>;
@@ -26,10 +40,18 @@ using SimQcomUp = Sim<Interactive, WaltHmp, UperfBoostWalt>;
 using SimUp     = Sim<Interactive, PeltHmp, UperfBoostPelt>;
 
 typedef struct _ParamDescElement {
-    int range_start;
-    int range_end;
+    int              range_start;
+    int              range_end;
+    std::vector<int> levels;  // 整数基因的可选取值，为空时为range_start到range_end之间的所有整数
+    std::string      name;    // 参数名，按集群展开的参数带有集群序号和数组下标，如c1.target_loads[3]
 } ParamDescElement;
 
+// 调速器的频点表按分段常数编码，每段由起始频点序号和取值两个基因表示
+typedef struct _GearCfg {
+    int  breakpoints;  // 每个表的分段数，为0时每个频点一个基因
+    bool monotone;     // 表的取值随频点单调不减
+} GearCfg;
+
 typedef struct _ParamDescCfg {
     ParamDescElement above_hispeed_delay;
     ParamDescElement go_hispeed_load;
@@ -47,22 +69,69 @@ typedef struct _ParamDescCfg {
     ParamDescElement down_threshold;
     ParamDescElement up_threshold;
     ParamDescElement boost;
+
+    std::map<std::string, int> pinned;  // 按参数名固定单个参数的取值，通常来自wipe screen的输出
+    GearCfg                    gear;
 } ParamDescCfg;
 
 using ParamSeq  = std::vector<double>;
 using ParamDesc = std::vector<ParamDescElement>;
 
+// 当前SOC是否支持该类型的升频
+template <typename Boost>
+bool IsSupportBoost(const Soc *soc);
+template <>
+bool IsSupportBoost<InputBoostWalt>(const Soc *soc);
+template <>
+bool IsSupportBoost<InputBoostPelt>(const Soc *soc);
+template <>
+bool IsSupportBoost<UperfBoostWalt>(const Soc *soc);
+template <>
+bool IsSupportBoost<UperfBoostPelt>(const Soc *soc);
+
 template <typename SimType>
 class OpengaAdapter {
 public:
+    // nsga3后端按种群多样性和前沿的改进调整变异率、eta和交叉比例
+    typedef struct _AdaptiveCfg {
+        bool   enable;
+        float  mutation_rate_min;
+        float  mutation_rate_max;
+        float  eta_min;
+        float  eta_max;
+        float  crossover_fraction_min;
+        float  crossover_fraction_max;
+        double diversity_low;      // 相对于初始种群的多样性低于此值时增加探索
+        double diversity_high;     // 高于此值并且前沿仍在改进时减少探索
+        int    stall_generations;  // 前沿超体积连续这么多代没有提高时增加探索
+        double step;               // 每代调整的倍数
+    } AdaptiveCfg;
+
     typedef struct _GaCfg {
-        int      population;
-        int      generation_max;
-        float    crossover_fraction;
-        float    mutation_rate;
-        float    eta;
-        int      thread_num;
-        uint64_t random_seed;
+        int         population;
+        int         generation_max;
+        float       crossover_fraction;
+        float       mutation_rate;
+        float       eta;
+        int         thread_num;
+        uint64_t    random_seed;
+        bool        integer_genome;       // 基因为取值的序号而不是[0,1]的比例
+        int         local_search_rounds;  // 优化结束后对前沿做局部搜索的轮数，0为不做
+        int         local_search_max_eval;
+        std::string backend;       // nsga3, moead, mocmaes
+        bool        progress_log;  // 每一代输出仿真次数和前沿的超体积，用于比较不同后端
+        MoeadCfg    moead;
+        MoCmaesCfg  mocmaes;
+        int         island_num;  // 大于1时nsga3后端分成多个进程独立进化，定期迁移
+        int         island_interval;
+        int         island_migrants;
+        std::string island_socket_dir;
+        int         batch_size;  // 每个线程一起仿真的参数组数，大于1时亮屏负载分块推进
+        int         batch_tile;  // 分块推进时每块的时间片数
+        AdaptiveCfg adaptive;
+        bool        farm_enable;   // 由工作进程仿真，本进程只运行优化
+        int         farm_threads;  // 农场模式下等待评估结果的线程数，决定同时在途的参数组数
+        FarmCfg     farm;
     } GaCfg;
 
     typedef struct _MiscConst {
@@ -76,34 +145,121 @@ public:
         double c1;
         double c2;
         double c3;
+        bool   screened;  // 没有仿真过，c1, c2, c3为代理模型的预测值或者被支配的占位值，不进入前沿
     } MiddleCost;
 
+    // 敏感性筛选的结果，目标依次为c1, c2, c3
+    typedef struct _GeneEffect {
+        std::string name;
+        double      mu_star[3];  // 基本效应绝对值的均值
+        double      sigma[3];    // 基本效应的标准差，较大时说明与其他参数有交互或者非线性
+        double      influence;   // 各个目标上mu_star相对于所有参数中最大值的比例，取其中最大的
+        bool        insensitive;
+        int         pin_value;   // 固定时使用的取值，取中间的档位
+    } GeneEffect;
+
     struct Result {
         typename SimType::Tunables tunable;
         Rank::Score                score;
+        bool                       feasible;
+        std::vector<Rank::Score>   per_app;  // 按应用评估时每个应用的评分
     };
 
     using GA_Type    = EA::Genetic<ParamSeq, MiddleCost>;
+    // openGA的排序是protected，岛屿迁移替换个体之后用它重新计算前沿和选择概率
+    class IslandGa : public GA_Type {
+    public:
+        explicit IslandGa(uint64_t seed) : GA_Type(seed) {}
+        using GA_Type::rank_population;
+    };
     using RandomFunc = std::function<double(void)>;
 
     OpengaAdapter(Soc *soc, const Workload *workload, const Workload *idleload, const std::string &ga_cfg_file);
     std::vector<OpengaAdapter::Result> Optimize(void);
+    // 不运行优化，直接评估给定的参数组合，使用threadNum个线程并行
+    std::vector<OpengaAdapter::Result> Evaluate(const std::vector<typename SimType::Tunables> &tunables);
+    // 与Evaluate相同，每组参数评估完成后在工作线程中调用@on_done，参数为序号和结果
+    void EvaluateEach(const std::vector<typename SimType::Tunables> &tunables,
+                      const std::function<void(int, const Result &)> &on_done);
+    // 按parameterRange.pinned中使用的参数名修改一个参数，取值单位与parameterRange相同，未知的参数名返回false
+    bool SetTunableByName(typename SimType::Tunables *t, const std::string &name, int value) const;
+    // 按优化时翻译参数的约束修正参数，例如迁移上阈值不低于下阈值，有参数被修改时返回true
+    bool ConstrainTunables(typename SimType::Tunables *t) const;
+    // 按应用评估时各个应用的名称，与Result::per_app一一对应
+    std::vector<std::string> GetAppNames(void) const;
+    // Morris基本效应筛选，按对评分的影响从大到小排列染色体上的每个参数
+    std::vector<GeneEffect> Screen(void);
+    // 作为评估农场的工作进程连接协调者，评估收到的量化参数直到协调者断开
+    void ServeFarm(const std::string &host, int port);
+    // 在调用者线程中评估一组参数，与优化时评估一个个体的路径相同，满足约束时返回true
+    bool EvalSingle(const typename SimType::Tunables &t, MiddleCost &result) { return EvalTunables(t, result); }
+    // 各个集群调速器和调度器的默认参数，SOC支持时启用输入升频
+    typename SimType::Tunables GenerateDefaultTunables(void) const;
 
 private:
     OpengaAdapter();
     std::vector<double> CalcMultiObjectives(const typename GA_Type::thisChromosomeType &X) {
+        return CostToObjectives(X.middle_costs);
+    }
+    std::vector<double> CostToObjectives(const MiddleCost &c) const {
         // result.c1 = score.performance;   // 卡顿程度，越小越好
         // result.c2 = score.battery_life;  // 亮屏续航，越大越好
         // result.c3 = score.idle_lasting   // 灭屏待机，越大越好
-        return {X.middle_costs.c1,
-                -(misc_.work_fraction * X.middle_costs.c2 + misc_.idle_fraction * X.middle_costs.c3)};
+        return {c.c1, -(misc_.work_fraction * c.c2 + misc_.idle_fraction * c.c3)};
     }
+    // 没有仿真结果的个体使用的占位评分，性能为上限、续航为0，被前沿支配
+    MiddleCost UnsimulatedCost(void) const { return {misc_.performance_max, 0.0, 0.0, true}; }
+
+    using FrontMember = OptIndividual<MiddleCost>;
+
+    // 各个优化后端，返回最终的非支配解
+    std::vector<FrontMember> OptimizeNsga3(void);
+    std::vector<FrontMember> OptimizeMoead(void);
+    std::vector<FrontMember> OptimizeMoCmaes(void);
+    // 后端共用的评估约定，@allow_screen为是否使用代理模型筛选
+    OptProblem<MiddleCost> MakeProblem(bool allow_screen);
+    // 岛屿模式，把前沿上均匀分布的几个个体发给下一个岛屿，收到的个体替换最差的个体
+    // 整个种群都是非支配解时替换前沿上最拥挤的个体，替换之后重新排序
+    void Migrate(IslandGa &ga_obj, IslandChannel *channel);
+    // 岛屿0收集其他岛屿的最终前沿，与自己的前沿合并
+    std::vector<FrontMember> GatherFronts(const std::vector<FrontMember> &front, IslandChannel *channel,
+                                          const std::vector<int> &children);
+    std::vector<char> EncodeMember(int type, int island, const FrontMember &m) const;
+    bool DecodeMember(const std::vector<char> &msg, int *type, int *island, int *n_simulated, FrontMember *m) const;
+
+    // 一代结束后更新代理模型，按需输出进度
+    void       OnGeneration(int generation_number, const std::vector<Objectives> &front);
+    Objectives HypervolumeRef(void) const { return {misc_.performance_max, 0.0}; }
+    // 种群每个基因在[0,1]比例上的标准差的平均
+    double PopulationDiversity(const EA::GenerationType<ParamSeq, MiddleCost> &gen) const;
+    // 一代结束后调整下一代使用的变异率、eta和交叉比例
+    void AdaptOperators(GA_Type &ga_obj);
 
+    // 在量化后的参数档位上做坐标方向的邻域搜索，保留非支配的改进
+    std::vector<FrontMember> LocalSearch(const std::vector<FrontMember> &front);
+    // 保存默认参数、前沿和随机采样参数的仿真日志，之后可以在不同的评分设置下重新评分
+    void SaveSimLogs(const std::vector<FrontMember> &front);
+
+    // 代理模型预测的评分接近或优于当前前沿时才值得仿真
+    // @ratios为GenesToRatios得到的比例，不值得仿真时预测的评分写入@predicted并标记为筛掉
+    bool     IsWorthSimulating(const ParamSeq &param_seq, const ParamSeq &ratios, MiddleCost *predicted);
     ParamSeq Mutate(const ParamSeq &X_base, const RandomFunc &rnd01, double shrink_scale);
     ParamSeq Crossover(const ParamSeq &X1, const ParamSeq &X2, const RandomFunc &rnd01);
+    ParamSeq MutateInteger(const ParamSeq &X_base, const RandomFunc &rnd01);
+    ParamSeq CrossoverInteger(const ParamSeq &X1, const ParamSeq &X2, const RandomFunc &rnd01);
+    // 整数基因变化一档，到达边界时反向
+    void StepGene(ParamSeq &p, int idx, int dir) const;
 
     typename SimType::Tunables TranslateParamSeq(const ParamSeq &p) const;
-    typename SimType::Tunables GenerateDefaultTunables(void) const;
+    // 比例基因直接返回@p，整数基因的比例写入@buf后返回@buf，@buf的容量足够时没有堆分配
+    const ParamSeq &           GenesToRatios(const ParamSeq &p, ParamSeq *buf) const;
+    // 任一模式的基因与各个参数的档位序号之间转换
+    std::vector<int> GenesToLevels(const ParamSeq &p) const;
+    ParamSeq         LevelsToGenes(const std::vector<int> &levels) const;
+    // 量化后的取值写入@q，@q的容量足够时没有堆分配
+    void                       QuantizeParamSeq(const ParamSeq &p, std::vector<int> *q) const;
+    // QuantizeParamSeq的逆变换，得到的基因翻译出同样的参数
+    ParamSeq                   QuantizedToGenes(const std::vector<int> &q) const;
     void                       InitParamDesc(const ParamDescCfg &p);
 
     void MO_report_generation(int generation_number, const EA::GenerationType<ParamSeq, MiddleCost> &last_generation,
@@ -111,21 +267,123 @@ private:
 
     void InitParamSeq(ParamSeq &p, const RandomFunc &rnd01);
     bool EvalParamSeq(const ParamSeq &param_seq, MiddleCost &result);
+    bool EvalCachedParamSeq(const ParamSeq &param_seq, bool allow_screen, MiddleCost &result);
+    // 先查缓存和代理模型，需要仿真的每batch_size个一组，每组在一个常驻的工作线程中分块仿真
+    // 筛掉的个体写入预测的评分并返回不可行，调用者跳过不可行的个体，不会重新生成
+    // 同一时间只能有一个调用者，除了返回值之外，个体数不超过之前见过的最大值时没有堆分配
+    std::vector<char> EvalParamSeqBatch(const std::vector<const ParamSeq *> &seqs, bool allow_screen,
+                                        std::vector<MiddleCost> *results);
+    bool EvalTunables(const typename SimType::Tunables &t, MiddleCost &result);
+    // 多组参数在当前线程中一起分块仿真，按应用评估时逐个评估，是否可行写入@pass
+    void EvalTunablesBatch(const std::vector<typename SimType::Tunables> &ts, std::vector<MiddleCost> *results,
+                           std::vector<char> *pass);
+    bool RankResult(const SimResultPack &rp, MiddleCost &result);
+    // 仿真@work，@with_idle为是否接灭屏负载，灭屏从初始状态开始时亮屏和灭屏分开仿真
+    void RunTunables(const typename SimType::Tunables &t, const Workload &work, bool with_idle, SimResultPack *rp);
+    // 从idle_start_仿真灭屏负载
+    uint64_t OffscreenPower(const typename SimType::Tunables &t);
+    void     InitIdleStart(void);
+    // 每个应用从初始状态单独仿真，在常驻的工作线程中并行执行，按负载长度加权汇总
+    bool EvalTunablesPerApp(const typename SimType::Tunables &t, MiddleCost &result,
+                            std::vector<Rank::Score> *per_app);
+    void InitAppRefs(void);
+    // 同时进行的每个评估占用一组常驻的工作线程，空闲的组不够时再创建
+    void InitEvalWorkers(int n);
+    struct EvalWorkers;
+    std::unique_ptr<EvalWorkers> NewEvalWorkers(void) const;
+    EvalWorkers *                AcquireEvalWorkers(void);
+    void                         ReleaseEvalWorkers(EvalWorkers *w);
     void InitDefaultScore();
     void InitDefaultPowersum();
     void ParseCfgFile(const std::string &ga_cfg_file);
+    // 在@seed上累加仿真类型、SOC模型、负载、@settings和固定参数的哈希
+    uint64_t HashSimEnv(uint64_t seed, const std::string &settings) const;
+    void     InitEvalCache(const std::string &cache_file, const std::string &misc_settings);
+    // 协调者与工作进程的仿真环境和参数范围一致时，同样的量化取值才得到同样的评分
+    uint64_t FarmContext(void) const;
 
-    Soc *           soc_;
-    const Workload *workload_;
-    const Workload *idleload_;
-    Rank::Score     default_score_;
-    int             param_len_;
-    ParamDesc       param_desc_;
-    GaCfg           ga_cfg_;
-    MiscConst       misc_;
+    Soc *            soc_;
+    const Workload * workload_;
+    const Workload * idleload_;
+    Rank::Score      default_score_;
+    int              param_len_;
+    ParamDesc        param_desc_;  // 染色体上每个基因的参数范围
+    ParamDesc        full_desc_;   // 按翻译顺序的全部参数范围，包括上下限相同的固定参数
+    std::vector<int> gene_slot_;   // 每个基因在full_desc_中的位置
+    GearCfg          gear_cfg_;
+    GaCfg            ga_cfg_;
+    MiscConst        misc_;
 
     typename SimType::MiscConst sim_misc_;
     Rank::MiscConst             rank_misc_;
+
+    // 按应用评估，ref为默认参数在该应用上的评分，lag为默认参数的卡顿绝对值
+    typedef struct _AppRef {
+        Rank::MiscConst misc;
+        Rank::Score     ref;
+        double          lag;
+        double          weight;
+    } AppRef;
+
+    std::vector<std::shared_ptr<const Workload>> apps_;
+    std::vector<double>                          app_scales_;  // 应用在场景中的权重，合并负载时都为1
+    std::unique_ptr<Workload>                    empty_idle_;
+    std::vector<AppRef>                          app_refs_;
+    double                                       app_lag_ref_;
+    int                                          per_app_threads_;
+
+    // 一次评估使用的工作线程和按应用的缓冲区，创建时按每个应用的负载长度预留
+    struct EvalWorkers {
+        std::unique_ptr<WorkerPool> pool;
+        std::vector<SimResultPack>  rps;
+        std::vector<double>         lag;
+        std::vector<double>         pwr_ratio;
+        std::vector<char>           warmed;  // 第i个工作线程是否执行过第j个任务，下标为i * (应用数 + 1) + j
+        double                      idle_lasting;
+        uint64_t                    offscreen_pwr;
+    };
+
+    std::vector<std::unique_ptr<EvalWorkers>> eval_workers_;
+    std::vector<EvalWorkers *>                idle_eval_workers_;
+    std::mutex                                eval_workers_mutex_;
+
+    // EvalParamSeqBatch的工作线程在第一次调用时创建，缓冲区按见过的最大个体数预留
+    std::unique_ptr<WorkerPool>   batch_pool_;
+    std::vector<std::vector<int>> batch_keys_;
+    std::vector<char>             batch_need_sim_;
+    std::vector<int>              batch_todo_;
+    std::vector<std::vector<int>> batch_values_;
+    std::vector<FarmCost>         batch_costs_;
+    int                           batch_warmed_n_;
+
+    bool                       offscreen_reset_;     // 灭屏仿真从初始状态开始，而不是接着亮屏仿真的状态
+    bool                       offscreen_parallel_;  // 合并负载评估时亮屏和灭屏在常驻的工作线程中同时仿真
+    typename SimType::State    idle_start_;          // 灭屏仿真的初始状态，小核活跃，两个集群都在最低频率
+
+    std::unique_ptr<EvalCache> eval_cache_;
+    std::atomic<int>           n_simulated_;
+    std::string                eval_settings_;  // 影响评分的设置，计入缓存和农场的上下文
+
+    std::unique_ptr<FarmCoordinator> farm_;
+
+    std::vector<std::vector<char>> island_backlog_;  // 岛屿0迁移时收到的前沿和结束消息，留给GatherFronts
+
+    int    screen_trajectories_;
+    int    screen_levels_;
+    double screen_threshold_;  // 影响低于这个比例的参数可以固定
+
+    bool     simlog_enable_;
+    int      simlog_sample_;  // 除前沿外再随机采样的参数组数，使重新评分后的前沿有更多候选
+    uint64_t simlog_ctx_;
+
+    std::unique_ptr<RffSurrogate>    surrogate_;
+    std::vector<std::vector<double>> front_objectives_;
+
+    // 变异和交叉当前使用的eta，只在两代之间修改
+    double eta_;
+    double diversity_init_;
+    double best_hypervolume_;
+    int    n_stall_;
 };
 
 #endif
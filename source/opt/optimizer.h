@@ -0,0 +1,153 @@
+#ifndef __OPTIMIZER_H
+#define __OPTIMIZER_H
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+
+// 优化器后端与OpengaAdapter之间的约定，后端只通过这些回调访问基因和评估
+// 所有目标都是越小越好
+
+using ParamSeq   = std::vector<double>;
+using RandomFunc = std::function<double(void)>;
+using Objectives = std::vector<double>;
+
+template <typename CostT>
+struct OptIndividual {
+    ParamSeq   genes;
+    CostT      cost;
+    Objectives objectives;
+};
+
+template <typename CostT>
+struct OptProblem {
+    int      dim;
+    int      population;
+    int      generation_max;
+    int      thread_num;
+    uint64_t random_seed;
+    double   crossover_fraction;
+    double   mutation_rate;
+
+    // 评估一批个体，@costs与基因一一对应，返回每个个体是否可行，不可行的个体不会进入种群
+    std::function<std::vector<char>(const std::vector<const ParamSeq *> &, std::vector<CostT> *)> eval_batch;
+    std::function<Objectives(const CostT &)>              objectives;
+    std::function<void(ParamSeq &, const RandomFunc &)>   init;
+    std::function<ParamSeq(const ParamSeq &, const RandomFunc &, double)>           mutate;
+    std::function<ParamSeq(const ParamSeq &, const ParamSeq &, const RandomFunc &)> crossover;
+    // 连续空间的后端在[0,1]^dim中搜索，通过这两个函数与基因互相转换
+    std::function<ParamSeq(const std::vector<double> &)> from_unit;
+    std::function<std::vector<double>(const ParamSeq &)> to_unit;
+    // 每一代结束时调用，参数为代数和当前的非支配解
+    std::function<void(int, const std::vector<Objectives> &)> report;
+};
+
+// @a支配@b
+inline bool Dominates(const Objectives &a, const Objectives &b) {
+    bool better = false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i] > b[i])
+            return false;
+        if (a[i] < b[i])
+            better = true;
+    }
+    return better;
+}
+
+// 快速非支配排序，返回每个前沿包含的序号
+inline std::vector<std::vector<int>> NonDominatedSort(const std::vector<Objectives> &objs) {
+    const int                     n = objs.size();
+    std::vector<std::vector<int>> fronts;
+    std::vector<std::vector<int>> dominated(n);
+    std::vector<int>              n_dominator(n, 0);
+
+    fronts.emplace_back();
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            if (Dominates(objs[i], objs[j]))
+                dominated[i].push_back(j);
+            else if (Dominates(objs[j], objs[i]))
+                n_dominator[i]++;
+        }
+        if (n_dominator[i] == 0)
+            fronts[0].push_back(i);
+    }
+
+    for (size_t k = 0; k < fronts.size(); ++k) {
+        std::vector<int> next;
+        for (int i : fronts[k]) {
+            for (int j : dominated[i]) {
+                if (--n_dominator[j] == 0)
+                    next.push_back(j);
+            }
+        }
+        if (next.empty())
+            break;
+        fronts.push_back(next);
+    }
+    return fronts;
+}
+
+// 二维目标的超体积，@ref为参考点
+inline double Hypervolume2D(std::vector<Objectives> pts, const Objectives &ref) {
+    std::sort(pts.begin(), pts.end());
+    double area = 0.0;
+    double best = ref[1];
+    for (const auto &p : pts) {
+        if (p[0] >= ref[0] || p[1] >= best)
+            continue;
+        area += (ref[0] - p[0]) * (best - p[1]);
+        best = p[1];
+    }
+    return area;
+}
+
+// 二维非支配集中每个点独占的超体积，用于环境选择
+inline std::vector<double> HypervolumeContrib2D(const std::vector<Objectives> &pts, const Objectives &ref) {
+    const int        n = pts.size();
+    std::vector<int> order(n);
+    for (int i = 0; i < n; ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return pts[a] < pts[b]; });
+
+    std::vector<double> contrib(n, 0.0);
+    for (int k = 0; k < n; ++k) {
+        const auto & p      = pts[order[k]];
+        const double right  = (k + 1 < n) ? pts[order[k + 1]][0] : ref[0];
+        const double top    = (k > 0) ? pts[order[k - 1]][1] : ref[1];
+        // 边界点总是保留
+        contrib[order[k]] = (k == 0 || k == n - 1) ? std::numeric_limits<double>::infinity()
+                                                    : (right - p[0]) * (top - p[1]);
+    }
+    return contrib;
+}
+
+// 只保留非支配的个体，超过@max_size时按超体积贡献逐个剔除
+template <typename CostT>
+std::vector<OptIndividual<CostT>> ReduceToFront(const std::vector<OptIndividual<CostT>> &pop, size_t max_size,
+                                                const Objectives &ref) {
+    std::vector<Objectives> objs;
+    for (const auto &ind : pop)
+        objs.push_back(ind.objectives);
+    auto fronts = NonDominatedSort(objs);
+
+    std::vector<OptIndividual<CostT>> ret;
+    if (pop.empty())
+        return ret;
+    for (int i : fronts[0])
+        ret.push_back(pop[i]);
+
+    while (ret.size() > max_size) {
+        objs.clear();
+        for (const auto &ind : ret)
+            objs.push_back(ind.objectives);
+        auto contrib = HypervolumeContrib2D(objs, ref);
+        ret.erase(ret.begin() + (std::min_element(contrib.begin(), contrib.end()) - contrib.begin()));
+    }
+    return ret;
+}
+
+#endif
@@ -0,0 +1,281 @@
+#include "rescore.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#include "eval_cache.h"
+#include "optimizer.h"
+#include "rank_batch.h"
+#include "varint.h"
+
+const uint32_t kSimLogMagic   = 0x474c5357;  // "WSLG"
+const uint32_t kSimLogVersion = 1;
+
+uint64_t SimLogContext(const Soc &soc, const Workload &workload, const Workload &idleload, const nlohmann::json &conf) {
+    uint64_t ctx = HashFile(soc.model_file_);
+    if (workload.IsComposite()) {
+        for (int i = 0; i < workload.GetSegmentNum(); ++i) {
+            const auto seg = workload.GetSegment(i);
+            ctx            = HashFile(seg.work->workload_file_, ctx);
+            ctx            = HashBytes(&seg.weight, sizeof(seg.weight), ctx);
+        }
+    } else {
+        ctx = HashFile(workload.workload_file_, ctx);
+    }
+    ctx = HashFile(idleload.workload_file_, ctx);
+
+    // 只有仿真用到的设置影响日志，评分的设置正是重新评分要改变的
+    const auto &   misc = conf["miscSettings"];
+    nlohmann::json sim_settings;
+    sim_settings["useUperf"]       = conf["useUperf"];
+    sim_settings["workingBase"]    = misc["sim.power.workingBase_mw"];
+    sim_settings["idleBase"]       = misc["sim.power.idleBase_mw"];
+    sim_settings["offscreenReset"] = conf.count("offscreenEval") && conf["offscreenEval"]["canonicalReset"].get<bool>();
+    const std::string s            = sim_settings.dump();
+    return HashBytes(s.data(), s.size(), ctx);
+}
+
+template <typename T>
+static void PutRaw(std::vector<char> *buf, const T &v) {
+    const char *p = reinterpret_cast<const char *>(&v);
+    buf->insert(buf->end(), p, p + sizeof(T));
+}
+
+template <typename T>
+static void GetRaw(const std::vector<char> &data, size_t *pos, T *v) {
+    if (*pos + sizeof(T) > data.size())
+        throw std::runtime_error("simlog file truncated");
+    memcpy(v, data.data() + *pos, sizeof(T));
+    *pos += sizeof(T);
+}
+
+// 一列数据的差值编码，前面是编码后的字节数
+static void PutColumn(std::vector<char> *buf, const SimSeq &seq) {
+    std::vector<char> col;
+    int64_t           last = 0;
+    for (const auto v : seq) {
+        PutVarint(&col, (int64_t)v - last);
+        last = v;
+    }
+    PutRaw(buf, (uint32_t)col.size());
+    buf->insert(buf->end(), col.begin(), col.end());
+}
+
+static void GetColumn(const std::vector<char> &data, size_t *pos, uint32_t n, SimSeq *seq) {
+    uint32_t len;
+    GetRaw(data, pos, &len);
+    const size_t end  = *pos + len;
+    int64_t      last = 0;
+    seq->clear();
+    seq->reserve(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        int64_t delta;
+        if (*pos >= end || !GetVarint(data, pos, &delta))
+            throw std::runtime_error("simlog file truncated");
+        last += delta;
+        seq->push_back(last);
+    }
+    *pos = end;
+}
+
+void SaveSimLog(const std::string &log_file, const SimLog &log) {
+    const uint32_t n_cand   = log.rps.size();
+    const uint32_t n_window = n_cand ? log.rps[0].onscreen.capacity.size() : 0;
+
+    std::vector<char> buf;
+    PutRaw(&buf, kSimLogMagic);
+    PutRaw(&buf, kSimLogVersion);
+    PutRaw(&buf, log.context);
+    PutRaw(&buf, n_cand);
+    PutRaw(&buf, n_window);
+    for (uint32_t k = 0; k < n_cand; ++k) {
+        PutRaw(&buf, (uint32_t)log.labels[k].size());
+        buf.insert(buf.end(), log.labels[k].begin(), log.labels[k].end());
+        PutRaw(&buf, log.rps[k].offscreen_pwr);
+    }
+    // 同一个序列的相邻值接近，按列存放时差值编码后大多只占一两个字节
+    for (const auto &rp : log.rps)
+        PutColumn(&buf, rp.onscreen.capacity);
+    for (const auto &rp : log.rps)
+        PutColumn(&buf, rp.onscreen.power);
+
+    std::ofstream ofs(log_file, std::ios::binary);
+    if (!ofs.good()) {
+        using namespace std;
+        cout << "Simlog file access ERROR: " << log_file << endl;
+        throw runtime_error("file access error");
+    }
+    ofs.write(buf.data(), buf.size());
+}
+
+SimLog LoadSimLog(const std::string &log_file) {
+    std::ifstream ifs(log_file, std::ios::binary);
+    if (!ifs.good()) {
+        using namespace std;
+        cout << "Simlog file access ERROR: " << log_file << endl;
+        throw runtime_error("file access error");
+    }
+    const std::vector<char> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    size_t   pos = 0;
+    uint32_t magic, version, n_cand, n_window;
+    SimLog   log;
+    GetRaw(data, &pos, &magic);
+    GetRaw(data, &pos, &version);
+    if (magic != kSimLogMagic || version != kSimLogVersion) {
+        using namespace std;
+        cout << "Simlog file format ERROR: " << log_file << endl;
+        throw runtime_error("simlog format error");
+    }
+    GetRaw(data, &pos, &log.context);
+    GetRaw(data, &pos, &n_cand);
+    GetRaw(data, &pos, &n_window);
+
+    log.labels.resize(n_cand);
+    log.rps.resize(n_cand);
+    for (uint32_t k = 0; k < n_cand; ++k) {
+        uint32_t len;
+        GetRaw(data, &pos, &len);
+        if (pos + len > data.size())
+            throw std::runtime_error("simlog file truncated");
+        log.labels[k].assign(data.begin() + pos, data.begin() + pos + len);
+        pos += len;
+        GetRaw(data, &pos, &log.rps[k].offscreen_pwr);
+    }
+    for (auto &rp : log.rps)
+        GetColumn(data, &pos, n_window, &rp.onscreen.capacity);
+    for (auto &rp : log.rps)
+        GetColumn(data, &pos, n_window, &rp.onscreen.power);
+    return log;
+}
+
+Rank::MiscConst ParseRankMisc(const nlohmann::json &misc) {
+    Rank::MiscConst m;
+    m.common_fraction     = misc["eval.perf.commonFraction"];
+    m.render_fraction     = misc["eval.perf.renderFraction"];
+    m.perf_partition_len  = misc["eval.perf.partitionLen"];
+    m.batt_partition_len  = misc["eval.power.partitionLen"];
+    m.seq_lag_l1          = misc["eval.perf.seqLagL1"];
+    m.seq_lag_l2          = misc["eval.perf.seqLagL2"];
+    m.seq_lag_max         = misc["eval.perf.seqLagMax"];
+    m.seq_lag_l0_scale    = misc["eval.perf.seqLagL0Scale"];
+    m.seq_lag_l1_scale    = misc["eval.perf.seqLagL1Scale"];
+    m.seq_lag_l2_scale    = misc["eval.perf.seqLagL2Scale"];
+    m.enough_penalty      = misc["eval.perf.enoughPenalty"];
+    m.complexity_fraction = misc["eval.complexityFraction"];
+    return m;
+}
+
+void Rescore(const Soc &soc, const Workload &workload, const SimLog &log, const nlohmann::json &misc,
+             const nlohmann::json &grid, const std::string &out_file) {
+    using namespace std;
+    using Clock = chrono::steady_clock;
+
+    const auto t_begin = Clock::now();
+    const int  n_cand  = log.rps.size();
+
+    vector<const SimResultPack *> rps;
+    for (const auto &rp : log.rps)
+        rps.push_back(&rp);
+    RankBatch batch(workload, soc, rps);
+
+    // 网格的每一维是miscSettings中的一个键，取值不是数组时只有一个取值
+    vector<string>                 keys;
+    vector<vector<nlohmann::json>> values;
+    for (auto it = grid.begin(); it != grid.end(); ++it) {
+        if (!misc.count(it.key())) {
+            cout << "Rescore grid unknown miscSettings key: " << it.key() << endl;
+            throw runtime_error("unknown key");
+        }
+        // sim.*等设置会改变仿真结果，日志中的仿真结果不能反映这些修改
+        const string &key = it.key();
+        if (key.compare(0, 5, "eval.") != 0 && key.compare(0, 8, "ga.cost.") != 0) {
+            cout << "Rescore grid key must be eval.* or ga.cost.*, " << key << " changes the simulation" << endl;
+            throw runtime_error("invalid rescore key");
+        }
+        keys.push_back(key);
+        if (it.value().is_array())
+            values.push_back(it.value().get<vector<nlohmann::json>>());
+        else
+            values.push_back({it.value()});
+    }
+
+    ofstream ofs(out_file);
+    if (!ofs.good()) {
+        cout << "Rescore output file access ERROR: " << out_file << endl;
+        throw runtime_error("file access error");
+    }
+    ofs << "point";
+    for (const auto &key : keys)
+        ofs << ',' << key;
+    ofs << ",candidate,performance,battery_life,idle_lasting,feasible,front\n";
+
+    // 按里程表的方式遍历所有组合
+    vector<size_t> pos(keys.size(), 0);
+    int            n_point = 0;
+    for (bool done = false; !done; ++n_point) {
+        nlohmann::json m = misc;
+        for (size_t i = 0; i < keys.size(); ++i)
+            m[keys[i]] = values[i][pos[i]];
+
+        const double idle_fraction    = m["ga.cost.batteryScore.idleFraction"];
+        const double work_fraction    = m["ga.cost.batteryScore.workFraction"];
+        const double idle_lasting_min = m["ga.cost.limit.idleLastingMin"];
+        const double performance_max  = m["ga.cost.limit.performanceMax"];
+
+        const auto scores = batch.Eval(ParseRankMisc(m));
+
+        // 默认参数只作为参考，不参与前沿，目标与OpengaAdapter::CostToObjectives相同
+        // scores[0]是默认参数未归一化的评分，输出时与其它候选一样以自身为参考，即{1, 1, 1}，限制也相对于它，视为可行
+        vector<char>       feasible(n_cand, 0);
+        vector<char>       on_front(n_cand, 0);
+        vector<int>        feasible_idx;
+        vector<Objectives> objs;
+        feasible[0] = 1;
+        for (int k = 1; k < n_cand; ++k) {
+            const auto &s = scores[k];
+            feasible[k]   = (s.idle_lasting > idle_lasting_min) && (s.performance < performance_max);
+            if (!feasible[k])
+                continue;
+            feasible_idx.push_back(k);
+            objs.push_back({s.performance, -(work_fraction * s.battery_life + idle_fraction * s.idle_lasting)});
+        }
+        if (!objs.empty()) {
+            const auto fronts = NonDominatedSort(objs);
+            for (int i : fronts[0])
+                on_front[feasible_idx[i]] = 1;
+        }
+
+        cout << "Point " << n_point << ":";
+        for (size_t i = 0; i < keys.size(); ++i)
+            cout << ' ' << keys[i] << '=' << values[i][pos[i]].dump();
+        cout << endl << "    front:";
+        for (int k = 0; k < n_cand; ++k) {
+            const auto &s = k == 0 ? Rank::Score{1.0, 1.0, 1.0, {}} : scores[k];
+            ofs << n_point;
+            for (size_t i = 0; i < keys.size(); ++i)
+                ofs << ',' << values[i][pos[i]].dump();
+            ofs << ',' << log.labels[k] << ',' << s.performance << ',' << s.battery_life << ',' << s.idle_lasting
+                << ',' << (int)feasible[k] << ',' << (int)on_front[k] << '\n';
+            if (on_front[k])
+                cout << ' ' << log.labels[k];
+        }
+        cout << endl;
+
+        done = true;
+        for (size_t i = 0; i < keys.size() && done; ++i) {
+            if (++pos[i] < values[i].size())
+                done = false;
+            else
+                pos[i] = 0;
+        }
+    }
+
+    const double elapsed = chrono::duration<double>(Clock::now() - t_begin).count();
+    cout << "\nRescored " << n_cand - 1 << " candidates under " << n_point << " settings in " << elapsed << " seconds."
+         << endl;
+}
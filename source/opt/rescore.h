@@ -0,0 +1,37 @@
+#ifndef __RESCORE_H
+#define __RESCORE_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "cpumodel.h"
+#include "json.hpp"
+#include "rank.h"
+#include "sim_types.h"
+#include "workload.h"
+
+// 一组候选参数的仿真日志，在不同的评分设置下重新评分时不需要重新仿真，第0个为默认参数
+typedef struct _SimLog {
+    uint64_t                   context;
+    std::vector<std::string>   labels;
+    std::vector<SimResultPack> rps;
+} SimLog;
+
+// 日志的上下文，SOC模型、负载或者影响仿真结果的设置不同时日志不能用于重新评分，@conf为整个conf.json
+uint64_t SimLogContext(const Soc &soc, const Workload &workload, const Workload &idleload, const nlohmann::json &conf);
+
+// 按列存放，每个候选的容量序列和耗电序列分别做差值变长编码
+void   SaveSimLog(const std::string &log_file, const SimLog &log);
+SimLog LoadSimLog(const std::string &log_file);
+
+// miscSettings中评分相关的设置
+Rank::MiscConst ParseRankMisc(const nlohmann::json &misc);
+
+// 在@grid的每一组设置下重新评分所有候选，@grid的每一项为miscSettings中的键和候选取值的数组，取所有组合
+// 每组设置下每个候选的评分和是否在可行解的前沿上写入@out_file
+void Rescore(const Soc &soc, const Workload &workload, const SimLog &log, const nlohmann::json &misc,
+             const nlohmann::json &grid, const std::string &out_file);
+
+#endif
@@ -0,0 +1,149 @@
+#include "surrogate.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+RffSurrogate::RffSurrogate(const Cfg &cfg, int in_dim, int out_dim, uint64_t seed)
+    : cfg_(cfg),
+      in_dim_(in_dim),
+      out_dim_(out_dim),
+      n_basis_(cfg.n_features + 1),
+      n_samples_(0),
+      n_err_(0),
+      fitted_(false),
+      n_screened_(0),
+      n_skipped_(0) {
+    // RBF核的随机傅里叶特征，omega ~ N(0, 1 / sigma^2)，phase ~ U(0, 2pi)
+    const double sigma = cfg_.length_scale * std::sqrt((double)in_dim_);
+
+    std::mt19937_64                        rng(seed);
+    std::normal_distribution<double>       normal(0.0, 1.0 / sigma);
+    std::uniform_real_distribution<double> uniform(0.0, 2.0 * M_PI);
+
+    omega_.resize(cfg_.n_features * in_dim_);
+    for (auto &w : omega_)
+        w = normal(rng);
+    phase_.resize(cfg_.n_features);
+    for (auto &b : phase_)
+        b = uniform(rng);
+
+    ata_.assign(n_basis_ * n_basis_, 0.0);
+    aty_.assign(n_basis_ * out_dim_, 0.0);
+    weight_.assign(n_basis_ * out_dim_, 0.0);
+    err_sum_.assign(out_dim_, 0.0);
+    rmse_.assign(out_dim_, std::numeric_limits<double>::infinity());
+    phi_.assign(n_basis_, 0.0);
+}
+
+double RffSurrogate::CalcFeature(const std::vector<double> &x, int idx) const {
+    const double  scale = std::sqrt(2.0 / cfg_.n_features);
+    const double *w     = &omega_[idx * in_dim_];
+    double        dot   = phase_[idx];
+    for (int j = 0; j < in_dim_; ++j)
+        dot += w[j] * x[j];
+    return scale * std::cos(dot);
+}
+
+void RffSurrogate::CalcFeatures(const std::vector<double> &x, std::vector<double> *phi) const {
+    phi->resize(n_basis_);
+    for (int i = 0; i < cfg_.n_features; ++i)
+        (*phi)[i] = CalcFeature(x, i);
+    // 常数项
+    (*phi)[cfg_.n_features] = 1.0;
+}
+
+// 逐个特征累加，不保存整个特征向量，累加顺序与按特征向量计算一致
+void RffSurrogate::Predict(const std::vector<double> &x, double *y) const {
+    for (int k = 0; k < out_dim_; ++k)
+        y[k] = 0.0;
+    for (int i = 0; i < cfg_.n_features; ++i) {
+        const double phi = CalcFeature(x, i);
+        for (int k = 0; k < out_dim_; ++k)
+            y[k] += phi * weight_[i * out_dim_ + k];
+    }
+    for (int k = 0; k < out_dim_; ++k)
+        y[k] += weight_[cfg_.n_features * out_dim_ + k];
+}
+
+// 特征向量放在预先分配的phi_中，在锁内计算
+void RffSurrogate::AddSample(const std::vector<double> &x, const double *y) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CalcFeatures(x, &phi_);
+
+    // 拟合之后加入的样本未参与训练，可以用来估计预测误差
+    if (fitted_) {
+        for (int k = 0; k < out_dim_; ++k) {
+            double pred = 0.0;
+            for (int i = 0; i < n_basis_; ++i)
+                pred += phi_[i] * weight_[i * out_dim_ + k];
+            err_sum_[k] += (pred - y[k]) * (pred - y[k]);
+        }
+        ++n_err_;
+    }
+
+    // 只累加上三角，拟合时再对称展开
+    for (int i = 0; i < n_basis_; ++i) {
+        double *row = &ata_[i * n_basis_];
+        for (int j = i; j < n_basis_; ++j)
+            row[j] += phi_[i] * phi_[j];
+        for (int k = 0; k < out_dim_; ++k)
+            aty_[i * out_dim_ + k] += phi_[i] * y[k];
+    }
+    ++n_samples_;
+}
+
+void RffSurrogate::Fit(void) {
+    if (n_samples_ < cfg_.min_samples)
+        return;
+
+    if (n_err_ > 0) {
+        for (int k = 0; k < out_dim_; ++k)
+            rmse_[k] = std::sqrt(err_sum_[k] / n_err_);
+        err_sum_.assign(out_dim_, 0.0);
+        n_err_ = 0;
+    }
+
+    // 求解(A^T A + ridge * I) w = A^T y，Cholesky分解 L L^T
+    const int           n = n_basis_;
+    std::vector<double> l(n * n, 0.0);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j <= i; ++j) {
+            double sum = ata_[j * n + i];
+            if (i == j)
+                sum += cfg_.ridge;
+            for (int k = 0; k < j; ++k)
+                sum -= l[i * n + k] * l[j * n + k];
+            if (i == j) {
+                if (sum <= 0.0)
+                    return;
+                l[i * n + i] = std::sqrt(sum);
+            } else {
+                l[i * n + j] = sum / l[j * n + j];
+            }
+        }
+    }
+
+    for (int k = 0; k < out_dim_; ++k) {
+        std::vector<double> z(n);
+        for (int i = 0; i < n; ++i) {
+            double sum = aty_[i * out_dim_ + k];
+            for (int j = 0; j < i; ++j)
+                sum -= l[i * n + j] * z[j];
+            z[i] = sum / l[i * n + i];
+        }
+        for (int i = n - 1; i >= 0; --i) {
+            double sum = z[i];
+            for (int j = i + 1; j < n; ++j)
+                sum -= l[j * n + i] * weight_[j * out_dim_ + k];
+            weight_[i * out_dim_ + k] = sum / l[i * n + i];
+        }
+    }
+    fitted_ = true;
+}
+
+void RffSurrogate::CountScreened(bool skipped) {
+    ++n_screened_;
+    if (skipped)
+        ++n_skipped_;
+}
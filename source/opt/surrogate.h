@@ -0,0 +1,64 @@
+#ifndef __SURROGATE_H
+#define __SURROGATE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// 随机傅里叶特征+岭回归的代理模型，根据基因序列预估评分，用于在仿真前筛掉明显较差的后代
+class RffSurrogate {
+public:
+    typedef struct _Cfg {
+        int    n_features;            // 随机特征数量
+        double length_scale;          // RBF核的长度尺度，相对于sqrt(基因长度)
+        double ridge;                 // 岭回归的正则化系数
+        int    min_samples;           // 样本数量达到后才开始筛选
+        double exploration_fraction;  // 不经筛选直接仿真的比例
+        double margin;                // 预测值比前沿差多少倍的预测误差才跳过
+    } Cfg;
+
+    RffSurrogate() = delete;
+    RffSurrogate(const Cfg &cfg, int in_dim, int out_dim, uint64_t seed);
+
+    // 加入一个仿真得到的样本，模型已拟合时同时记录预测误差，线程安全，没有堆分配
+    void AddSample(const std::vector<double> &x, const double *y);
+    // 使用已加入的全部样本重新拟合，不能和Predict并发调用
+    void Fit(void);
+    // 没有堆分配
+    void Predict(const std::vector<double> &x, double *y) const;
+    void CountScreened(bool skipped);
+
+    bool       IsReady(void) const { return fitted_; }
+    double     GetRmse(int idx_out) const { return rmse_[idx_out]; }
+    const Cfg &GetCfg(void) const { return cfg_; }
+    int        GetScreenedNum(void) const { return n_screened_; }
+    int        GetSkippedNum(void) const { return n_skipped_; }
+
+private:
+    double CalcFeature(const std::vector<double> &x, int idx) const;
+    void   CalcFeatures(const std::vector<double> &x, std::vector<double> *phi) const;
+
+    Cfg cfg_;
+    int in_dim_;
+    int out_dim_;
+    int n_basis_;  // 随机特征加上常数项
+
+    std::vector<double> omega_;  // n_features x in_dim
+    std::vector<double> phase_;  // n_features
+    std::vector<double> ata_;    // n_basis x n_basis，特征的自相关累加
+    std::vector<double> aty_;    // n_basis x out_dim，特征与评分的互相关累加
+    std::vector<double> weight_;
+    std::vector<double> err_sum_;
+    std::vector<double> rmse_;
+    std::vector<double> phi_;  // AddSample的特征向量，由mutex_保护
+    int                 n_samples_;
+    int                 n_err_;
+    bool                fitted_;
+    std::mutex          mutex_;
+    std::atomic<int>    n_screened_;
+    std::atomic<int>    n_skipped_;
+};
+
+#endif
@@ -0,0 +1,399 @@
+#include "load.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+
+#include "json.hpp"
+#include "misc.h"
+
+// 与dump.cpp中multiple_to_us互逆，@us = Ms2Us(Quantum2Ms(multiple * timer_rate) - 2)
+int UsToMultiple(int us, int timer_rate) {
+    return std::max(1, (int)std::round((us / 1000.0 + 2) / Quantum2Ms(timer_rate)));
+}
+
+// 解析形如"85 1190000:90 1400000:95"的参数，频点单位kHz，结果按opp下标展开到@vals
+// 第一个值覆盖第一个显式频点之前的所有频点
+void FreqTableStrToArray(const std::string &str, const Cluster &cl, int n_vals, int timer_rate, bool is_delay,
+                         uint8_t *vals) {
+    std::vector<std::pair<int, int>> entries;
+
+    std::istringstream ss(str);
+    std::string        token;
+    while (ss >> token) {
+        auto pos = token.find(':');
+        int  freq, val;
+        if (pos == std::string::npos) {
+            freq = 0;
+            val  = std::stoi(token);
+        } else {
+            freq = std::stoi(token.substr(0, pos)) / 1000;
+            val  = std::stoi(token.substr(pos + 1));
+        }
+        if (is_delay) {
+            val = UsToMultiple(val, timer_rate);
+        }
+        entries.push_back({freq, val});
+    }
+
+    if (entries.empty()) {
+        using namespace std;
+        cout << "Empty frequency table: " << str << endl;
+        throw runtime_error("frequency table is empty");
+    }
+
+    for (int i = 0; i < n_vals; ++i) {
+        int val = entries[0].second;
+        for (const auto &e : entries) {
+            if (e.first <= cl.GetOpp(i))
+                val = e.second;
+        }
+        vals[i] = val;
+    }
+}
+
+void StrToTargetLoads(const std::string &str, const Cluster &cl, Interactive::Tunables *t) {
+    int n_opp = cl.model_.opp_model.size();
+    FreqTableStrToArray(str, cl, std::min(TARGET_LOAD_MAX_LEN, n_opp), 1, false, t->target_loads);
+}
+
+void StrToHispeedDelay(const std::string &str, const Cluster &cl, int timer_rate, Interactive::Tunables *t) {
+    int n_opp = cl.model_.opp_model.size();
+    FreqTableStrToArray(str, cl, std::min(ABOVE_DELAY_MAX_LEN, n_opp), timer_rate, true, t->above_hispeed_delay);
+}
+
+template <typename T>
+void JsonToTunable(const nlohmann::json &j, const Soc &soc, T *t) {
+    return;
+}
+
+template <>
+void JsonToTunable<GovernorTs<Interactive>>(const nlohmann::json &j, const Soc &soc, GovernorTs<Interactive> *t) {
+    int cluster_num = soc.clusters_.size();
+    for (int idx_cluster = 0; idx_cluster < cluster_num; ++idx_cluster) {
+        const auto &cl_param = j.at(idx_cluster);
+        const auto &cl       = soc.clusters_[idx_cluster];
+        auto &      g        = t->t[idx_cluster];
+
+        // uperf使用的参数固定按照timer_rate为2个quantum生成
+        g.hispeed_freq        = cl.freq_floor_to_opp((int)cl_param["hispeed_freq"] / 1000);
+        g.go_hispeed_load     = cl_param["go_hispeed_load"];
+        g.min_sample_time     = UsToMultiple(cl_param["min_sample_time"], 2);
+        g.max_freq_hysteresis = UsToMultiple(cl_param["max_freq_hysteresis"], 2);
+        StrToHispeedDelay(cl_param["above_hispeed_delay"], cl, 2, &g);
+        StrToTargetLoads(cl_param["target_loads"], cl, &g);
+    }
+}
+
+template <>
+void JsonToTunable<WaltHmp::Tunables>(const nlohmann::json &j, const Soc &soc, WaltHmp::Tunables *t) {
+    t->sched_downmigrate         = j["sched_downmigrate"];
+    t->sched_upmigrate           = j["sched_upmigrate"];
+    t->sched_ravg_hist_size      = j["sched_ravg_hist_size"];
+    t->sched_window_stats_policy = j["sched_window_stats_policy"];
+    t->sched_boost               = j["sched_boost"];
+    t->timer_rate                = j["timer_rate"];
+}
+
+template <>
+void JsonToTunable<PeltHmp::Tunables>(const nlohmann::json &j, const Soc &soc, PeltHmp::Tunables *t) {
+    t->down_threshold     = j["down_threshold"];
+    t->up_threshold       = j["up_threshold"];
+    t->load_avg_period_ms = j["load_avg_period_ms"];
+    t->boost              = j["boost"];
+    t->timer_rate         = j["timer_rate"];
+}
+
+// uperf的boost参数只记录了升频时的最低最高频率和迁移阈值
+template <typename T>
+void JsonToUperfTunable(const nlohmann::json &j, const Soc &soc, T *t) {
+    int cluster_num = soc.clusters_.size();
+    for (int idx_cluster = 0; idx_cluster < cluster_num; ++idx_cluster) {
+        t->min_freq[idx_cluster] = j["cpufreq"].at(idx_cluster)["min_freq"];
+        t->max_freq[idx_cluster] = j["cpufreq"].at(idx_cluster)["max_freq"];
+    }
+    t->enabled = true;
+}
+
+template <>
+void JsonToTunable<UperfBoostWalt::Tunables>(const nlohmann::json &j, const Soc &soc, UperfBoostWalt::Tunables *t) {
+    JsonToUperfTunable(j, soc, t);
+    t->sched_up   = j["sched"]["sched_upmigrate"];
+    t->sched_down = j["sched"]["sched_downmigrate"];
+}
+
+template <>
+void JsonToTunable<UperfBoostPelt::Tunables>(const nlohmann::json &j, const Soc &soc, UperfBoostPelt::Tunables *t) {
+    JsonToUperfTunable(j, soc, t);
+    t->sched_up   = j["sched"]["up_threshold"];
+    t->sched_down = j["sched"]["down_threshold"];
+}
+
+// powercfg脚本中一个level的参数，键为"c0.target_loads"，"sched.sched_upmigrate"，"input_boost_ms"这样的形式
+using ShellVals = std::map<std::string, std::string>;
+
+int ShellValToInt(const ShellVals &vals, const std::string &key) {
+    auto it = vals.find(key);
+    if (it == vals.end()) {
+        using namespace std;
+        cout << "powercfg missing parameter: " << key << endl;
+        throw runtime_error("powercfg missing parameter");
+    }
+    return std::stoi(it->second);
+}
+
+const std::string &ShellValToStr(const ShellVals &vals, const std::string &key) {
+    auto it = vals.find(key);
+    if (it == vals.end()) {
+        using namespace std;
+        cout << "powercfg missing parameter: " << key << endl;
+        throw runtime_error("powercfg missing parameter");
+    }
+    return it->second;
+}
+
+// timer_rate在interactive中按us记录，sched中按quantum记录
+int ShellTimerRate(const ShellVals &vals) {
+    return ShellValToInt(vals, "c0.timer_rate") / Ms2Us(Quantum2Ms(1));
+}
+
+template <typename T>
+void ShellValsToTunable(const ShellVals &vals, const Soc &soc, T *t) {
+    return;
+}
+
+template <>
+void ShellValsToTunable<GovernorTs<Interactive>>(const ShellVals &vals, const Soc &soc, GovernorTs<Interactive> *t) {
+    const int timer_rate  = ShellTimerRate(vals);
+    const int cluster_num = soc.clusters_.size();
+    for (int idx_cluster = 0; idx_cluster < cluster_num; ++idx_cluster) {
+        const auto &cl     = soc.clusters_[idx_cluster];
+        auto &      g      = t->t[idx_cluster];
+        std::string prefix = "c" + std::to_string(idx_cluster) + ".";
+
+        g.hispeed_freq        = cl.freq_floor_to_opp(ShellValToInt(vals, prefix + "hispeed_freq") / 1000);
+        g.go_hispeed_load     = ShellValToInt(vals, prefix + "go_hispeed_load");
+        g.min_sample_time     = UsToMultiple(ShellValToInt(vals, prefix + "min_sample_time"), timer_rate);
+        g.max_freq_hysteresis = UsToMultiple(ShellValToInt(vals, prefix + "max_freq_hysteresis"), timer_rate);
+        StrToHispeedDelay(ShellValToStr(vals, prefix + "above_hispeed_delay"), cl, timer_rate, &g);
+        StrToTargetLoads(ShellValToStr(vals, prefix + "target_loads"), cl, &g);
+    }
+}
+
+template <>
+void ShellValsToTunable<WaltHmp::Tunables>(const ShellVals &vals, const Soc &soc, WaltHmp::Tunables *t) {
+    t->sched_downmigrate         = ShellValToInt(vals, "sched.sched_downmigrate");
+    t->sched_upmigrate           = ShellValToInt(vals, "sched.sched_upmigrate");
+    t->sched_ravg_hist_size      = ShellValToInt(vals, "sched.sched_ravg_hist_size");
+    t->sched_window_stats_policy = ShellValToInt(vals, "sched.sched_window_stats_policy");
+    t->sched_boost               = ShellValToInt(vals, "sched.sched_boost");
+    t->timer_rate                = ShellTimerRate(vals);
+}
+
+template <>
+void ShellValsToTunable<PeltHmp::Tunables>(const ShellVals &vals, const Soc &soc, PeltHmp::Tunables *t) {
+    t->down_threshold     = ShellValToInt(vals, "sched.down_threshold");
+    t->up_threshold       = ShellValToInt(vals, "sched.up_threshold");
+    t->load_avg_period_ms = ShellValToInt(vals, "sched.load_avg_period_ms");
+    t->boost              = ShellValToInt(vals, "sched.boost");
+    t->timer_rate         = ShellTimerRate(vals);
+}
+
+// 解析形如"0:902000 1:0 2:0 3:0 4:1401000"的参数
+template <typename T>
+void ShellValsToInputBoostTunable(const ShellVals &vals, const Soc &soc, T *t) {
+    if (soc.GetInputBoostFeature() == false)
+        return;
+
+    std::map<int, int> core_freq;
+    {
+        std::istringstream ss(ShellValToStr(vals, "input_boost_freq"));
+        std::string        token;
+        while (ss >> token) {
+            auto pos = token.find(':');
+            if (pos != std::string::npos)
+                core_freq[std::stoi(token.substr(0, pos))] = std::stoi(token.substr(pos + 1)) / 1000;
+        }
+    }
+
+    int first_core = 0;
+    int idx        = 0;
+    for (const auto &cluster : soc.clusters_) {
+        t->boost_freq[idx++] = core_freq[first_core];
+        first_core += cluster.model_.core_num;
+    }
+    t->duration_quantum = ShellValToInt(vals, "input_boost_ms") / Quantum2Ms(1);
+}
+
+template <>
+void ShellValsToTunable<InputBoostWalt::Tunables>(const ShellVals &vals, const Soc &soc, InputBoostWalt::Tunables *t) {
+    ShellValsToInputBoostTunable(vals, soc, t);
+}
+
+template <>
+void ShellValsToTunable<InputBoostPelt::Tunables>(const ShellVals &vals, const Soc &soc, InputBoostPelt::Tunables *t) {
+    ShellValsToInputBoostTunable(vals, soc, t);
+}
+
+// sysfs_obj路径转换为参数的键，"${C0_GOVERNOR_DIR}/target_loads" -> "c0.target_loads"
+std::string SysfsObjToKey(const std::string &obj) {
+    static const std::regex var_re("^\\$\\{(C(\\d+)_GOVERNOR_DIR|SCHED_DIR)\\}/(\\w+)$");
+
+    std::smatch m;
+    if (std::regex_match(obj, m, var_re)) {
+        if (m[1] == "SCHED_DIR")
+            return "sched." + m[3].str();
+        return "c" + m[2].str() + "." + m[3].str();
+    }
+    // 其余的使用文件名作为键，例如"input_boost_ms"，cpufreq目录下的参数不需要读回
+    if (obj.find("_DIR}") != std::string::npos)
+        return std::string();
+    return obj.substr(obj.find_last_of('/') + 1);
+}
+
+template <typename SimType>
+typename SimType::Tunables Loader<SimType>::GenerateDefaultTunables(void) const {
+    typename SimType::Tunables t;
+    int                        idx = 0;
+    for (const auto &cluster : soc_.clusters_)
+        t.governor.t[idx++] = typename SimType::Governor::Tunables(cluster);
+    t.sched     = typename SimType::Sched::Tunables();
+    t.has_boost = IsSupportBoost<typename SimType::Boost>(&soc_);
+    if (t.has_boost) {
+        t.boost = typename SimType::Boost::Tunables(&soc_);
+    }
+    return t;
+}
+
+template <typename SimType>
+typename Loader<SimType>::NamedTunablesList Loader<SimType>::LoadFromFile(const std::string &path) const {
+    auto ends_with = [&path](const std::string &suffix) {
+        return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+
+    if (ends_with(".json"))
+        return LoadFromUperfJson(path);
+    if (ends_with(".sh"))
+        return LoadFromShellScript(path);
+
+    using namespace std;
+    cout << "Unknown parameter file type: " << path << endl;
+    throw runtime_error("unknown parameter file type");
+}
+
+template <typename SimType>
+typename Loader<SimType>::NamedTunablesList Loader<SimType>::LoadFromUperfJson(const std::string &path) const {
+    nlohmann::json j;
+    {
+        std::ifstream ifs(path);
+        if (!ifs.good()) {
+            using namespace std;
+            cout << "Parameter file access ERROR: " << path << endl;
+            throw runtime_error("file access error");
+        }
+        ifs >> j;
+    }
+
+    NamedTunablesList ret;
+    for (const auto &mode_name : {"performance", "balance", "powersave"}) {
+        if (j.count(mode_name) == 0)
+            continue;
+        const auto &mode = j[mode_name];
+
+        NamedTunables nt;
+        nt.name    = mode_name;
+        nt.tunable = GenerateDefaultTunables();
+        JsonToTunable<GovernorTs<typename SimType::Governor>>(mode["normal"]["cpufreq"], soc_, &nt.tunable.governor);
+        JsonToTunable<typename SimType::Sched::Tunables>(mode["normal"]["sched"], soc_, &nt.tunable.sched);
+        JsonToTunable<typename SimType::Boost::Tunables>(mode["boost"], soc_, &nt.tunable.boost);
+        ret.push_back(nt);
+    }
+    return ret;
+}
+
+template <typename SimType>
+typename Loader<SimType>::NamedTunablesList Loader<SimType>::LoadFromShellScript(const std::string &path) const {
+    std::ifstream ifs(path);
+    if (!ifs.good()) {
+        using namespace std;
+        cout << "Parameter file access ERROR: " << path << endl;
+        throw runtime_error("file access error");
+    }
+
+    static const std::regex obj_re("^sysfs_obj(\\d+)=\"(.*)\"$");
+    static const std::regex val_re("^level(\\d+)_val(\\d+)=\"(.*)\"$");
+
+    std::map<int, std::string>                sysfs_objs;
+    std::map<int, std::map<int, std::string>> level_vals;
+
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        std::smatch m;
+        if (std::regex_match(line, m, obj_re)) {
+            sysfs_objs[std::stoi(m[1])] = m[2];
+        } else if (std::regex_match(line, m, val_re)) {
+            level_vals[std::stoi(m[1])][std::stoi(m[2])] = m[3];
+        }
+    }
+
+    NamedTunablesList ret;
+    for (const auto &level : level_vals) {
+        ShellVals vals;
+        for (const auto &v : level.second) {
+            std::string key = SysfsObjToKey(sysfs_objs[v.first]);
+            if (!key.empty())
+                vals[key] = v.second;
+        }
+
+        NamedTunables nt;
+        nt.name    = "level" + std::to_string(level.first);
+        nt.tunable = GenerateDefaultTunables();
+        ShellValsToTunable<GovernorTs<typename SimType::Governor>>(vals, soc_, &nt.tunable.governor);
+        ShellValsToTunable<typename SimType::Sched::Tunables>(vals, soc_, &nt.tunable.sched);
+        ShellValsToTunable<typename SimType::Boost::Tunables>(vals, soc_, &nt.tunable.boost);
+        ret.push_back(nt);
+    }
+    return ret;
+}
+
+template <>
+Loader<SimQcomBL>::NamedTunablesList Loader<SimQcomBL>::LoadFromUperfJson(const std::string &path) const {
+    // 只有uperf支持json
+    using namespace std;
+    cout << "Uperf json requires \"useUperf\": true, skipped: " << path << endl;
+    return NamedTunablesList();
+}
+
+template <>
+Loader<SimBL>::NamedTunablesList Loader<SimBL>::LoadFromUperfJson(const std::string &path) const {
+    // 只有uperf支持json
+    using namespace std;
+    cout << "Uperf json requires \"useUperf\": true, skipped: " << path << endl;
+    return NamedTunablesList();
+}
+
+template <>
+Loader<SimQcomUp>::NamedTunablesList Loader<SimQcomUp>::LoadFromShellScript(const std::string &path) const {
+    // Uperf类型不使用shell脚本控制
+    using namespace std;
+    cout << "powercfg requires \"useUperf\": false, skipped: " << path << endl;
+    return NamedTunablesList();
+}
+
+template <>
+Loader<SimUp>::NamedTunablesList Loader<SimUp>::LoadFromShellScript(const std::string &path) const {
+    // Uperf类型不使用shell脚本控制
+    using namespace std;
+    cout << "powercfg requires \"useUperf\": false, skipped: " << path << endl;
+    return NamedTunablesList();
+}
+
+template class Loader<SimQcomBL>;
+template class Loader<SimBL>;
+template class Loader<SimQcomUp>;
+template class Loader<SimUp>;
@@ -0,0 +1,34 @@
+#ifndef __LOAD_H
+#define __LOAD_H
+
+#include <string>
+#include <vector>
+#include "cpumodel.h"
+#include "openga_helper.h"
+#include "sim.hpp"
+
+// 从Dumper输出的文件中读回参数，用于评估已有的参数组合
+template <typename SimType>
+class Loader {
+public:
+    struct NamedTunables {
+        std::string                name;
+        typename SimType::Tunables tunable;
+    };
+
+    using NamedTunablesList = std::vector<NamedTunables>;
+
+    Loader() = delete;
+    Loader(const Soc &soc) : soc_(soc){};
+    // 根据扩展名选择解析方式，.json为uperf配置，.sh为powercfg脚本
+    NamedTunablesList LoadFromFile(const std::string &path) const;
+    NamedTunablesList LoadFromUperfJson(const std::string &path) const;
+    NamedTunablesList LoadFromShellScript(const std::string &path) const;
+
+private:
+    typename SimType::Tunables GenerateDefaultTunables(void) const;
+
+    const Soc soc_;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "trace_export.h"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "misc.h"
+#include "recorder.h"
+
+static std::ofstream OpenOutput(const std::string &out_file) {
+    std::ofstream ofs(out_file);
+    if (!ofs.good()) {
+        using namespace std;
+        cout << "Trace export file access ERROR: " << out_file << endl;
+        throw runtime_error("file access error");
+    }
+    return ofs;
+}
+
+static bool IsLag(const TraceQuantum &q) {
+    return !q.offscreen && q.demand > q.capacity;
+}
+
+void ExportTraceToCSV(const std::string &trace_file, const std::string &out_file) {
+    TraceReader   reader(trace_file);
+    std::ofstream ofs = OpenOutput(out_file);
+
+    const auto &freqs = reader.GetFreqs();
+    ofs << "quantum,n_quantum,offscreen,little_freq,big_freq,active_cluster,in_boost,capacity,demand,lag,power\n";
+
+    TraceQuantum q;
+    while (reader.Next(&q)) {
+        ofs << q.quantum << ',' << q.n_quantum << ',' << q.offscreen << ',' << freqs.front()[q.little_opp] << ','
+            << freqs.back()[q.big_opp] << ',' << q.active_cluster << ',' << q.in_boost << ',' << q.capacity << ','
+            << q.demand << ',' << IsLag(q) << ',' << q.power << '\n';
+    }
+}
+
+void ExportTraceToPerfetto(const std::string &trace_file, const std::string &out_file) {
+    TraceReader   reader(trace_file);
+    std::ofstream ofs = OpenOutput(out_file);
+
+    const auto &freqs = reader.GetFreqs();
+    const char *names[] = {"little_freq", "big_freq", "active_cluster", "in_boost", "capacity", "demand", "power"};
+    const int   n_track = sizeof(names) / sizeof(names[0]);
+    int         last[n_track];
+    bool        first = true;
+
+    // 记录量很大，直接按格式流式输出，不构造整个JSON对象
+    ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    auto emit = [&](const char *name, const char *ph, int quantum, int value) {
+        ofs << (first ? "" : ",\n") << "{\"name\":\"" << name << "\",\"ph\":\"" << ph
+            << "\",\"ts\":" << Ms2Us(Quantum2Ms(quantum)) << ",\"pid\":1,\"tid\":1";
+        if (ph[0] == 'C')
+            ofs << ",\"args\":{\"value\":" << value << "}";
+        else
+            ofs << ",\"s\":\"g\"";
+        ofs << "}";
+        first = false;
+    };
+
+    TraceQuantum q;
+    bool         has_last  = false;
+    bool         offscreen = false;
+    while (reader.Next(&q)) {
+        const int cur[n_track] = {freqs.front()[q.little_opp], freqs.back()[q.big_opp], q.active_cluster, q.in_boost,
+                                  q.capacity, q.demand, q.power};
+        for (int i = 0; i < n_track; ++i) {
+            if (!has_last || cur[i] != last[i])
+                emit(names[i], "C", q.quantum, cur[i]);
+            last[i] = cur[i];
+        }
+        if (IsLag(q))
+            emit("lag", "i", q.quantum, 0);
+        if (q.offscreen && !offscreen)
+            emit("screen_off", "i", q.quantum, 0);
+        offscreen = q.offscreen;
+        has_last  = true;
+    }
+    ofs << "\n]}\n";
+}
@@ -0,0 +1,12 @@
+#ifndef __TRACE_EXPORT_H
+#define __TRACE_EXPORT_H
+
+#include <string>
+
+// 把TraceRecorder输出的二进制记录转换为可读的格式
+// 每个时间片一行，频率为MHz，lag为1时该时间片的需求超过了性能容量
+void ExportTraceToCSV(const std::string &trace_file, const std::string &out_file);
+// Chrome trace event格式的JSON，可以用Perfetto UI打开，每个字段是一条计数器轨道，只在数值变化时输出
+void ExportTraceToPerfetto(const std::string &trace_file, const std::string &out_file);
+
+#endif
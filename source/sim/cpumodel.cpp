@@ -6,13 +6,17 @@
 #include "json.hpp"
 
 Cluster::Cluster(Model model) : model_(model) {
+    for (const auto &opp : model_.opp_model) {
+        busy_div_.push_back(Divider<31>(opp.freq * model_.efficiency));
+    }
+
     busy_pct_ = 0;
     SetMinfreq(model.min_freq);
     SetMaxfreq(model.max_freq);
     SetCurfreq(model.max_freq);
 }
 
-Soc::Soc(const std::string &model_file) {
+Soc::Soc(const std::string &model_file) : model_file_(model_file) {
     std::ifstream  ifs(model_file);
     nlohmann::json j;
     ifs >> j;
@@ -53,4 +57,18 @@ Soc::Soc(const std::string &model_file) {
         }
         clusters_.push_back(Cluster(m));
     }
+
+    // 各集群核心数相同才能使用展开的实现
+    const int core_num = clusters_[0].model_.core_num;
+    topology_          = kTopoGeneric;
+    for (const auto &c : clusters_) {
+        if (c.model_.core_num != core_num)
+            return;
+    }
+    if (clusters_.size() == 1 && core_num == 4)
+        topology_ = kTopo4;
+    else if (clusters_.size() == 2 && core_num == 2)
+        topology_ = kTopo2Plus2;
+    else if (clusters_.size() == 2 && core_num == 4)
+        topology_ = kTopo4Plus4;
 }
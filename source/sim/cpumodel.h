@@ -6,6 +6,8 @@
 #include <string>
 #include <vector>
 
+#include "divider.h"
+
 class Cluster {
 public:
     typedef struct _Pwr {
@@ -22,23 +24,44 @@ public:
         std::vector<Pwr> opp_model;
     } Model;
 
+    // 可以按字节复制的运行状态，频点表和除法器由模型决定，不在其中
+    typedef struct _State {
+        int busy_pct;
+        int min_freq;
+        int max_freq;
+        int cur_freq;
+        int min_opp_idx;
+        int max_opp_idx;
+        int cur_opp_idx;
+    } State;
+
     Cluster(Model model);
     int  FindFreqIdx(int freq, int left, int right) const;
     int  freq_floor_to_idx(int freq) const;
     int  freq_ceiling_to_idx(int freq) const;
     int  freq_floor_to_opp(int freq) const;
     int  freq_ceiling_to_opp(int freq) const;
-    int  CalcPower(const int *load_pcts) const;
+    int  CalcPower(const int *load_pcts) const { return CalcPower<0>(load_pcts); }
+    // @kCoreNum为编译期确定的核心数，为0时使用模型中的核心数
+    template <int kCoreNum>
+    int CalcPower(const int *load_pcts) const;
     int  CalcCapacity(void) const;
     int  GetBusyPct(void) const { return busy_pct_; }
     int  GetMinfreq(void) const { return min_freq_; }
     int  GetMaxfreq(void) const { return max_freq_; }
     int  GetCurfreq(void) const { return cur_freq_; }
+    int  GetCurOppIdx(void) const { return cur_opp_idx_; }
     int  GetOpp(int idx) const { return model_.opp_model[idx].freq; }
+    // 负载需求转换为当前频点的使用率，@load为freq * busy_pct * efficiency，不超过2^31
+    int  LoadToBusyPct(uint64_t load) const { return cur_busy_div_.Div(load); }
     void SetBusyPct(int load) { busy_pct_ = load; }
     void SetMinfreq(int freq);
     void SetMaxfreq(int freq);
     void SetCurfreq(int freq);
+    // 从同一个模型的集群恢复运行状态，不复制频点表
+    void ResetState(const Cluster &src);
+    void SaveState(State *s) const;
+    void RestoreState(const State &s);
 
     const Model model_;
 
@@ -52,6 +75,10 @@ private:
     int min_opp_idx_;
     int max_opp_idx_;
     int cur_opp_idx_;
+
+    // 每个频点的freq * efficiency除法，在读取模型时预先计算
+    std::vector<Divider<31>> busy_div_;
+    Divider<31>              cur_busy_div_;
 };
 
 // 在给定下标闭区间内，找到 >=@freq的最低频点对应的opp频点序号
@@ -101,37 +128,84 @@ inline void Cluster::SetMaxfreq(int freq) {
 }
 
 inline void Cluster::SetCurfreq(int freq) {
-    cur_opp_idx_ = freq_floor_to_idx(freq);
-    cur_freq_    = GetOpp(cur_opp_idx_);
+    cur_opp_idx_  = freq_floor_to_idx(freq);
+    cur_freq_     = GetOpp(cur_opp_idx_);
+    cur_busy_div_ = busy_div_[cur_opp_idx_];
+}
+
+inline void Cluster::ResetState(const Cluster &src) {
+    busy_pct_     = src.busy_pct_;
+    min_freq_     = src.min_freq_;
+    max_freq_     = src.max_freq_;
+    cur_freq_     = src.cur_freq_;
+    min_opp_idx_  = src.min_opp_idx_;
+    max_opp_idx_  = src.max_opp_idx_;
+    cur_opp_idx_  = src.cur_opp_idx_;
+    cur_busy_div_ = src.cur_busy_div_;
+}
+
+inline void Cluster::SaveState(State *s) const {
+    s->busy_pct    = busy_pct_;
+    s->min_freq    = min_freq_;
+    s->max_freq    = max_freq_;
+    s->cur_freq    = cur_freq_;
+    s->min_opp_idx = min_opp_idx_;
+    s->max_opp_idx = max_opp_idx_;
+    s->cur_opp_idx = cur_opp_idx_;
+}
+
+inline void Cluster::RestoreState(const State &s) {
+    busy_pct_     = s.busy_pct;
+    min_freq_     = s.min_freq;
+    max_freq_     = s.max_freq;
+    cur_freq_     = s.cur_freq;
+    min_opp_idx_  = s.min_opp_idx;
+    max_opp_idx_  = s.max_opp_idx;
+    cur_opp_idx_  = s.cur_opp_idx;
+    cur_busy_div_ = busy_div_[cur_opp_idx_];
 }
 
 // 耗电量 = 功耗(mw) * 占用率(最大100)
+template <int kCoreNum>
 inline int Cluster::CalcPower(const int *load_pcts) const {
-    int pwr      = model_.opp_model[cur_opp_idx_].cluster_power * 100;
-    int core_pwr = model_.opp_model[cur_opp_idx_].core_power;
-    for (int i = 0; i < model_.core_num; ++i) {
-        pwr += core_pwr * load_pcts[i];
+    const int   core_num = kCoreNum ? kCoreNum : model_.core_num;
+    const auto &opp      = model_.opp_model[cur_opp_idx_];
+    int         sum_pct  = 0;
+    for (int i = 0; i < core_num; ++i) {
+        sum_pct += load_pcts[i];
     }
-    return pwr;
+    return opp.cluster_power * 100 + opp.core_power * sum_pct;
 }
 
 inline int Cluster::CalcCapacity() const {
     return (cur_freq_ * model_.efficiency * 100);
 }
 
+// 编译期确定的拓扑，每个集群的核心数和集群数，都为0时是运行时判断的通用实现
+template <int CoreNum, int ClusterNum>
+struct Topology {
+    static const int kCoreNum    = CoreNum;
+    static const int kClusterNum = ClusterNum;
+};
+
+using TopologyGeneric = Topology<0, 0>;
+
 class Soc {
 public:
     // 多核心模式
     typedef enum _IntraType { kSMP = 0, kASMP } IntraType;
     // 使用的调度器类型
     typedef enum _SchedType { kLegacy = 0, kWalt, kPelt } SchedType;
+    // 已知的拓扑，仿真时据此选择展开的实现，其余使用通用实现
+    typedef enum _TopologyType { kTopoGeneric = 0, kTopo4, kTopo2Plus2, kTopo4Plus4 } TopologyType;
 
     Soc(const std::string &model_file);
     ~Soc(){};
 
-    IntraType GetIntraType(void) const { return intra_type_; }
-    SchedType GetSchedType(void) const { return sched_type_; }
-    bool      GetInputBoostFeature(void) const { return input_boost_; }
+    IntraType    GetIntraType(void) const { return intra_type_; }
+    SchedType    GetSchedType(void) const { return sched_type_; }
+    bool         GetInputBoostFeature(void) const { return input_boost_; }
+    TopologyType GetTopology(void) const { return topology_; }
 
     int GetLittleClusterIdx(void) const { return 0; }
     int GetBigClusterIdx(void) const { return clusters_.size() - 1; }
@@ -144,16 +218,25 @@ public:
         return (clusters_.back().model_.max_freq * clusters_.back().model_.efficiency * 98);
     }
 
+    // 从同一个模型的SOC恢复各个集群的运行状态，仿真时复用副本而不是每次复制整个模型
+    void ResetState(const Soc &src) {
+        for (size_t i = 0; i < clusters_.size(); ++i) {
+            clusters_[i].ResetState(src.clusters_[i]);
+        }
+    }
+
     std::string          name_;
+    std::string          model_file_;
     std::vector<Cluster> clusters_;
 
 private:
     Soc();
 
-    IntraType intra_type_;
-    SchedType sched_type_;
-    bool      input_boost_;
-    int       enough_capacity_pct_;  // 提供的容量大于SOC最大容量xx%的跳过卡顿判断
+    IntraType    intra_type_;
+    SchedType    sched_type_;
+    bool         input_boost_;
+    TopologyType topology_;
+    int          enough_capacity_pct_;  // 提供的容量大于SOC最大容量xx%的跳过卡顿判断
 };
 
 #endif
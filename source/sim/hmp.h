@@ -5,6 +5,7 @@
 
 #include "cpumodel.h"
 #include "interactive.h"
+#include "workload.h"
 
 class Hmp {
 public:
@@ -30,13 +31,36 @@ public:
         cluster_num_ = (big_ == little_) ? 1 : 2;
     }
 
+    // @TopoT为编译期确定的拓扑，TopologyGeneric为运行时判断的通用实现
+    template <typename TopoT>
     int SchedulerTick(int max_load, const int *loads, int n_load, int now) { return 0; };
+    template <typename TopoT>
     int CalcPower(const int *loads) const;
+    template <typename TopoT>
     int CalcPowerForIdle(const int *loads) const;
 
+    // 负载所在的集群，0为小核，1为大核，只有一个集群时总是0
+    int GetActiveCluster(void) const { return (active_ == little_) ? 0 : 1; }
+
+    // 灭屏快进，小核活跃且两个调速器都处于最低频率的不动点时，返回每个时间片允许的最大负载需求，否则返回-1
+    int QuietDemand(void) const { return -1; }
+    // 从@begin开始跳过至多@n个负载需求不超过QuietDemand的时间片，返回实际跳过的数量
+    int FastForward(const Workload &work, int begin, int n) { return 0; }
+
 protected:
 #define NLoadsMax 4
     int LoadToBusyPct(const Cluster *c, uint64_t load) const;
+    int GovernorQuietDemand(int now) const;
+    template <typename TopoT>
+    bool HasBigCluster(void) const {
+        return TopoT::kClusterNum ? (TopoT::kClusterNum > 1) : (cluster_num_ > 1);
+    }
+    // 快进@n_period次调频器采样，@max_load_avg为最后一次采样的负载
+    void GovernorFastForward(int *governor_cnt, int n_period, int max_load_avg);
+    void SetActiveCluster(int idx) {
+        active_ = idx ? big_ : little_;
+        idle_   = idx ? little_ : big_;
+    }
 
     Cluster *    little_;
     Cluster *    big_;
@@ -50,33 +74,57 @@ protected:
 };
 
 inline int Hmp::LoadToBusyPct(const Cluster *c, uint64_t load) const {
-    return (load / (c->GetCurfreq() * c->model_.efficiency));
+    return c->LoadToBusyPct(load);
+}
+
+// 活跃的小核使用率不超过调速器允许的最大负载，闲置的大核使用率为0
+inline int Hmp::GovernorQuietDemand(int now) const {
+    if (active_ != little_)
+        return -1;
+    const int little_load = governor_little_->QuietLoad(now);
+    if (little_load < 0 || (cluster_num_ > 1 && governor_big_->QuietLoad(now) < 0))
+        return -1;
+    // LoadToBusyPct向下取整，需求小于(load + 1)%都满足
+    return (little_load + 1) * little_->GetCurfreq() * little_->model_.efficiency - 1;
+}
+
+inline void Hmp::GovernorFastForward(int *governor_cnt, int n_period, int max_load_avg) {
+    *governor_cnt += n_period;
+    idle_->SetBusyPct(0);
+    active_->SetBusyPct(LoadToBusyPct(active_, max_load_avg));
+    governor_little_->FastForward(*governor_cnt - 1);
+    if (cluster_num_ > 1)
+        governor_big_->FastForward(*governor_cnt - 1);
 }
 
 // 外层保证已执行adaptload，负载百分比不超过100%
 // loads: freq * busy_pct * efficiency
+// 集群只用到前core_num个负载，拓扑确定时只计算这些
+template <typename TopoT>
 inline int Hmp::CalcPower(const int *loads) const {
+    const int n_loads          = TopoT::kCoreNum ? TopoT::kCoreNum : NLoadsMax;
     const int idle_load_pcts[] = {1, 0, 0, 0};
     int       load_pcts[NLoadsMax];
-    for (int i = 0; i < NLoadsMax; ++i) {
-        load_pcts[i] = loads[i] / (active_->model_.efficiency * active_->GetCurfreq());
+    for (int i = 0; i < n_loads; ++i) {
+        load_pcts[i] = active_->LoadToBusyPct(loads[i]);
     }
 
     int pwr = 0;
-    pwr += active_->CalcPower(load_pcts);
-    pwr += idle_->CalcPower(idle_load_pcts);
+    pwr += active_->CalcPower<TopoT::kCoreNum>(load_pcts);
+    pwr += idle_->CalcPower<TopoT::kCoreNum>(idle_load_pcts);
     return pwr;
 }
 
 // 如果负载没有被移动到大核，则认为大核没有闲置耗电，减少待机时大核上线概率
+template <typename TopoT>
 inline int Hmp::CalcPowerForIdle(const int *loads) const {
     const int idle_load_pcts[] = {100, 0, 0, 0};
     int       pwr              = 0;
-    if (active_ == little_) {
-        pwr += little_->CalcPower(idle_load_pcts);
+    if (!HasBigCluster<TopoT>() || active_ == little_) {
+        pwr += little_->CalcPower<TopoT::kCoreNum>(idle_load_pcts);
     } else {
-        pwr += little_->CalcPower(idle_load_pcts);
-        pwr += big_->CalcPower(idle_load_pcts);
+        pwr += little_->CalcPower<TopoT::kCoreNum>(idle_load_pcts);
+        pwr += big_->CalcPower<TopoT::kCoreNum>(idle_load_pcts);
     }
     return pwr;
 }
@@ -104,11 +104,47 @@ void PeltHmp::SetTunables(const Tunables &t) {
     tunables_        = t;
     up_demand_thd_   = tunables_.up_threshold;
     down_demand_thd_ = tunables_.down_threshold;
+    timer_div_       = Divider<48>(std::max(1, tunables_.timer_rate));
 }
 
+void PeltHmp::SaveState(State *s) const {
+    s->demand         = demand_;
+    s->max_load_sum   = max_load_sum_;
+    s->entry_cnt      = entry_cnt_;
+    s->governor_cnt   = governor_cnt_;
+    s->active_cluster = GetActiveCluster();
+}
+
+void PeltHmp::RestoreState(const State &s) {
+    demand_       = s.demand;
+    max_load_sum_ = s.max_load_sum;
+    entry_cnt_    = s.entry_cnt;
+    governor_cnt_ = s.governor_cnt;
+    SetActiveCluster(s.active_cluster);
+}
+
+// 参数范围通常固定了load_avg_period_ms，每次仿真都重新计算pow、LoadAvgMax的迭代和除数没有必要
+// 每个线程记住上一次的结果，参数变化时才重新计算
 void PeltHmp::InitDecay(int ms, int n) {
-    decay_ratio_  = CalcDecayRatio(TICK_MS, tunables_.load_avg_period_ms);
-    load_avg_max_ = CalcLoadAvgMax(decay_ratio_);
+    struct DecayCache {
+        int         ms;
+        int         n;
+        uint32_t    decay_ratio;
+        uint32_t    load_avg_max;
+        Divider<48> load_avg_div;
+    };
+    static thread_local DecayCache cache = {-1, -1, 0, 0, Divider<48>()};
+
+    if (cache.ms != ms || cache.n != n) {
+        cache.ms           = ms;
+        cache.n            = n;
+        cache.decay_ratio  = CalcDecayRatio(ms, n);
+        cache.load_avg_max = CalcLoadAvgMax(cache.decay_ratio);
+        cache.load_avg_div = Divider<48>(cache.load_avg_max);
+    }
+    decay_ratio_  = cache.decay_ratio;
+    load_avg_max_ = cache.load_avg_max;
+    load_avg_div_ = cache.load_avg_div;
 }
 
 #define THRESHOLD_SCALE 1024
@@ -121,12 +157,52 @@ uint64_t PeltHmp::UpdateBusyTime(int max_load) {
     // 衰减之前的负载，加上新的，如果是持续稳定负载类似于等比数列求和
     demand_ = now + mul_u64_u32_shr(demand_, decay_ratio_, 32);
     // 以最大可达到的使用率为1024
-    return demand_ * THRESHOLD_SCALE / load_avg_max_;
+    return load_avg_div_.Div(demand_ * THRESHOLD_SCALE);
+}
+
+int PeltHmp::QuietDemand(void) const {
+    if (entry_cnt_ != 0)
+        return -1;
+    return GovernorQuietDemand(governor_cnt_);
+}
+
+// 只按整个timer_rate快进，逐个时间片衰减负载，在使用率超过上迁阈值的采样周期之前停止
+int PeltHmp::FastForward(const Workload &work, int begin, int n) {
+    const int n_period = n / tunables_.timer_rate;
+    const int capacity = active_->CalcCapacity();
+
+    uint64_t demand       = demand_;
+    int      max_load_avg = 0;
+    int      n_done       = 0;
+    for (; n_done < n_period; ++n_done) {
+        uint64_t d    = demand;
+        uint64_t sum  = 0;
+        bool     stay = true;
+        for (int i = 0; i < tunables_.timer_rate && stay; ++i) {
+            const auto &   s    = work.windowed_load_[begin + n_done * tunables_.timer_rate + i];
+            const int      load = std::min(work.PctToDemand(s.max_load), capacity);
+            const uint64_t now = LoadToBusyPct(active_, load) * THRESHOLD_SCALE / 100;
+            d                  = now + mul_u64_u32_shr(d, decay_ratio_, 32);
+            stay               = (load_avg_div_.Div(d * THRESHOLD_SCALE) <= up_demand_thd_);
+            sum += load;
+        }
+        if (!stay)
+            break;
+        demand       = d;
+        max_load_avg = timer_div_.Div(sum);
+    }
+    if (n_done == 0)
+        return 0;
+
+    demand_ = demand;
+    GovernorFastForward(&governor_cnt_, n_done, max_load_avg);
+    return n_done * tunables_.timer_rate;
 }
 
 // demand : freq * busy_pct * efficiency
 // load: freq * busy_pct * efficiency
 // load 最大值 2500 * 2048 * 100，sum最大值 3000 * 2048 * 400，可能大于UINT32_MAX
+template <typename TopoT>
 int PeltHmp::SchedulerTick(int max_load, const int *loads, int n_load, int now) {
     // 仅用于负载迁移判断，调频器仍然使用定期负载采样
     // 注意这个使用率不考虑当前集群的频率和IPC，仅与CPU忙时间有关
@@ -145,7 +221,7 @@ int PeltHmp::SchedulerTick(int max_load, const int *loads, int n_load, int now)
     max_load_sum_ += max_load;
 
     if (entry_cnt_ == tunables_.timer_rate) {
-        int max_load_avg = max_load_sum_ / tunables_.timer_rate;
+        int max_load_avg = timer_div_.Div(max_load_sum_);
         entry_cnt_       = 0;
         max_load_sum_    = 0;
 
@@ -154,7 +230,7 @@ int PeltHmp::SchedulerTick(int max_load, const int *loads, int n_load, int now)
         active_->SetBusyPct(LoadToBusyPct(active_, max_load_avg));
 
         little_->SetCurfreq(governor_little_->InteractiveTimer(little_->GetBusyPct(), governor_cnt_));
-        if (cluster_num_ > 1)
+        if (HasBigCluster<TopoT>())
             big_->SetCurfreq(governor_big_->InteractiveTimer(big_->GetBusyPct(), governor_cnt_));
 
         ++governor_cnt_;
@@ -162,3 +238,8 @@ int PeltHmp::SchedulerTick(int max_load, const int *loads, int n_load, int now)
 
     return active_->CalcCapacity();
 }
+
+template int PeltHmp::SchedulerTick<TopologyGeneric>(int max_load, const int *loads, int n_load, int now);
+template int PeltHmp::SchedulerTick<Topology<4, 1>>(int max_load, const int *loads, int n_load, int now);
+template int PeltHmp::SchedulerTick<Topology<2, 2>>(int max_load, const int *loads, int n_load, int now);
+template int PeltHmp::SchedulerTick<Topology<4, 2>>(int max_load, const int *loads, int n_load, int now);
@@ -18,12 +18,26 @@ public:
         Tunables tunables;
     };
 
+    // 运行状态，参数和由参数得到的衰减系数不在其中
+    typedef struct _State {
+        uint64_t demand;
+        uint64_t max_load_sum;
+        int      entry_cnt;
+        int      governor_cnt;
+        int      active_cluster;
+    } State;
+
     PeltHmp(){};
     PeltHmp(Cfg cfg);
+    template <typename TopoT>
     int SchedulerTick(int max_load, const int *loads, int n_load, int now);
+    int QuietDemand(void) const;
+    int FastForward(const Workload &work, int begin, int n);
 
     Tunables GetTunables(void) { return tunables_; }
     void     SetTunables(const Tunables &t);
+    void     SaveState(State *s) const;
+    void     RestoreState(const State &s);
 
 private:
     uint64_t UpdateBusyTime(int max_load);
@@ -36,6 +50,9 @@ private:
     uint32_t decay_ratio_;
     uint32_t load_avg_max_;
     int      governor_cnt_;
+
+    Divider<48> load_avg_div_;  // 除以load_avg_max_
+    Divider<48> timer_div_;     // 除以timer_rate
 };
 
 #endif
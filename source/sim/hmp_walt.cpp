@@ -16,7 +16,13 @@ WaltHmp::Tunables::Tunables() {
 }
 
 WaltHmp::WaltHmp(Cfg cfg)
-    : Hmp(cfg), tunables_(cfg.tunables), demand_(0), entry_cnt_(0), max_load_sum_(0), governor_cnt_(0) {
+    : Hmp(cfg),
+      tunables_(cfg.tunables),
+      demand_(0),
+      entry_cnt_(0),
+      max_load_sum_(0),
+      governor_cnt_(0),
+      update_history_(&WaltHmp::UpdateHistory<0, 0>) {
     SetTunables(cfg.tunables);
     memset(sum_history_, 0, sizeof(sum_history_));
     memset(loads_sum_, 0, sizeof(loads_sum_));
@@ -28,20 +34,65 @@ void WaltHmp::SetTunables(const Tunables &t) {
     // equal to max_possible_frequency/current_frequency of a lower capacity CPU
     up_demand_thd_   = little_->model_.max_freq * little_->model_.efficiency * tunables_.sched_upmigrate;
     down_demand_thd_ = little_->model_.max_freq * little_->model_.efficiency * tunables_.sched_downmigrate;
+    timer_div_       = Divider<48>(std::max(1, tunables_.timer_rate));
+
+    // 每种窗口大小和统计策略都有展开窗口循环、除数为常量的实现，按统计策略的枚举值排列
+    // 参数范围固定了这两个参数时整个优化都使用同一个实现，超出范围的参数使用运行时的实现
+    typedef WaltHmp W;
+    static const UpdateHistoryFn history_fns[RavgHistSizeMax][4] = {
+        {&W::UpdateHistory<1, 0>, &W::UpdateHistory<1, 1>, &W::UpdateHistory<1, 2>, &W::UpdateHistory<1, 3>},
+        {&W::UpdateHistory<2, 0>, &W::UpdateHistory<2, 1>, &W::UpdateHistory<2, 2>, &W::UpdateHistory<2, 3>},
+        {&W::UpdateHistory<3, 0>, &W::UpdateHistory<3, 1>, &W::UpdateHistory<3, 2>, &W::UpdateHistory<3, 3>},
+        {&W::UpdateHistory<4, 0>, &W::UpdateHistory<4, 1>, &W::UpdateHistory<4, 2>, &W::UpdateHistory<4, 3>},
+        {&W::UpdateHistory<5, 0>, &W::UpdateHistory<5, 1>, &W::UpdateHistory<5, 2>, &W::UpdateHistory<5, 3>},
+    };
+    const int hist_size = tunables_.sched_ravg_hist_size;
+    const int policy    = tunables_.sched_window_stats_policy;
+    if (hist_size >= 1 && hist_size <= RavgHistSizeMax && policy >= WINDOW_STATS_RECENT && policy <= WINDOW_STATS_AVG)
+        update_history_ = history_fns[hist_size - 1][policy];
+    else
+        update_history_ = &WaltHmp::UpdateHistory<0, 0>;
+}
+
+void WaltHmp::SaveState(State *s) const {
+    s->demand       = demand_;
+    s->max_load_sum = max_load_sum_;
+    memcpy(s->loads_sum, loads_sum_, sizeof(loads_sum_));
+    memcpy(s->sum_history, sum_history_, sizeof(sum_history_));
+    s->entry_cnt      = entry_cnt_;
+    s->governor_cnt   = governor_cnt_;
+    s->active_cluster = GetActiveCluster();
+}
+
+void WaltHmp::RestoreState(const State &s) {
+    demand_       = s.demand;
+    max_load_sum_ = s.max_load_sum;
+    memcpy(loads_sum_, s.loads_sum, sizeof(loads_sum_));
+    memcpy(sum_history_, s.sum_history, sizeof(sum_history_));
+    entry_cnt_    = s.entry_cnt;
+    governor_cnt_ = s.governor_cnt;
+    SetActiveCluster(s.active_cluster);
 }
 
-// 更新负载滑动窗口，返回预计的负载需求，@in_demand为freq*busy_pct*efficiency
 void WaltHmp::update_history(int in_demand) {
-    int *         hist    = sum_history_;
-    uint64_t      sum     = 0;
-    constexpr int samples = 1;
-    const int     runtime = in_demand;
-    int           max     = 0;
+    (this->*update_history_)(in_demand);
+}
+
+// 更新负载滑动窗口，返回预计的负载需求，@in_demand为freq*busy_pct*efficiency
+template <int kHistSize, int kPolicy>
+void WaltHmp::UpdateHistory(int in_demand) {
+    const int     hist_size = kHistSize ? kHistSize : tunables_.sched_ravg_hist_size;
+    const int     policy    = kHistSize ? kPolicy : tunables_.sched_window_stats_policy;
+    int *         hist      = sum_history_;
+    uint64_t      sum       = 0;
+    constexpr int samples   = 1;
+    const int     runtime   = in_demand;
+    int           max       = 0;
     int           ridx, widx;
     int           avg, demand;
 
     /* Push new 'runtime' value onto stack */
-    widx = tunables_.sched_ravg_hist_size - 1;
+    widx = hist_size - 1;
     ridx = widx - samples;
     for (; ridx >= 0; --widx, --ridx) {
         hist[widx] = hist[ridx];
@@ -50,20 +101,20 @@ void WaltHmp::update_history(int in_demand) {
             max = hist[widx];
     }
 
-    for (widx = 0; widx < samples && widx < tunables_.sched_ravg_hist_size; widx++) {
+    for (widx = 0; widx < samples && widx < hist_size; widx++) {
         hist[widx] = runtime;
         sum += hist[widx];
         if (hist[widx] > max)
             max = hist[widx];
     }
 
-    if (tunables_.sched_window_stats_policy == WINDOW_STATS_RECENT) {
+    if (policy == WINDOW_STATS_RECENT) {
         demand = runtime;
-    } else if (tunables_.sched_window_stats_policy == WINDOW_STATS_MAX) {
+    } else if (policy == WINDOW_STATS_MAX) {
         demand = max;
     } else {
-        avg = sum / tunables_.sched_ravg_hist_size;
-        if (tunables_.sched_window_stats_policy == WINDOW_STATS_AVG)
+        avg = sum / hist_size;
+        if (policy == WINDOW_STATS_AVG)
             demand = avg;
         else
             demand = std::max(avg, runtime);
@@ -73,9 +124,45 @@ void WaltHmp::update_history(int in_demand) {
     return;
 }
 
+// 历史窗口中的需求都不超过上迁阈值，之后的需求又不超过小核当前的容量，不会迁移到大核
+int WaltHmp::QuietDemand(void) const {
+    if (entry_cnt_ != 0 || tunables_.sched_boost)
+        return -1;
+    if ((uint64_t)little_->CalcCapacity() > up_demand_thd_)
+        return -1;
+    for (int i = 0; i < tunables_.sched_ravg_hist_size; ++i) {
+        if ((uint64_t)sum_history_[i] > up_demand_thd_)
+            return -1;
+    }
+    return GovernorQuietDemand(governor_cnt_);
+}
+
+// 只按整个timer_rate快进，只有最后sched_ravg_hist_size个窗口会留在历史中
+int WaltHmp::FastForward(const Workload &work, int begin, int n) {
+    const int n_period = n / tunables_.timer_rate;
+    if (n_period == 0)
+        return 0;
+
+    const int capacity     = active_->CalcCapacity();
+    int       max_load_avg = 0;
+    for (int p = std::max(0, n_period - tunables_.sched_ravg_hist_size); p < n_period; ++p) {
+        uint64_t sum = 0;
+        for (int i = 0; i < tunables_.timer_rate; ++i) {
+            const auto &s = work.windowed_load_[begin + p * tunables_.timer_rate + i];
+            sum += std::min(work.PctToDemand(s.max_load), capacity);
+        }
+        max_load_avg = timer_div_.Div(sum);
+        update_history(max_load_avg);
+    }
+
+    GovernorFastForward(&governor_cnt_, n_period, max_load_avg);
+    return n_period * tunables_.timer_rate;
+}
+
 // demand : freq * busy_pct * efficiency，walt输出
 // load: freq * busy_pct * efficiency
 // load 最大值 2500 * 2048 * 100，sum最大值 3000 * 2048 * 400，可能大于UINT32_MAX
+template <typename TopoT>
 int WaltHmp::SchedulerTick(int max_load, const int *loads, int n_load, int now) {
     ++entry_cnt_;
     max_load_sum_ += max_load;
@@ -84,7 +171,7 @@ int WaltHmp::SchedulerTick(int max_load, const int *loads, int n_load, int now)
     }
 
     if (entry_cnt_ == tunables_.timer_rate) {
-        int max_load_avg = max_load_sum_ / tunables_.timer_rate;
+        int max_load_avg = timer_div_.Div(max_load_sum_);
 
         entry_cnt_    = 0;
         max_load_sum_ = 0;
@@ -112,7 +199,7 @@ int WaltHmp::SchedulerTick(int max_load, const int *loads, int n_load, int now)
         active_->SetBusyPct(LoadToBusyPct(active_, max_load_avg));
 
         little_->SetCurfreq(governor_little_->InteractiveTimer(little_->GetBusyPct(), governor_cnt_));
-        if (cluster_num_ > 1)
+        if (HasBigCluster<TopoT>())
             big_->SetCurfreq(governor_big_->InteractiveTimer(big_->GetBusyPct(), governor_cnt_));
 
         ++governor_cnt_;
@@ -120,3 +207,8 @@ int WaltHmp::SchedulerTick(int max_load, const int *loads, int n_load, int now)
 
     return active_->CalcCapacity();
 }
+
+template int WaltHmp::SchedulerTick<TopologyGeneric>(int max_load, const int *loads, int n_load, int now);
+template int WaltHmp::SchedulerTick<Topology<4, 1>>(int max_load, const int *loads, int n_load, int now);
+template int WaltHmp::SchedulerTick<Topology<2, 2>>(int max_load, const int *loads, int n_load, int now);
+template int WaltHmp::SchedulerTick<Topology<4, 2>>(int max_load, const int *loads, int n_load, int now);
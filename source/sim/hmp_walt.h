@@ -3,6 +3,8 @@
 
 #include "hmp.h"
 
+#define RavgHistSizeMax 5
+
 class WaltHmp : public Hmp {
 public:
     enum { WINDOW_STATS_RECENT = 0, WINDOW_STATS_MAX, WINDOW_STATS_MAX_RECENT_AVG, WINDOW_STATS_AVG };
@@ -21,17 +23,36 @@ public:
         Tunables tunables;
     };
 
+    // 运行状态，参数和由参数得到的阈值不在其中
+    typedef struct _State {
+        uint64_t demand;
+        uint64_t max_load_sum;
+        uint64_t loads_sum[NLoadsMax];
+        int      sum_history[RavgHistSizeMax];
+        int      entry_cnt;
+        int      governor_cnt;
+        int      active_cluster;
+    } State;
+
     WaltHmp(){};
     WaltHmp(Cfg cfg);
+    template <typename TopoT>
     int SchedulerTick(int max_load, const int *loads, int n_load, int now);
+    int QuietDemand(void) const;
+    int FastForward(const Workload &work, int begin, int n);
 
     Tunables GetTunables(void) { return tunables_; }
     void     SetTunables(const Tunables &t);
+    void     SaveState(State *s) const;
+    void     RestoreState(const State &s);
 
 private:
-#define RavgHistSizeMax 5
 
     void update_history(int in_demand);
+    // @kHistSize和@kPolicy为编译期确定的窗口大小和统计策略，kHistSize为0时使用运行时的参数
+    template <int kHistSize, int kPolicy>
+    void UpdateHistory(int in_demand);
+    typedef void (WaltHmp::*UpdateHistoryFn)(int in_demand);
 
     Tunables tunables_;
     uint64_t demand_;
@@ -40,6 +61,9 @@ private:
     uint64_t max_load_sum_;
     uint64_t loads_sum_[NLoadsMax];
     int      governor_cnt_;
+
+    UpdateHistoryFn update_history_;  // 按窗口大小和统计策略选择的实现
+    Divider<48>     timer_div_;       // 除以timer_rate
 };
 
 #endif
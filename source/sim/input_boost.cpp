@@ -45,6 +45,21 @@ void InputBoost<GovernorT, SchedT>::Tick(bool has_input, bool has_render, int cu
     }
 };
 
+template <typename GovernorT, typename SchedT>
+void InputBoost<GovernorT, SchedT>::SaveState(State *s) const {
+    s->in_boost               = this->is_in_boost_;
+    s->input_happened_quantum = input_happened_quantum_;
+}
+
+// 没有启用输入升频时不会进入升频
+template <typename GovernorT, typename SchedT>
+void InputBoost<GovernorT, SchedT>::RestoreState(const State &s) {
+    this->is_in_boost_      = s.in_boost && tunables_.duration_quantum;
+    input_happened_quantum_ = s.input_happened_quantum;
+    if (this->is_in_boost_)
+        DoBoost();
+}
+
 template <>
 UperfBoost<Interactive, WaltHmp>::Tunables::Tunables(const Soc *soc) {
     int  cluster_num    = soc->clusters_.size();
@@ -198,6 +213,27 @@ void UperfBoost<Interactive, PeltHmp>::Backup() {
     original_.big        = big->GetTunables();
 }
 
+template <typename GovernorT, typename SchedT>
+void UperfBoost<GovernorT, SchedT>::SaveState(State *s) const {
+    s->in_boost               = this->is_in_boost_;
+    s->original_inited        = is_original_inited_;
+    s->render_stop_quantum    = render_stop_quantum_;
+    s->input_happened_quantum = input_happened_quantum_;
+}
+
+// 调度器此时还是没有升频的参数，与第一次升频时备份的相同
+template <typename GovernorT, typename SchedT>
+void UperfBoost<GovernorT, SchedT>::RestoreState(const State &s) {
+    this->is_in_boost_      = s.in_boost && tunables_.enabled;
+    is_original_inited_     = s.original_inited && tunables_.enabled;
+    render_stop_quantum_    = s.render_stop_quantum;
+    input_happened_quantum_ = s.input_happened_quantum;
+    if (is_original_inited_)
+        Backup();
+    if (this->is_in_boost_)
+        Apply(tunables_);
+}
+
 template class InputBoost<Interactive, WaltHmp>;
 template class InputBoost<Interactive, PeltHmp>;
 template class UperfBoost<Interactive, WaltHmp>;
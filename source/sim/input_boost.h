@@ -16,6 +16,7 @@ public:
     Boost() : env_(), is_in_boost_(false) {}
     Boost(const SysEnv &env) : env_(env), is_in_boost_(false) {}
     void Tick(bool has_input, bool has_render, int cur_quantum) {}
+    bool IsInBoost(void) const { return is_in_boost_; }
 
 protected:
     void DoBoost(void) {}
@@ -35,10 +36,18 @@ public:
         Tunables(const Soc *soc);
     };
 
+    typedef struct _State {
+        int in_boost;
+        int input_happened_quantum;
+    } State;
+
     InputBoost() : Boost<GovernorT, SchedT>(), tunables_(), input_happened_quantum_(0) {}
     InputBoost(const Tunables &tunables, const typename Boost<GovernorT, SchedT>::SysEnv &env)
         : Boost<GovernorT, SchedT>(env), tunables_(tunables), input_happened_quantum_(0) {}
     void Tick(bool has_input, bool has_render, int cur_quantum);
+    void SaveState(State *s) const;
+    // 升频期间的状态按本身的参数重新施加升频
+    void RestoreState(const State &s);
 
 private:
     void DoBoost(void);
@@ -63,6 +72,14 @@ public:
         Tunables(const Soc *soc);
     };
 
+    // 备份的原始参数不在其中，恢复时从调度器重新备份
+    typedef struct _State {
+        int in_boost;
+        int original_inited;
+        int render_stop_quantum;
+        int input_happened_quantum;
+    } State;
+
     UperfBoost()
         : Boost<GovernorT, SchedT>(),
           tunables_(),
@@ -78,6 +95,9 @@ public:
           render_stop_quantum_(0),
           input_happened_quantum_(0) {}
     void Tick(bool has_input, bool has_render, int cur_quantum);
+    void SaveState(State *s) const;
+    // 升频期间的状态按本身的参数重新施加升频
+    void RestoreState(const State &s);
 
 private:
     void DoBoost(void);
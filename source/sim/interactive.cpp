@@ -134,6 +134,16 @@ int Interactive::InteractiveTimer(int load, int now) {
     return target_freq;
 }
 
+// 负载不超过最低频点的目标负载时choose_freq仍选择最低频点，低于go_hispeed_load时不会拉到hispeed_freq
+// max_freq_hysteresis到期之后不会再生效，此时每次采样只更新时间戳
+int Interactive::QuietLoad(int now) const {
+    if (target_freq != cluster_->GetMinfreq() || cluster_->GetCurfreq() != target_freq || floor_freq != target_freq)
+        return -1;
+    if (target_freq >= cluster_->GetMaxfreq() || now - max_freq_hyst_start_time < tunables_.max_freq_hysteresis)
+        return -1;
+    return std::min(freq_to_targetload(target_freq), tunables_.go_hispeed_load - 1);
+}
+
 int Interactive::GetAboveHispeedDelayGearNum(void) const {
     auto get_freq = [=](int idx) { return cluster_->model_.opp_model[idx].freq; };
 
@@ -22,6 +22,15 @@ public:
         _InteractiveTunables() {}
     } Tunables;
 
+    // 运行状态，参数不在其中，可以恢复到使用不同参数的调速器上
+    typedef struct _State {
+        int target_freq;
+        int floor_freq;
+        int max_freq_hyst_start_time;
+        int hispeed_validate_time;
+        int floor_validate_time;
+    } State;
+
     Interactive() = delete;
     Interactive(Tunables tunables, Cluster *cm)
         : tunables_(tunables),
@@ -33,11 +42,20 @@ public:
           floor_validate_time(0) {}
 
     int InteractiveTimer(int load, int now);
+    // 处于最低频率并且会一直保持时，返回不会离开这个不动点的最大负载百分比，否则返回-1
+    int QuietLoad(int now) const;
+    // 跳过负载都不超过QuietLoad的若干次采样，@now为最后一次采样的时间
+    void FastForward(int now) {
+        hispeed_validate_time = now;
+        floor_validate_time   = now;
+    }
     int GetAboveHispeedDelayGearNum(void) const;
     int GetTargetLoadGearNum(void) const;
 
     Tunables GetTunables(void) { return tunables_; }
     void     SetTunables(const Tunables &t) { tunables_ = t; }
+    void     SaveState(State *s) const;
+    void     RestoreState(const State &s);
 
 private:
     int freq_to_targetload(int freq) const;
@@ -54,6 +72,22 @@ private:
     int floor_validate_time;
 };
 
+inline void Interactive::SaveState(State *s) const {
+    s->target_freq              = target_freq;
+    s->floor_freq               = floor_freq;
+    s->max_freq_hyst_start_time = max_freq_hyst_start_time;
+    s->hispeed_validate_time    = hispeed_validate_time;
+    s->floor_validate_time      = floor_validate_time;
+}
+
+inline void Interactive::RestoreState(const State &s) {
+    target_freq              = s.target_freq;
+    floor_freq               = s.floor_freq;
+    max_freq_hyst_start_time = s.max_freq_hyst_start_time;
+    hispeed_validate_time    = s.hispeed_validate_time;
+    floor_validate_time      = s.floor_validate_time;
+}
+
 inline int Interactive::freq_to_targetload(int freq) const {
     return tunables_.target_loads[std::min(TARGET_LOAD_MAX_LEN - 1, cluster_->FindFreqIdx(freq, -1, -1))];
 }
@@ -2,24 +2,40 @@
 
 #include <numeric>
 
-Rank::Score Rank::Eval(const Workload &workload, const Workload &idleload, const SimResultPack &rp, Soc soc,
+#include "divider.h"
+
+Rank::Scratch &Rank::GetScratch(void) {
+    static thread_local Scratch scratch;
+    return scratch;
+}
+
+Rank::Score Rank::Eval(const Workload &workload, const Workload &idleload, const SimResultPack &rp, const Soc &soc,
                        bool is_init) {
     if (is_init) {
-        default_score_.ref_power_comsumed = InitRefBattPartition(rp.onscreen.power);
+        init_ref_  = InitRefBattPartition(rp.onscreen.power);
+        ref_power_ = &init_ref_;
     }
 
-    double perf         = EvalPerformance(workload, soc, rp.onscreen.capacity);
-    double work_lasting = EvalBatterylife(rp.onscreen.power);
+    WeightBounds &window_bounds = GetScratch().window_bounds;
+    window_bounds.clear();
+    for (int i = 0; i < workload.GetSegmentNum(); ++i) {
+        const auto seg = workload.GetSegment(i);
+        window_bounds.push_back({seg.window_offset, seg.weight});
+    }
+
+    double perf         = EvalPerformance(workload, soc, rp.onscreen.capacity, window_bounds);
+    double work_lasting = EvalBatterylife(rp.onscreen.power, window_bounds);
     double idle_lasting = EvalIdleLasting(rp.offscreen_pwr);
 
     if (is_init) {
-        return {perf, work_lasting, idle_lasting, default_score_.ref_power_comsumed};
+        return {perf, work_lasting, idle_lasting, init_ref_};
     } else {
-        return {perf, work_lasting, idle_lasting, {0}};
+        return {perf, work_lasting, idle_lasting, {}};
     }
 }
 
-double Rank::EvalPerformance(const Workload &workload, const Soc &soc, const SimSeq &capacity_log) {
+double Rank::EvalPerformance(const Workload &workload, const Soc &soc, const SimSeq &capacity_log,
+                             const WeightBounds &window_bounds) {
     const int enough_capacity = soc.GetEnoughCapacity();
     const int max_capacity    = soc.GetMaxCapacity();
     const int margin_capacity = max_capacity - enough_capacity;
@@ -40,28 +56,44 @@ double Rank::EvalPerformance(const Workload &workload, const Soc &soc, const Sim
         return 0.0;
     };
 
-    LagSeq common_lag_seq;
+    const int n_seg   = workload.GetSegmentNum();
+    Scratch & scratch = GetScratch();
+
+    LagSeq &common_lag_seq = scratch.common_lag_seq;
+    common_lag_seq.clear();
     common_lag_seq.reserve(capacity_log.size());
 
     auto iter_log = capacity_log.begin();
-    for (const auto &loadslice : workload.windowed_load_) {
-        common_lag_seq.push_back(calc_lag(loadslice.max_load, *iter_log++));
+    for (int i = 0; i < n_seg; ++i) {
+        const auto seg = workload.GetSegment(i);
+        for (const auto &loadslice : seg.work->windowed_load_) {
+            common_lag_seq.push_back(calc_lag(seg.work->PctToDemand(loadslice.max_load), *iter_log++));
+        }
     }
 
-    LagSeq render_lag_seq;
-    render_lag_seq.reserve(workload.render_load_.size());
-
-    for (const auto &r : workload.render_load_) {
-        uint64_t aggreated_capacity = 0;
-        aggreated_capacity += capacity_log[r.window_idxs[0]] * r.window_quantums[0];
-        aggreated_capacity += capacity_log[r.window_idxs[1]] * r.window_quantums[1];
-        aggreated_capacity += capacity_log[r.window_idxs[2]] * r.window_quantums[2];
-        aggreated_capacity /= workload.frame_quantum_;
-        render_lag_seq.push_back(calc_lag(r.frame_load, aggreated_capacity));
+    LagSeq &      render_lag_seq = scratch.render_lag_seq;
+    WeightBounds &render_bounds  = scratch.render_bounds;
+    render_lag_seq.clear();
+    render_bounds.clear();
+
+    // 帧对应的时间片序号是相对于所在应用的，加上这一段的起始位置
+    for (int i = 0; i < n_seg; ++i) {
+        const auto seg = workload.GetSegment(i);
+        render_bounds.push_back({seg.render_offset, seg.weight});
+        const auto        log = capacity_log.begin() + seg.window_offset;
+        const Divider<48> frame_div(seg.work->frame_quantum_);
+        for (const auto &r : seg.work->render_load_) {
+            uint64_t aggreated_capacity = 0;
+            aggreated_capacity += log[r.window_idxs[0]] * r.window_quantums[0];
+            aggreated_capacity += log[r.window_idxs[1]] * r.window_quantums[1];
+            aggreated_capacity += log[r.window_idxs[2]] * r.window_quantums[2];
+            aggreated_capacity = frame_div.Div(aggreated_capacity);
+            render_lag_seq.push_back(calc_lag(r.frame_load, aggreated_capacity));
+        }
     }
 
-    double common_lag_ratio = PerfPartitionEval(common_lag_seq);
-    double render_lag_ratio = PerfPartitionEval(render_lag_seq);
+    double common_lag_ratio = PerfPartitionEval(common_lag_seq, window_bounds);
+    double render_lag_ratio = PerfPartitionEval(render_lag_seq, render_bounds);
 
     double score = misc_.render_fraction * render_lag_ratio + misc_.common_fraction * common_lag_ratio;
     // double score = render_lag_ratio;
@@ -69,7 +101,8 @@ double Rank::EvalPerformance(const Workload &workload, const Soc &soc, const Sim
     return (score / default_score_.performance);
 }
 
-double Rank::PerfPartitionEval(const LagSeq &lag_seq) const {
+// 分区的权重是其中每个元素所在段权重的平均，全部权重为1时与不加权相同
+double Rank::PerfPartitionEval(const LagSeq &lag_seq, const WeightBounds &bounds) const {
     const int partition_len = misc_.perf_partition_len;
     const int n_partition   = lag_seq.size() / partition_len;
 
@@ -81,19 +114,38 @@ double Rank::PerfPartitionEval(const LagSeq &lag_seq) const {
     const double &seq_l1_scale = misc_.seq_lag_l1_scale;
     const double &seq_l2_scale = misc_.seq_lag_l2_scale;
 
-    LagSeq period_lag_arr;
+    LagSeq &             period_lag_arr    = GetScratch().period_lag_arr;
+    std::vector<double> &period_weight_arr = GetScratch().period_weight_arr;
+    period_lag_arr.clear();
+    period_weight_arr.clear();
     period_lag_arr.reserve(n_partition);
-
-    int   cnt              = 1;
-    int   n_recent_lag     = 0;
-    float period_lag_score = 0.0;
+    period_weight_arr.reserve(n_partition);
+
+    int    cnt              = 1;
+    int    n_recent_lag     = 0;
+    float  period_lag_score = 0.0;
+    int    idx              = 0;
+    int    n_period         = 0;
+    double weight           = 1.0;
+    double period_weight    = 0.0;
+    auto   iter_bound       = bounds.begin();
     for (const auto &lag_scale : lag_seq) {
         bool is_lag = (lag_scale > 0);
         if (cnt == partition_len) {
             period_lag_arr.push_back(period_lag_score);
+            period_weight_arr.push_back(period_weight / n_period);
             period_lag_score = 0.0;
+            period_weight    = 0.0;
+            n_period         = 0;
             cnt              = 0;
         }
+        while (iter_bound != bounds.end() && iter_bound->first <= idx) {
+            weight = iter_bound->second;
+            ++iter_bound;
+        }
+        period_weight += weight;
+        ++n_period;
+        ++idx;
         if (!is_lag) {
             n_recent_lag = n_recent_lag >> 1;
         }
@@ -105,45 +157,69 @@ double Rank::PerfPartitionEval(const LagSeq &lag_seq) const {
         ++cnt;
     }
 
-    double sum = 0;
-    for (const auto &l : period_lag_arr) {
-        sum += l * l;
+    double sum        = 0;
+    double weight_sum = 0;
+    for (size_t i = 0; i < period_lag_arr.size(); ++i) {
+        const double l = period_lag_arr[i];
+        sum += period_weight_arr[i] * l * l;
+        weight_sum += period_weight_arr[i];
     }
 
-    return std::sqrt(sum / n_partition);
+    return std::sqrt(sum / weight_sum);
 }
 
-double Rank::EvalBatterylife(const SimSeq &power_log) const {
-    double partitional = BattPartitionEval(power_log);
+double Rank::EvalBatterylife(const SimSeq &power_log, const WeightBounds &bounds) const {
+    double partitional = BattPartitionEval(power_log, bounds);
     return (1.0 / (partitional * default_score_.battery_life));
 }
 
-double Rank::BattPartitionEval(const SimSeq &power_seq) const {
+double Rank::BattPartitionEval(const SimSeq &power_seq, const WeightBounds &bounds) const {
     const int partition_len = misc_.batt_partition_len;
     const int n_partition   = power_seq.size() / partition_len;
 
-    std::vector<uint64_t> period_power_arr;
+    std::vector<uint64_t> &period_power_arr  = GetScratch().period_power_arr;
+    std::vector<double> &  period_weight_arr = GetScratch().period_weight_arr;
+    period_power_arr.clear();
+    period_weight_arr.clear();
     period_power_arr.reserve(n_partition);
+    period_weight_arr.reserve(n_partition);
 
     int      cnt                   = 1;
     uint64_t period_power_comsumed = 0;
+    int      idx                   = 0;
+    int      n_period              = 0;
+    double   weight                = 1.0;
+    double   period_weight         = 0.0;
+    auto     iter_bound            = bounds.begin();
     for (const auto &power_comsumed : power_seq) {
         if (cnt == partition_len) {
             period_power_arr.push_back(period_power_comsumed);
+            period_weight_arr.push_back(period_weight / n_period);
             period_power_comsumed = 0;
+            period_weight         = 0.0;
+            n_period              = 0;
             cnt                   = 0;
         }
+        while (iter_bound != bounds.end() && iter_bound->first <= idx) {
+            weight = iter_bound->second;
+            ++iter_bound;
+        }
+        period_weight += weight;
+        ++n_period;
+        ++idx;
         period_power_comsumed += power_comsumed;
         ++cnt;
     }
 
-    double sum = 0;
+    double sum        = 0;
+    double weight_sum = 0;
     for (int i = 0; i < n_partition; ++i) {
-        double t = (double)period_power_arr[i] / default_score_.ref_power_comsumed[i];
-        sum += t * t;
+        double t = (double)period_power_arr[i] / (*ref_power_)[i];
+        sum += period_weight_arr[i] * t * t;
+        weight_sum += period_weight_arr[i];
     }
 
-    return std::sqrt(sum / n_partition);
+    return std::sqrt(sum / weight_sum);
 }
 
 std::vector<uint64_t> Rank::InitRefBattPartition(const SimSeq &power_seq) const {
@@ -36,12 +36,29 @@ public:
     } MiscConst;
 
     using LagSeq = std::vector<float>;
+    // 每一段负载在序列中的起始位置和权重，按起始位置升序
+    using WeightBounds = std::vector<std::pair<int, double>>;
 
     Rank() = delete;
-    Rank(const Score &default_score, const MiscConst &misc) : misc_(misc), default_score_(default_score){};
-    Score Eval(const Workload &workload, const Workload &idleload, const SimResultPack &rp, Soc soc, bool is_init);
+    // 只引用@default_score，评估期间需要保持有效
+    Rank(const Score &default_score, const MiscConst &misc)
+        : misc_(misc), default_score_(default_score), ref_power_(&default_score.ref_power_comsumed){};
+    Score Eval(const Workload &workload, const Workload &idleload, const SimResultPack &rp, const Soc &soc,
+               bool is_init);
 
 private:
+    // 每个线程复用的中间序列，评估时只清空不释放，长度稳定后不再有堆分配
+    struct Scratch {
+        LagSeq                common_lag_seq;
+        LagSeq                render_lag_seq;
+        WeightBounds          window_bounds;
+        WeightBounds          render_bounds;
+        LagSeq                period_lag_arr;
+        std::vector<double>   period_weight_arr;
+        std::vector<uint64_t> period_power_arr;
+    };
+    static Scratch &GetScratch(void);
+
     int QuantifyPower(int power) const { return (power >> POWER_SHIFT); }
 
     void AdaptLoad(int &load, int capacity) const { load = std::min(load, capacity); }
@@ -51,11 +68,12 @@ private:
         }
     }
 
-    double PerfPartitionEval(const LagSeq &lag_seq) const;
-    double BattPartitionEval(const SimSeq &power_seq) const;
+    double PerfPartitionEval(const LagSeq &lag_seq, const WeightBounds &bounds) const;
+    double BattPartitionEval(const SimSeq &power_seq, const WeightBounds &bounds) const;
 
-    double EvalPerformance(const Workload &workload, const Soc &soc, const SimSeq &capacity_log);
-    double EvalBatterylife(const SimSeq &power_log) const;
+    double EvalPerformance(const Workload &workload, const Soc &soc, const SimSeq &capacity_log,
+                           const WeightBounds &window_bounds);
+    double EvalBatterylife(const SimSeq &power_log, const WeightBounds &bounds) const;
 
     std::vector<uint64_t> InitRefBattPartition(const SimSeq &power_seq) const;
 
@@ -63,8 +81,10 @@ private:
         return (1.0 / (idle_power_comsumed * default_score_.idle_lasting));
     }
 
-    MiscConst misc_;
-    Score     default_score_;
+    MiscConst                    misc_;
+    const Score &                default_score_;
+    const std::vector<uint64_t> *ref_power_;  // 初始化时指向init_ref_
+    std::vector<uint64_t>        init_ref_;
 };
 
 #endif
@@ -0,0 +1,244 @@
+#include "rank_batch.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "divider.h"
+
+RankBatch::RankBatch(const Workload &workload, const Soc &soc, const std::vector<const SimResultPack *> &rps)
+    : n_cand_(rps.size()),
+      n_window_(rps[0]->onscreen.capacity.size()),
+      n_render_(0),
+      enough_capacity_(soc.GetEnoughCapacity()),
+      max_capacity_(soc.GetMaxCapacity()),
+      lag_valid_(false),
+      lag_penalty_(0.0) {
+    const int n     = n_cand_;
+    const int n_seg = workload.GetSegmentNum();
+
+    for (int i = 0; i < n_seg; ++i) {
+        const auto seg = workload.GetSegment(i);
+        window_bounds_.push_back({seg.window_offset, seg.weight});
+        render_bounds_.push_back({seg.render_offset, seg.weight});
+        for (const auto &loadslice : seg.work->windowed_load_)
+            window_demand_.push_back(seg.work->PctToDemand(loadslice.max_load));
+        for (const auto &r : seg.work->render_load_)
+            render_demand_.push_back(r.frame_load);
+    }
+    n_render_ = render_demand_.size();
+
+    // 转置为按时间片存放，一行是所有候选在这个时间片的值
+    window_capacity_.resize((size_t)n_window_ * n);
+    power_.resize((size_t)n_window_ * n);
+    for (int k = 0; k < n; ++k) {
+        const auto &rp = *rps[k];
+        for (int i = 0; i < n_window_; ++i) {
+            window_capacity_[(size_t)i * n + k] = rp.onscreen.capacity[i];
+            power_[(size_t)i * n + k]           = rp.onscreen.power[i];
+        }
+        offscreen_pwr_.push_back(rp.offscreen_pwr);
+    }
+
+    // 帧的容量与评分设置无关，只计算一次，算法与Rank::EvalPerformance相同
+    render_capacity_.resize((size_t)n_render_ * n);
+    for (int k = 0; k < n; ++k) {
+        const SimSeq &capacity_log = rps[k]->onscreen.capacity;
+        int           frame_idx    = 0;
+        for (int i = 0; i < n_seg; ++i) {
+            const auto        seg = workload.GetSegment(i);
+            const auto        log = capacity_log.begin() + seg.window_offset;
+            const Divider<48> frame_div(seg.work->frame_quantum_);
+            for (const auto &r : seg.work->render_load_) {
+                uint64_t aggreated_capacity = 0;
+                aggreated_capacity += log[r.window_idxs[0]] * r.window_quantums[0];
+                aggreated_capacity += log[r.window_idxs[1]] * r.window_quantums[1];
+                aggreated_capacity += log[r.window_idxs[2]] * r.window_quantums[2];
+                aggreated_capacity = frame_div.Div(aggreated_capacity);
+                render_capacity_[(size_t)frame_idx++ * n + k] = aggreated_capacity;
+            }
+        }
+    }
+}
+
+// 与Rank::EvalPerformance中的calc_lag相同
+static inline double CalcLag(int required, int provided, int enough_capacity, int max_capacity, double penalty) {
+    if (provided >= max_capacity)
+        return 0.0;
+    if (provided < required)
+        return (provided >= enough_capacity) ? penalty * (max_capacity - provided) / (max_capacity - enough_capacity)
+                                             : 1.0;
+    return 0.0;
+}
+
+void RankBatch::CalcLag(double enough_penalty) {
+    const int n = n_cand_;
+    common_lag_.resize((size_t)n_window_ * n);
+    render_lag_.resize((size_t)n_render_ * n);
+
+    for (int i = 0; i < n_window_; ++i) {
+        const int       required = window_demand_[i];
+        const uint32_t *provided = &window_capacity_[(size_t)i * n];
+        float *         lag      = &common_lag_[(size_t)i * n];
+        for (int k = 0; k < n; ++k)
+            lag[k] = ::CalcLag(required, provided[k], enough_capacity_, max_capacity_, enough_penalty);
+    }
+    for (int i = 0; i < n_render_; ++i) {
+        const int  required = render_demand_[i];
+        const int *provided = &render_capacity_[(size_t)i * n];
+        float *    lag      = &render_lag_[(size_t)i * n];
+        for (int k = 0; k < n; ++k)
+            lag[k] = ::CalcLag(required, provided[k], enough_capacity_, max_capacity_, enough_penalty);
+    }
+
+    lag_valid_   = true;
+    lag_penalty_ = enough_penalty;
+}
+
+// 分区和连续卡顿的计算与Rank::PerfPartitionEval相同，每个候选有自己的连续卡顿计数和分区累计
+void RankBatch::PerfPartitionEval(const std::vector<float> &lag, int n_row, const WeightBounds &bounds,
+                                  const Rank::MiscConst &misc, std::vector<double> *ratio) const {
+    const int n             = n_cand_;
+    const int partition_len = misc.perf_partition_len;
+
+    const int    seq_lag_l1   = misc.seq_lag_l1;
+    const int    seq_lag_l2   = misc.seq_lag_l2;
+    const int    seq_lag_max  = misc.seq_lag_max;
+    const double seq_l0_scale = misc.seq_lag_l0_scale;
+    const double seq_l1_scale = misc.seq_lag_l1_scale;
+    const double seq_l2_scale = misc.seq_lag_l2_scale;
+
+    std::vector<int>    n_recent_lag(n, 0);
+    std::vector<float>  period_lag_score(n, 0.0);
+    std::vector<float>  period_lag_arr;  // [分区 * n + 候选]
+    std::vector<double> period_weight_arr;
+
+    int    cnt           = 1;
+    int    idx           = 0;
+    int    n_period      = 0;
+    double weight        = 1.0;
+    double period_weight = 0.0;
+    auto   iter_bound    = bounds.begin();
+    for (int i = 0; i < n_row; ++i) {
+        if (cnt == partition_len) {
+            period_lag_arr.insert(period_lag_arr.end(), period_lag_score.begin(), period_lag_score.end());
+            period_weight_arr.push_back(period_weight / n_period);
+            std::fill(period_lag_score.begin(), period_lag_score.end(), 0.0);
+            period_weight = 0.0;
+            n_period      = 0;
+            cnt           = 0;
+        }
+        while (iter_bound != bounds.end() && iter_bound->first <= idx) {
+            weight = iter_bound->second;
+            ++iter_bound;
+        }
+        period_weight += weight;
+        ++n_period;
+        ++idx;
+
+        const float *row    = &lag[(size_t)i * n];
+        int *        recent = n_recent_lag.data();
+        float *      score  = period_lag_score.data();
+        for (int k = 0; k < n; ++k) {
+            const float lag_scale = row[k];
+            const bool  is_lag    = (lag_scale > 0);
+            int         r         = is_lag ? recent[k] : (recent[k] >> 1);
+            r                     = std::min(seq_lag_max, r + is_lag);
+            recent[k]             = r;
+            score[k] += seq_l0_scale * lag_scale * (r > 0);
+            score[k] += seq_l1_scale * lag_scale * (r >= seq_lag_l1);
+            score[k] += seq_l2_scale * lag_scale * (r >= seq_lag_l2);
+        }
+        ++cnt;
+    }
+
+    const int n_partition = period_weight_arr.size();
+    ratio->assign(n, 0.0);
+    for (int k = 0; k < n; ++k) {
+        double sum        = 0;
+        double weight_sum = 0;
+        for (int p = 0; p < n_partition; ++p) {
+            const double l = period_lag_arr[(size_t)p * n + k];
+            sum += period_weight_arr[p] * l * l;
+            weight_sum += period_weight_arr[p];
+        }
+        (*ratio)[k] = std::sqrt(sum / weight_sum);
+    }
+}
+
+// 与Rank::BattPartitionEval相同，参考的分区耗电就是默认参数自己的分区耗电
+void RankBatch::BattPartitionEval(const WeightBounds &bounds, int partition_len,
+                                  std::vector<double> *partitional) const {
+    const int n           = n_cand_;
+    const int n_partition = n_window_ / partition_len;
+
+    std::vector<uint64_t> period_power(n, 0);
+    std::vector<uint64_t> period_power_arr;  // [分区 * n + 候选]
+    std::vector<double>   period_weight_arr;
+
+    int    cnt           = 1;
+    int    idx           = 0;
+    int    n_period      = 0;
+    double weight        = 1.0;
+    double period_weight = 0.0;
+    auto   iter_bound    = bounds.begin();
+    for (int i = 0; i < n_window_; ++i) {
+        if (cnt == partition_len) {
+            period_power_arr.insert(period_power_arr.end(), period_power.begin(), period_power.end());
+            period_weight_arr.push_back(period_weight / n_period);
+            std::fill(period_power.begin(), period_power.end(), 0);
+            period_weight = 0.0;
+            n_period      = 0;
+            cnt           = 0;
+        }
+        while (iter_bound != bounds.end() && iter_bound->first <= idx) {
+            weight = iter_bound->second;
+            ++iter_bound;
+        }
+        period_weight += weight;
+        ++n_period;
+        ++idx;
+
+        const uint32_t *row = &power_[(size_t)i * n];
+        uint64_t *      sum = period_power.data();
+        for (int k = 0; k < n; ++k)
+            sum[k] += row[k];
+        ++cnt;
+    }
+
+    partitional->assign(n, 0.0);
+    for (int k = 0; k < n; ++k) {
+        double sum        = 0;
+        double weight_sum = 0;
+        for (int p = 0; p < n_partition; ++p) {
+            double t = (double)period_power_arr[(size_t)p * n + k] / period_power_arr[(size_t)p * n];
+            sum += period_weight_arr[p] * t * t;
+            weight_sum += period_weight_arr[p];
+        }
+        (*partitional)[k] = std::sqrt(sum / weight_sum);
+    }
+}
+
+std::vector<Rank::Score> RankBatch::Eval(const Rank::MiscConst &misc) {
+    if (!lag_valid_ || lag_penalty_ != misc.enough_penalty)
+        CalcLag(misc.enough_penalty);
+
+    std::vector<double> common_ratio;
+    std::vector<double> render_ratio;
+    std::vector<double> batt_partitional;
+    PerfPartitionEval(common_lag_, n_window_, window_bounds_, misc, &common_ratio);
+    PerfPartitionEval(render_lag_, n_render_, render_bounds_, misc, &render_ratio);
+    BattPartitionEval(window_bounds_, misc.batt_partition_len, &batt_partitional);
+
+    // 默认参数以{1, 1, 1}为参考评分，其余候选以默认参数的评分为参考，与OpengaAdapter::InitDefaultScore一致
+    std::vector<Rank::Score> scores(n_cand_);
+    Rank::Score              ref = {1.0, 1.0, 1.0, {}};
+    for (int k = 0; k < n_cand_; ++k) {
+        double perf            = misc.render_fraction * render_ratio[k] + misc.common_fraction * common_ratio[k];
+        scores[k].performance  = perf / ref.performance;
+        scores[k].battery_life = 1.0 / (batt_partitional[k] * ref.battery_life);
+        scores[k].idle_lasting = 1.0 / (offscreen_pwr_[k] * ref.idle_lasting);
+        if (k == 0)
+            ref = scores[0];
+    }
+    return scores;
+}
@@ -0,0 +1,54 @@
+#ifndef __RANK_BATCH_H
+#define __RANK_BATCH_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "cpumodel.h"
+#include "rank.h"
+#include "sim_types.h"
+#include "workload.h"
+
+// 多个候选的仿真结果在不同的评分设置下重新评分，与逐个使用Rank::Eval的结果一致
+// 序列按时间片为行、候选为列存放，内层循环遍历候选，每个时间片的需求只读取一次，便于编译器向量化
+class RankBatch {
+public:
+    RankBatch() = delete;
+    // @rps[0]为默认参数的仿真结果，其余候选的评分相对于它，与优化时的归一化相同
+    RankBatch(const Workload &workload, const Soc &soc, const std::vector<const SimResultPack *> &rps);
+    // 每个候选的评分，第0个为默认参数自身
+    std::vector<Rank::Score> Eval(const Rank::MiscConst &misc);
+
+private:
+    using WeightBounds = Rank::WeightBounds;
+
+    void CalcLag(double enough_penalty);
+    // 每个候选的分区卡顿均方根，@lag有@n_row行
+    void PerfPartitionEval(const std::vector<float> &lag, int n_row, const WeightBounds &bounds,
+                           const Rank::MiscConst &misc, std::vector<double> *ratio) const;
+    // 每个候选的分区耗电相对于默认参数的均方根
+    void BattPartitionEval(const WeightBounds &bounds, int partition_len, std::vector<double> *partitional) const;
+
+    int                   n_cand_;
+    int                   n_window_;
+    int                   n_render_;
+    int                   enough_capacity_;
+    int                   max_capacity_;
+    std::vector<int>      window_demand_;    // 每个时间片的需求
+    std::vector<int>      render_demand_;    // 每帧的需求
+    std::vector<uint32_t> window_capacity_;  // [时间片 * n_cand_ + 候选]
+    std::vector<int>      render_capacity_;  // [帧 * n_cand_ + 候选]，帧对应的几个时间片的平均容量
+    std::vector<uint32_t> power_;            // [时间片 * n_cand_ + 候选]
+    std::vector<uint64_t> offscreen_pwr_;
+    WeightBounds          window_bounds_;
+    WeightBounds          render_bounds_;
+
+    // 卡顿序列只取决于enough_penalty，网格中该项不变时复用
+    bool               lag_valid_;
+    double             lag_penalty_;
+    std::vector<float> common_lag_;
+    std::vector<float> render_lag_;
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "recorder.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#include "varint.h"
+
+const uint32_t kTraceMagic   = 0x43525457;  // "WTRC"
+const uint32_t kTraceVersion = 1;
+const size_t   kTraceInitCap = 1 << 20;
+const size_t   kRecordMaxLen = TRACE_FIELD_NUM * 10;
+
+// 记录的字段顺序，编码和解码共用
+static int *TraceFields(TraceQuantum *q, int idx) {
+    int *fields[TRACE_FIELD_NUM] = {&q->quantum,        &q->n_quantum, &q->offscreen, &q->little_opp, &q->big_opp,
+                                    &q->active_cluster, &q->in_boost,  &q->capacity,  &q->demand,     &q->power};
+    return fields[idx];
+}
+
+TraceWriter::TraceWriter(const std::string &trace_file, const Soc &soc)
+    : fd_(-1), base_(nullptr), cap_(0), len_(0), n_record_(0) {
+    memset(&last_, 0, sizeof(last_));
+    fd_ = open(trace_file.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        using namespace std;
+        cout << "Trace file access ERROR: " << trace_file << endl;
+        throw runtime_error("file access error");
+    }
+    Reserve(kTraceInitCap);
+
+    // 文件头，导出时根据频点表把序号转换为频率
+    std::vector<uint32_t> header = {kTraceMagic, kTraceVersion, (uint32_t)soc.clusters_.size()};
+    for (const auto &c : soc.clusters_) {
+        header.push_back(c.model_.opp_model.size());
+        for (const auto &opp : c.model_.opp_model)
+            header.push_back(opp.freq);
+    }
+    memcpy(base_, header.data(), header.size() * sizeof(uint32_t));
+    len_ = header.size() * sizeof(uint32_t);
+}
+
+TraceWriter::~TraceWriter() {
+    munmap(base_, cap_);
+    if (ftruncate(fd_, len_) != 0)
+        std::cout << "Trace file truncate failed" << std::endl;
+    close(fd_);
+}
+
+void TraceWriter::Reserve(size_t len) {
+    if (len <= cap_)
+        return;
+    size_t cap = std::max(cap_ * 2, len);
+    if (base_)
+        munmap(base_, cap_);
+    if (ftruncate(fd_, cap) != 0) {
+        using namespace std;
+        cout << "Trace file resize ERROR" << endl;
+        throw runtime_error("file access error");
+    }
+    void *addr = mmap(nullptr, cap, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED) {
+        using namespace std;
+        cout << "Trace file mmap ERROR" << endl;
+        throw runtime_error("file access error");
+    }
+    base_ = static_cast<char *>(addr);
+    cap_  = cap;
+}
+
+void TraceWriter::Append(const TraceQuantum &q) {
+    Reserve(len_ + kRecordMaxLen);
+    TraceQuantum cur = q;
+    for (int i = 0; i < TRACE_FIELD_NUM; ++i) {
+        const int64_t delta = (int64_t)*TraceFields(&cur, i) - *TraceFields(&last_, i);
+        len_ += PutVarint(base_ + len_, delta);
+    }
+    last_ = q;
+    ++n_record_;
+}
+
+TraceReader::TraceReader(const std::string &trace_file) : pos_(0) {
+    memset(&last_, 0, sizeof(last_));
+    std::ifstream ifs(trace_file, std::ios::binary);
+    if (!ifs.good()) {
+        using namespace std;
+        cout << "Trace file access ERROR: " << trace_file << endl;
+        throw runtime_error("file access error");
+    }
+    data_.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+
+    auto read_u32 = [&](uint32_t *v) {
+        if (pos_ + sizeof(uint32_t) > data_.size())
+            throw std::runtime_error("trace file truncated");
+        memcpy(v, data_.data() + pos_, sizeof(uint32_t));
+        pos_ += sizeof(uint32_t);
+    };
+
+    uint32_t magic, version, n_cluster;
+    read_u32(&magic);
+    read_u32(&version);
+    if (magic != kTraceMagic || version != kTraceVersion) {
+        using namespace std;
+        cout << "Trace file format ERROR: " << trace_file << endl;
+        throw runtime_error("trace format error");
+    }
+    read_u32(&n_cluster);
+    freqs_.resize(n_cluster);
+    for (auto &f : freqs_) {
+        uint32_t n_opp, freq;
+        read_u32(&n_opp);
+        for (uint32_t i = 0; i < n_opp; ++i) {
+            read_u32(&freq);
+            f.push_back(freq);
+        }
+    }
+}
+
+bool TraceReader::Next(TraceQuantum *q) {
+    if (pos_ >= data_.size())
+        return false;
+    for (int i = 0; i < TRACE_FIELD_NUM; ++i) {
+        int64_t delta;
+        if (!GetVarint(data_, &pos_, &delta))
+            throw std::runtime_error("trace file truncated");
+        *TraceFields(&last_, i) += delta;
+    }
+    *q = last_;
+    return true;
+}
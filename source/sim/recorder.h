@@ -0,0 +1,88 @@
+#ifndef __RECORDER_H
+#define __RECORDER_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "cpumodel.h"
+
+// 一个时间片的仿真状态，灭屏快进时一条记录代表连续的n_quantum个时间片
+typedef struct _TraceQuantum {
+    int quantum;
+    int n_quantum;
+    int offscreen;
+    int little_opp;  // 频点序号
+    int big_opp;
+    int active_cluster;  // 0为小核，1为大核
+    int in_boost;
+    int capacity;
+    int demand;  // 限幅前的最大负载需求，大于capacity时卡顿
+    int power;
+} TraceQuantum;
+
+#define TRACE_FIELD_NUM 10
+
+// 仿真的记录策略，kEnabled为编译期常量，为false时仿真循环中收集状态的代码整个不生成
+// 不记录，优化时使用
+struct NullRecorder {
+    static const bool kEnabled = false;
+    void              Record(const TraceQuantum &q) const {}
+};
+
+// 二进制记录文件的写入，文件头是各个集群的频点表，之后每条记录的每个字段与上一条的差值做zigzag变长编码
+// 文件使用内存映射，空间不够时加倍
+class TraceWriter {
+public:
+    TraceWriter() = delete;
+    TraceWriter(const std::string &trace_file, const Soc &soc);
+    ~TraceWriter();
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    void Append(const TraceQuantum &q);
+    int  GetRecordNum(void) const { return n_record_; }
+
+private:
+    void Reserve(size_t len);
+
+    int          fd_;
+    char *       base_;
+    size_t       cap_;
+    size_t       len_;
+    int          n_record_;
+    TraceQuantum last_;
+};
+
+// 写入二进制记录文件，只持有TraceWriter的指针，可以随Sim一起复制
+class TraceRecorder {
+public:
+    static const bool kEnabled = true;
+
+    TraceRecorder() : writer_(nullptr) {}
+    explicit TraceRecorder(TraceWriter *writer) : writer_(writer) {}
+    void Record(const TraceQuantum &q) const { writer_->Append(q); }
+
+private:
+    TraceWriter *writer_;
+};
+
+// 读取二进制记录文件，@freqs为每个集群的频点表
+class TraceReader {
+public:
+    TraceReader() = delete;
+    TraceReader(const std::string &trace_file);
+
+    const std::vector<std::vector<int>> &GetFreqs(void) const { return freqs_; }
+    // 依次读出每条记录，读完时返回false
+    bool Next(TraceQuantum *q);
+
+private:
+    std::vector<char>             data_;
+    size_t                        pos_;
+    std::vector<std::vector<int>> freqs_;
+    TraceQuantum                  last_;
+};
+
+#endif
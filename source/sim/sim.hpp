@@ -2,12 +2,18 @@
 #define __SIM_H
 
 #include <stdint.h>
+#include <string.h>
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <vector>
 
 #include "cpumodel.h"
+#include "hash.h"
+#include "recorder.h"
 #include "sim_types.h"
 #include "workload.h"
 
@@ -16,96 +22,339 @@ struct GovernorTs {
     typename GovernorT::Tunables t[2];
 };
 
-// 仿真运行
+// 仿真参数，不随记录策略变化，带记录的仿真可以直接使用优化得到的参数
 template <typename GovernorT, typename SchedT, typename BoostT>
+struct SimTunables {
+    GovernorTs<GovernorT>     governor;
+    typename SchedT::Tunables sched;
+    typename BoostT::Tunables boost;
+    bool                      has_boost;
+};
+
+// 一次仿真的运行状态，可以按字节复制、比较和哈希，用于在场景的段边界保存和继续仿真
+// 参数不在其中，同一个状态可以在不同参数的仿真上继续，升频期间的频率限制和调度阈值由继续仿真的参数重新施加
+// 只由Sim保存，保存前整个结构清零，填充字节不影响比较和哈希
+template <typename GovernorT, typename SchedT, typename BoostT>
+struct SimState {
+    Cluster::State            little;
+    Cluster::State            big;
+    typename GovernorT::State little_governor;
+    typename GovernorT::State big_governor;
+    typename SchedT::State    sched;
+    typename BoostT::State    boost;
+    int                       capacity;
+    int                       quantum_cnt;
+
+    bool     operator==(const SimState &o) const { return memcmp(this, &o, sizeof(SimState)) == 0; }
+    bool     operator!=(const SimState &o) const { return !(*this == o); }
+    uint64_t Hash(void) const { return HashBytes(this, sizeof(SimState)); }
+};
+
+typedef struct _SimMiscConst {
+    int working_base_mw;
+    int idle_base_mw;
+} SimMiscConst;
+
+// 仿真运行，@RecorderT为每个时间片状态的记录策略，默认的NullRecorder不产生任何代码
+template <typename GovernorT, typename SchedT, typename BoostT, typename RecorderT = NullRecorder>
 class Sim {
 public:
 #define POWER_SHIFT 4
 
-    typedef struct _Tunables {
-        GovernorTs<GovernorT>     governor;
-        typename SchedT::Tunables sched;
-        typename BoostT::Tunables boost;
-        bool                      has_boost;
-    } Tunables;
-
-    typedef struct _MiscConst {
-        int working_base_mw;
-        int idle_base_mw;
-    } MiscConst;
+    using Tunables  = SimTunables<GovernorT, SchedT, BoostT>;
+    using MiscConst = SimMiscConst;
+    using Governor  = GovernorT;
+    using Sched     = SchedT;
+    using Boost     = BoostT;
+    using State     = SimState<GovernorT, SchedT, BoostT>;
 
-    using Governor = GovernorT;
-    using Sched    = SchedT;
-    using Boost    = BoostT;
+    static_assert(std::is_trivially_copyable<State>::value, "SimState must be trivially copyable");
 
     Sim() = delete;
-    Sim(const Tunables &tunables, const MiscConst &misc) : tunables_(tunables), misc_(misc){};
+    Sim(const Tunables &tunables, const MiscConst &misc, const RecorderT &recorder = RecorderT())
+        : tunables_(tunables), misc_(misc), recorder_(recorder){};
 
     // 仿真运行，得到亮屏考察每一时间片的性能输出和功耗，以及灭屏的总耗电
-    void Run(const Workload &workload, const Workload &idleload, Soc soc, SimResultPack *rp) {
-        // 常量计算
-        const int cl_little_idx = soc.GetLittleClusterIdx();
-        const int cl_big_idx    = soc.GetBigClusterIdx();
-        const int base_pwr      = misc_.working_base_mw * 100;
-        const int idle_base_pwr = misc_.idle_base_mw * 100;
+    void Run(const Workload &workload, const Workload &idleload, const Soc &soc, SimResultPack *rp) const {
+        Resume(workload, 0, workload.GetSegmentNum(), &idleload, soc, nullptr, nullptr, rp);
+    }
+
+    // 从@from继续仿真亮屏场景的第[@seg_begin, @seg_end)段，@idleload不为空时接着仿真灭屏，结束时的状态写入@to
+    // @from为空时从初始状态开始，@to为空时不保存，亮屏结果追加到@rp，分几次继续与一次Run的结果相同
+    void Resume(const Workload &workload, int seg_begin, int seg_end, const Workload *idleload, const Soc &soc,
+                const State *from, State *to, SimResultPack *rp) const {
+        // 拓扑在读取SOC模型时已经确定，每次仿真只选择一次展开的实现
+        switch (soc.GetTopology()) {
+            case Soc::kTopo4:
+                RunTopo<Topology<4, 1>>(workload, seg_begin, seg_end, idleload, soc, from, to, rp);
+                break;
+            case Soc::kTopo2Plus2:
+                RunTopo<Topology<2, 2>>(workload, seg_begin, seg_end, idleload, soc, from, to, rp);
+                break;
+            case Soc::kTopo4Plus4:
+                RunTopo<Topology<4, 2>>(workload, seg_begin, seg_end, idleload, soc, from, to, rp);
+                break;
+            default:
+                RunTopo<TopologyGeneric>(workload, seg_begin, seg_end, idleload, soc, from, to, rp);
+                break;
+        }
+    }
+
+    // 多组参数一起仿真，结果与逐个Run一致
+    // 亮屏负载按@tile_len个时间片分块，每一块依次推进所有参数的仿真状态后再读取下一块，
+    // 负载数据每@sims.size()次仿真只从内存读取一次
+    static void RunBatch(const std::vector<Sim> &sims, const Workload &workload, const Workload &idleload,
+                         const Soc &soc, const std::vector<SimResultPack *> &rps, int tile_len) {
+        switch (soc.GetTopology()) {
+            case Soc::kTopo4:
+                RunBatchTopo<Topology<4, 1>>(sims, workload, idleload, soc, rps, tile_len);
+                break;
+            case Soc::kTopo2Plus2:
+                RunBatchTopo<Topology<2, 2>>(sims, workload, idleload, soc, rps, tile_len);
+                break;
+            case Soc::kTopo4Plus4:
+                RunBatchTopo<Topology<4, 2>>(sims, workload, idleload, soc, rps, tile_len);
+                break;
+            default:
+                RunBatchTopo<TopologyGeneric>(sims, workload, idleload, soc, rps, tile_len);
+                break;
+        }
+    }
+
+private:
+    // 一次仿真的调速器、调度器和输入升频实例，它们之间互相持有指针，构造后不能移动
+    // @s为本线程复用的SOC副本，已经恢复到初始状态
+    struct Stack {
+        Stack(const Tunables &t, Soc &s)
+            : soc(s),
+              little_governor(t.governor.t[soc.GetLittleClusterIdx()], &soc.clusters_[soc.GetLittleClusterIdx()]),
+              big_governor(t.governor.t[soc.GetBigClusterIdx()], &soc.clusters_[soc.GetBigClusterIdx()]),
+              sched(SchedCfg(t, &soc, &little_governor, &big_governor)),
+              capacity(soc.clusters_[0].CalcCapacity()),
+              quantum_cnt(0) {
+            // 使用参数实例化输入升频
+            if (t.has_boost) {
+                typename BoostT::SysEnv boost_env;
+                boost_env.soc    = &soc;
+                boost_env.little = &little_governor;
+                boost_env.big    = &big_governor;
+                boost_env.sched  = &sched;
+                boost            = BoostT(t.boost, boost_env);
+            }
+        }
+        Stack(const Stack &) = delete;
+        Stack &operator=(const Stack &) = delete;
+
+        void Save(State *s) const {
+            memset(s, 0, sizeof(State));
+            soc.clusters_[soc.GetLittleClusterIdx()].SaveState(&s->little);
+            soc.clusters_[soc.GetBigClusterIdx()].SaveState(&s->big);
+            little_governor.SaveState(&s->little_governor);
+            big_governor.SaveState(&s->big_governor);
+            sched.SaveState(&s->sched);
+            boost.SaveState(&s->boost);
+            s->capacity    = capacity;
+            s->quantum_cnt = quantum_cnt;
+        }
+
+        // 频率限制先恢复为模型的范围，升频期间的限制由输入升频重新施加
+        void Restore(const State &s) {
+            Cluster *cls[] = {&soc.clusters_[soc.GetLittleClusterIdx()], &soc.clusters_[soc.GetBigClusterIdx()]};
+            cls[0]->RestoreState(s.little);
+            cls[1]->RestoreState(s.big);
+            for (Cluster *c : cls) {
+                c->SetMinfreq(c->model_.min_freq);
+                c->SetMaxfreq(c->model_.max_freq);
+            }
+            little_governor.RestoreState(s.little_governor);
+            big_governor.RestoreState(s.big_governor);
+            sched.RestoreState(s.sched);
+            boost.RestoreState(s.boost);
+            capacity    = s.capacity;
+            quantum_cnt = s.quantum_cnt;
+        }
 
-        // 使用参数实例化CPU调速器仿真
-        auto little_governor = GovernorT(tunables_.governor.t[cl_little_idx], &soc.clusters_[cl_little_idx]);
-        auto big_governor    = GovernorT(tunables_.governor.t[cl_big_idx], &soc.clusters_[cl_big_idx]);
+        Soc &     soc;
+        GovernorT little_governor;
+        GovernorT big_governor;
+        SchedT    sched;
+        BoostT    boost;
+        int       capacity;
+        int       quantum_cnt;
+    };
 
-        // 使用参数实例化调度器仿真
+    // 使用参数实例化调度器仿真
+    static typename SchedT::Cfg SchedCfg(const Tunables &t, Soc *soc, GovernorT *little, GovernorT *big) {
         typename SchedT::Cfg sched_cfg;
-        sched_cfg.tunables        = tunables_.sched;
-        sched_cfg.little          = &soc.clusters_[cl_little_idx];
-        sched_cfg.big             = &soc.clusters_[cl_big_idx];
-        sched_cfg.governor_little = &little_governor;
-        sched_cfg.governor_big    = &big_governor;
-        SchedT sched(sched_cfg);
-
-        // 使用参数实例化输入升频
-        BoostT boost;
-        if (tunables_.has_boost) {
-            typename BoostT::SysEnv boost_env;
-            boost_env.soc    = &soc;
-            boost_env.little = &little_governor;
-            boost_env.big    = &big_governor;
-            boost_env.sched  = &sched;
-            boost            = BoostT(tunables_.boost, boost_env);
+        sched_cfg.tunables        = t.sched;
+        sched_cfg.little          = &soc->clusters_[soc->GetLittleClusterIdx()];
+        sched_cfg.big             = &soc->clusters_[soc->GetBigClusterIdx()];
+        sched_cfg.governor_little = little;
+        sched_cfg.governor_big    = big;
+        return sched_cfg;
+    }
+
+    // 每个线程复用仿真用的SOC副本，第@idx个副本恢复到@soc的状态后返回
+    // 只在第一次使用或者换了SOC模型时复制整个模型，之后的仿真不再有堆分配
+    static Soc &ScratchSoc(const Soc &soc, int idx) {
+        static thread_local std::vector<std::unique_ptr<Soc>> pool;
+        if ((int)pool.size() <= idx)
+            pool.resize(idx + 1);
+        auto &s = pool[idx];
+        if (!s || s->model_file_ != soc.model_file_)
+            s.reset(new Soc(soc));
+        else
+            s->ResetState(soc);
+        return *s;
+    }
+
+    template <typename TopoT>
+    void RunTopo(const Workload &workload, int seg_begin, int seg_end, const Workload *idleload, const Soc &soc,
+                 const State *from, State *to, SimResultPack *rp) const {
+        Stack st(tunables_, ScratchSoc(soc, 0));
+        if (from)
+            st.Restore(*from);
+        // 组合的场景依次仿真每一段，段之间状态连续
+        for (int i = seg_begin; i < seg_end; ++i) {
+            const Workload &part = *workload.GetSegment(i).work;
+            RunOnscreen<TopoT>(&st, part, 0, part.windowed_load_.size(), rp);
+        }
+        if (idleload)
+            RunOffscreen<TopoT>(&st, *idleload, rp);
+        if (to)
+            st.Save(to);
+    }
+
+    template <typename TopoT>
+    static void RunBatchTopo(const std::vector<Sim> &sims, const Workload &workload, const Workload &idleload,
+                             const Soc &soc, const std::vector<SimResultPack *> &rps, int tile_len) {
+        const int n_sim = sims.size();
+
+        // 每个线程复用状态的存储空间，Stack不能移动，在原地构造和析构
+        using StackStorage = typename std::aligned_storage<sizeof(Stack), alignof(Stack)>::type;
+        static thread_local std::vector<StackStorage> storage;
+        if ((int)storage.size() < n_sim)
+            storage.resize(n_sim);
+        Stack *states = reinterpret_cast<Stack *>(storage.data());
+        for (int k = 0; k < n_sim; ++k) {
+            new (&states[k]) Stack(sims[k].tunables_, ScratchSoc(soc, k));
+        }
+
+        for (int i = 0; i < workload.GetSegmentNum(); ++i) {
+            const Workload &part    = *workload.GetSegment(i).work;
+            const int       n_slice = part.windowed_load_.size();
+            for (int begin = 0; begin < n_slice; begin += tile_len) {
+                const int end = std::min(begin + tile_len, n_slice);
+                for (int k = 0; k < n_sim; ++k) {
+                    sims[k].template RunOnscreen<TopoT>(&states[k], part, begin, end, rps[k]);
+                }
+            }
+        }
+
+        // 灭屏负载较短，可以一直留在缓存中，不需要分块
+        for (int k = 0; k < n_sim; ++k) {
+            sims[k].template RunOffscreen<TopoT>(&states[k], idleload, rps[k]);
+            states[k].~Stack();
         }
+    }
 
-        int quantum_cnt = 0;
-        int capacity    = soc.clusters_[0].CalcCapacity();
+    // 亮屏考察[@begin, @end)每一时间片的性能输出和功耗
+    template <typename TopoT>
+    void RunOnscreen(Stack *st, const Workload &part, int begin, int end, SimResultPack *rp) const {
+        const int base_pwr     = misc_.working_base_mw * 100;
+        auto &    capacity_log = rp->onscreen.capacity;
+        auto &    power_log    = rp->onscreen.power;
+        auto &    sched        = st->sched;
+        auto &    boost        = st->boost;
+        int       capacity     = st->capacity;
+        int       quantum_cnt  = st->quantum_cnt;
 
-        // 亮屏考察每一时间片的性能输出和功耗
-        auto &capacity_log = rp->onscreen.capacity;
-        auto &power_log    = rp->onscreen.power;
-        for (Workload::LoadSlice w : workload.windowed_load_) {
+        for (int i = begin; i < end; ++i) {
+            Workload::LoadSlice w      = part.Unpack(part.windowed_load_[i]);
+            const int           demand = w.max_load;
             AdaptLoad(w.max_load, capacity);
-            AdaptLoad(w.load, workload.core_num_, capacity);
+            AdaptLoad(w.load, part.core_num_, capacity);
+            const int pwr = base_pwr + sched.template CalcPower<TopoT>(w.load);
             capacity_log.push_back(capacity);
-            power_log.push_back(base_pwr + sched.CalcPower(w.load));
+            power_log.push_back(pwr);
+            if (RecorderT::kEnabled)
+                recorder_.Record(Snapshot(st, quantum_cnt, 1, false, capacity, demand, pwr));
 
             boost.Tick(w.has_input_event, w.has_render, quantum_cnt);
-            capacity = sched.SchedulerTick(w.max_load, w.load, workload.core_num_, quantum_cnt);
+            capacity = sched.template SchedulerTick<TopoT>(w.max_load, w.load, part.core_num_, quantum_cnt);
             quantum_cnt++;
         }
 
-        // 灭屏只计算耗电总和，不考察是否卡顿
+        st->capacity    = capacity;
+        st->quantum_cnt = quantum_cnt;
+    }
+
+    // 灭屏只计算耗电总和，不考察是否卡顿
+    template <typename TopoT>
+    void RunOffscreen(Stack *st, const Workload &idleload, SimResultPack *rp) const {
+        const int idle_base_pwr = misc_.idle_base_mw * 100;
+        auto &    sched         = st->sched;
+        auto &    boost         = st->boost;
+        int       capacity      = st->capacity;
+        int       quantum_cnt   = st->quantum_cnt;
+
         rp->offscreen_pwr = idle_base_pwr * idleload.windowed_load_.size();
-        for (Workload::LoadSlice w : idleload.windowed_load_) {
+        const int n_idle  = idleload.windowed_load_.size();
+        for (int i = 0; i < n_idle;) {
+            Workload::LoadSlice w = idleload.Unpack(idleload.windowed_load_[i]);
+
+            // 没有输入升频，调速器和调度器都处于最低频率的不动点时，之后足够低的负载不会改变状态，
+            // 整段快进，这期间的耗电是常数
+            const int quiet_demand = boost.IsInBoost() ? -1 : sched.QuietDemand();
+            if (quiet_demand >= 0) {
+                const int n_quiet = idleload.GetQuietLen(i, idleload.DemandToPct(quiet_demand));
+                const int n_skip  = sched.FastForward(idleload, i, n_quiet);
+                if (n_skip > 0) {
+                    const int pwr = sched.template CalcPowerForIdle<TopoT>(w.load);
+                    if (RecorderT::kEnabled)
+                        recorder_.Record(Snapshot(st, quantum_cnt, n_skip, true, capacity, 0, idle_base_pwr + pwr));
+                    rp->offscreen_pwr += (uint64_t)n_skip * pwr;
+                    quantum_cnt += n_skip;
+                    i += n_skip;
+                    continue;
+                }
+            }
+
+            const int demand = w.max_load;
             AdaptLoad(w.max_load, capacity);
             AdaptLoad(w.load, idleload.core_num_, capacity);
-            rp->offscreen_pwr += sched.CalcPowerForIdle(w.load);
+            const int pwr = sched.template CalcPowerForIdle<TopoT>(w.load);
+            if (RecorderT::kEnabled)
+                recorder_.Record(Snapshot(st, quantum_cnt, 1, true, capacity, demand, idle_base_pwr + pwr));
+            rp->offscreen_pwr += pwr;
 
             boost.Tick(w.has_input_event, w.has_render, quantum_cnt);
-            capacity = sched.SchedulerTick(w.max_load, w.load, idleload.core_num_, quantum_cnt);
+            capacity = sched.template SchedulerTick<TopoT>(w.max_load, w.load, idleload.core_num_, quantum_cnt);
             quantum_cnt++;
+            ++i;
         }
 
-        return;
+        st->capacity    = capacity;
+        st->quantum_cnt = quantum_cnt;
+    }
+
+    // 记录用的当前状态，只在RecorderT::kEnabled时调用
+    TraceQuantum Snapshot(const Stack *st, int quantum, int n_quantum, bool offscreen, int capacity, int demand,
+                          int power) const {
+        TraceQuantum q;
+        q.quantum        = quantum;
+        q.n_quantum      = n_quantum;
+        q.offscreen      = offscreen;
+        q.little_opp     = st->soc.clusters_[st->soc.GetLittleClusterIdx()].GetCurOppIdx();
+        q.big_opp        = st->soc.clusters_[st->soc.GetBigClusterIdx()].GetCurOppIdx();
+        q.active_cluster = st->sched.GetActiveCluster();
+        q.in_boost       = st->boost.IsInBoost();
+        q.capacity       = capacity;
+        q.demand         = demand;
+        q.power          = power;
+        return q;
     }
 
-private:
     // 根据当前性能输出限幅输入的性能需求，不可能输入高于100%的负载
     void AdaptLoad(int &load, int capacity) const { load = std::min(load, capacity); }
     // 根据当前性能输出限幅输入的性能需求，不可能输入高于100%的负载
@@ -117,6 +366,7 @@ private:
 
     Tunables  tunables_;
     MiscConst misc_;
+    RecorderT recorder_;
 };
 
 #endif
@@ -5,7 +5,10 @@
 
 #include "json.hpp"
 
-Workload::Workload(const std::string &workload_file) {
+// 灭屏快进的索引粒度，整块满足时一次跳过
+const int kQuietBlock = 64;
+
+Workload::Workload(const std::string &workload_file) : workload_file_(workload_file) {
     std::ifstream ifs(workload_file);
     if (!ifs.good()) {
         using namespace std;
@@ -27,7 +30,7 @@ Workload::Workload(const std::string &workload_file) {
         src_.push_back(src_name);
     }
 
-    auto loadpct_to_demand = [=](int load) { return kWorkloadScaleFactor * freq_ * efficiency_ * load; };
+    demand_scale_ = kWorkloadScaleFactor * freq_ * efficiency_;
 
     if (j["renderLoad"].size() == 0) {
         using namespace std;
@@ -53,7 +56,7 @@ Workload::Workload(const std::string &workload_file) {
             right_q                    = std::min(end_q, next_win_q(right_q));
             idx_rec++;
         }
-        r.frame_load = loadpct_to_demand(render_demand[1]);
+        r.frame_load = PctToDemand(render_demand[1]);
 
         render_load_.push_back(r);
     }
@@ -72,20 +75,136 @@ Workload::Workload(const std::string &workload_file) {
         return false;
     };
 
+    auto to_pct = [&](int pct) {
+        if (pct < 0 || pct > 100) {
+            using namespace std;
+            cout << "windowedLoad out of range: " << workload_file << endl;
+            throw runtime_error("windowedLoad out of range");
+        }
+        return (uint8_t)pct;
+    };
+
     windowed_load_.reserve(j["windowedLoad"].size());
     for (const auto &slice : j["windowedLoad"]) {
-        LoadSlice l;
-        memset(&l, 0, sizeof(LoadSlice));
+        PackedSlice l;
+        memset(&l, 0, sizeof(PackedSlice));
 
-        l.max_load = loadpct_to_demand(slice[0]);
+        l.max_load = to_pct(slice[0]);
         for (int idx = 0; idx < core_num_; ++idx) {
-            l.load[idx] = loadpct_to_demand(slice[idx + 1]);
+            l.load[idx] = to_pct(slice[idx + 1]);
         }
-        // 按降序排列，对于骁龙82x这种2+2的平台只会使用前2个负载值
-        std::sort(&l.load[0], &l.load[3], std::greater<int>());
-        l.has_input_event = slice[core_num_ + 1];
+        // 按降序排列，对于骁龙82x这种2+2的平台只会使用前2个负载值，百分比和需求的顺序一致
+        std::sort(&l.load[0], &l.load[3], std::greater<uint8_t>());
+        l.has_input_event = (slice[core_num_ + 1].get<int>() != 0);
         l.has_render      = has_render(windowed_load_.size());
 
         windowed_load_.push_back(l);
     }
+
+    quiet_block_max_.assign(windowed_load_.size() / kQuietBlock, 0);
+    for (size_t i = 0; i < quiet_block_max_.size() * kQuietBlock; ++i) {
+        uint8_t &block_max = quiet_block_max_[i / kQuietBlock];
+        block_max          = std::max<int>(block_max, QuietLevel(windowed_load_[i]));
+    }
+}
+
+int Workload::GetQuietLen(int begin, int max_pct) const {
+    const int n = windowed_load_.size();
+    int       i = begin;
+    while (i < n) {
+        const int block = i / kQuietBlock;
+        if (i % kQuietBlock == 0 && block < (int)quiet_block_max_.size() && quiet_block_max_[block] <= max_pct) {
+            i += kQuietBlock;
+            continue;
+        }
+        if (QuietLevel(windowed_load_[i]) > max_pct)
+            break;
+        ++i;
+    }
+    return i - begin;
+}
+
+int Workload::DemandToPct(int demand) const {
+    int left  = -1;
+    int right = 100;
+    while (left < right) {
+        const int mid = (left + right + 1) / 2;
+        if (PctToDemand(mid) <= demand)
+            left = mid;
+        else
+            right = mid - 1;
+    }
+    return left;
+}
+
+Workload::Workload(const std::vector<std::shared_ptr<const Workload>> &parts, const std::vector<double> &weights)
+    : parts_(parts), part_weights_(weights) {
+    if (parts_.empty()) {
+        using namespace std;
+        cout << "Scenario is empty" << endl;
+        throw runtime_error("scenario is empty");
+    }
+
+    // 各个应用的负载采集条件相同，使用第一个的参数
+    const Workload &first = *parts_[0];
+    quantum_sec_          = first.quantum_sec_;
+    window_quantum_       = first.window_quantum_;
+    frame_quantum_        = first.frame_quantum_;
+    efficiency_           = first.efficiency_;
+    freq_                 = first.freq_;
+    load_scale_           = first.load_scale_;
+    core_num_             = first.core_num_;
+    demand_scale_         = first.demand_scale_;
+
+    int window_offset = 0;
+    int render_offset = 0;
+    for (const auto &part : parts_) {
+        src_.insert(src_.end(), part->src_.begin(), part->src_.end());
+        if (!workload_file_.empty())
+            workload_file_ += "+";
+        workload_file_ += part->workload_file_;
+
+        window_offsets_.push_back(window_offset);
+        render_offsets_.push_back(render_offset);
+        window_offset += part->windowed_load_.size();
+        render_offset += part->render_load_.size();
+    }
+}
+
+std::vector<Workload::Segment> Workload::GetSegments(void) const {
+    std::vector<Segment> segs;
+    for (int i = 0; i < GetSegmentNum(); ++i) {
+        segs.push_back(GetSegment(i));
+    }
+    return segs;
+}
+
+int Workload::GetWindowNum(void) const {
+    if (parts_.empty())
+        return windowed_load_.size();
+
+    int n = 0;
+    for (const auto &part : parts_)
+        n += part->windowed_load_.size();
+    return n;
+}
+
+std::vector<std::shared_ptr<const Workload>> LoadSrcWorkloads(const Workload &merged, std::vector<double> *weights) {
+    if (merged.IsComposite()) {
+        *weights = merged.GetPartWeights();
+        return merged.GetParts();
+    }
+
+    const auto        pos = merged.workload_file_.find_last_of('/');
+    const std::string dir = (pos == std::string::npos) ? "." : merged.workload_file_.substr(0, pos);
+
+    std::vector<std::shared_ptr<const Workload>> ret;
+    for (const auto &src : merged.src_) {
+        std::string name = src;
+        if (name.size() > 5 && name.compare(name.size() - 5, 5, ".html") == 0)
+            name.resize(name.size() - 5);
+        ret.push_back(std::make_shared<const Workload>(dir + "/" + name + ".json"));
+    }
+    weights->assign(ret.size(), 1.0);
+    return ret;
 }
@@ -3,11 +3,13 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
 class Workload {
 public:
+    // 仿真时使用的性能需求，由PackedSlice展开得到
     typedef struct _LoadSlice {
         int max_load;
         int load[4];
@@ -15,18 +17,66 @@ public:
         int has_render;
     } LoadSlice;
 
+    // 内存中保存的负载百分比，每个时间片6字节，整个亮屏序列可以放进L2缓存
+    typedef struct _PackedSlice {
+        uint8_t max_load;
+        uint8_t load[4];
+        uint8_t has_input_event : 1;
+        uint8_t has_render : 1;
+    } PackedSlice;
+    static_assert(sizeof(PackedSlice) == 6, "PackedSlice must stay 6 bytes");
+
     typedef struct _RenderSlice {
         int window_idxs[3];
         int window_quantums[3];
         int frame_load;
     } RenderSlice;
 
+    // 场景中的一段负载，引用共享的单个应用负载数据，不复制
+    typedef struct _Segment {
+        const Workload *work;
+        double          weight;         // 评分时这一段所在分区的权重
+        int             window_offset;  // 这一段在拼接后序列中的起始位置
+        int             render_offset;
+    } Segment;
+
     Workload(const std::string &workload_file);
+    // 按顺序拼接多个应用的负载组成场景，仿真时状态连续，评分时按@weights加权
+    Workload(const std::vector<std::shared_ptr<const Workload>> &parts, const std::vector<double> &weights);
+
+    // 单个文件的负载只有一段，权重为1
+    std::vector<Segment> GetSegments(void) const;
+    // 按序号访问每一段，不产生临时数组，用于仿真和评分
+    int                  GetSegmentNum(void) const { return parts_.empty() ? 1 : parts_.size(); }
+    Segment              GetSegment(int idx) const;
+    int                  GetWindowNum(void) const;
+    bool                 IsComposite(void) const { return !parts_.empty(); }
+    const std::vector<std::shared_ptr<const Workload>> &GetParts(void) const { return parts_; }
+    const std::vector<double> &                         GetPartWeights(void) const { return part_weights_; }
+
+    // 负载百分比转换为性能需求，在仿真循环中计算，不额外占用内存
+    int       PctToDemand(int pct) const { return demand_scale_ * pct; }
+    LoadSlice Unpack(const PackedSlice &p) const {
+        LoadSlice l;
+        l.max_load = PctToDemand(p.max_load);
+        for (int i = 0; i < 4; ++i) {
+            l.load[i] = PctToDemand(p.load[i]);
+        }
+        l.has_input_event = p.has_input_event;
+        l.has_render      = p.has_render;
+        return l;
+    }
+
+    // 从@begin开始连续的负载百分比不超过@max_pct并且没有输入和渲染的时间片数量
+    int GetQuietLen(int begin, int max_pct) const;
+    // 需求不超过@demand的最大负载百分比，没有则返回-1
+    int DemandToPct(int demand) const;
 
     const float              kWorkloadScaleFactor = 1.15;
-    std::vector<LoadSlice>   windowed_load_;
+    std::vector<PackedSlice> windowed_load_;
     std::vector<RenderSlice> render_load_;
     std::vector<std::string> src_;
+    std::string              workload_file_;
     float                    quantum_sec_;
     int                      window_quantum_;
     int                      frame_quantum_;
@@ -34,9 +84,28 @@ public:
     int                      freq_;
     int                      load_scale_;
     int                      core_num_;
+    float                    demand_scale_;
 
 private:
     Workload();
+
+    static int QuietLevel(const PackedSlice &s) { return (s.has_input_event || s.has_render) ? UINT8_MAX : s.max_load; }
+
+    std::vector<std::shared_ptr<const Workload>> parts_;
+    std::vector<double>                          part_weights_;
+    std::vector<int>                             window_offsets_;   // 每一段在拼接后序列中的起始位置
+    std::vector<int>                             render_offsets_;
+    std::vector<uint8_t>                         quiet_block_max_;  // 每kQuietBlock个时间片的QuietLevel最大值
 };
 
+inline Workload::Segment Workload::GetSegment(int idx) const {
+    if (parts_.empty())
+        return {this, 1.0, 0, 0};
+    return {parts_[idx].get(), part_weights_[idx], window_offsets_[idx], render_offsets_[idx]};
+}
+
+// 读取合并负载中每个应用单独的负载序列，与合并负载位于同一目录，文件名为src去掉.html
+// 组合的场景直接返回组成它的负载，@weights为各个应用的权重
+std::vector<std::shared_ptr<const Workload>> LoadSrcWorkloads(const Workload &merged, std::vector<double> *weights);
+
 #endif
\ No newline at end of file
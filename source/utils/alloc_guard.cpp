@@ -0,0 +1,126 @@
+#include "alloc_guard.h"
+
+#ifdef WIPE_ALLOC_GUARD
+
+#include <algorithm>
+#include <new>
+
+// 常量初始化的thread_local，operator new中访问不会触发再次分配
+static thread_local uint64_t thread_alloc_cnt   = 0;
+static thread_local int      thread_alloc_pause = 0;
+
+uint64_t ThreadAllocCount(void) {
+    return thread_alloc_cnt;
+}
+
+void PauseAllocCount(bool pause) {
+    thread_alloc_pause += pause ? 1 : -1;
+}
+
+static inline void *CountedAlloc(size_t size) {
+    if (thread_alloc_pause == 0)
+        ++thread_alloc_cnt;
+    return malloc(size ? size : 1);
+}
+
+// 替换标准库中所有可替换的分配函数，否则经由其他版本的分配不会被统计
+void *operator new(size_t size) {
+    void *p = CountedAlloc(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return CountedAlloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return CountedAlloc(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    free(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    free(p);
+}
+#endif
+
+#ifdef __cpp_aligned_new
+static inline void *CountedAlignedAlloc(size_t size, std::align_val_t align) {
+    if (thread_alloc_pause == 0)
+        ++thread_alloc_cnt;
+    void *p = nullptr;
+    if (posix_memalign(&p, std::max(sizeof(void *), (size_t)align), size ? size : 1) != 0)
+        return nullptr;
+    return p;
+}
+
+void *operator new(size_t size, std::align_val_t align) {
+    void *p = CountedAlignedAlloc(size, align);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size, std::align_val_t align) {
+    return operator new(size, align);
+}
+
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return CountedAlignedAlloc(size, align);
+}
+
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return CountedAlignedAlloc(size, align);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+    free(p);
+}
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef __ALLOC_GUARD_H
+#define __ALLOC_GUARD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// 调试用的堆分配检查，编译时定义WIPE_ALLOC_GUARD后替换全局operator new，统计每个线程的分配次数
+// 未定义时NoAllocScope不做任何事
+
+#ifdef WIPE_ALLOC_GUARD
+uint64_t ThreadAllocCount(void);
+void     PauseAllocCount(bool pause);
+#endif
+
+// 作用域内当前线程有堆分配时输出@what并终止
+class NoAllocScope {
+public:
+    // @enable为false时不检查，例如线程第一次评估时需要分配复用的缓冲区
+    NoAllocScope(const char *what, bool enable);
+    ~NoAllocScope();
+
+private:
+    const char *what_;
+    bool        enable_;
+    uint64_t    begin_;
+};
+
+// 作用域内当前线程的堆分配不计数，用于检查范围内无法避免的分配，例如创建线程
+class AllocAllowedScope {
+public:
+    AllocAllowedScope();
+    ~AllocAllowedScope();
+};
+
+#ifdef WIPE_ALLOC_GUARD
+inline NoAllocScope::NoAllocScope(const char *what, bool enable)
+    : what_(what), enable_(enable), begin_(ThreadAllocCount()) {}
+
+inline NoAllocScope::~NoAllocScope() {
+    const uint64_t n_alloc = ThreadAllocCount() - begin_;
+    if (enable_ && n_alloc != 0) {
+        fprintf(stderr, "WIPE-v2 alloc guard: %s allocated %llu times\n", what_, (unsigned long long)n_alloc);
+        abort();
+    }
+}
+
+inline AllocAllowedScope::AllocAllowedScope() {
+    PauseAllocCount(true);
+}
+
+inline AllocAllowedScope::~AllocAllowedScope() {
+    PauseAllocCount(false);
+}
+#else
+inline NoAllocScope::NoAllocScope(const char *what, bool enable) : what_(what), enable_(enable), begin_(0) {}
+
+inline NoAllocScope::~NoAllocScope() {}
+
+inline AllocAllowedScope::AllocAllowedScope() {}
+
+inline AllocAllowedScope::~AllocAllowedScope() {}
+#endif
+
+#endif
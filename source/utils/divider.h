@@ -0,0 +1,33 @@
+#ifndef __DIVIDER_H
+#define __DIVIDER_H
+
+#include <stdint.h>
+
+// 除数不变时用乘法和移位代替整数除法，被除数小于2^kBits时结果与整数除法相同
+// 取 l = ceil(log2(d))，m = ceil(2^(kBits+l) / d)，则 n / d = (n * m) >> (kBits+l)
+// T. Granlund, P. L. Montgomery, Division by Invariant Integers using Multiplication, 1994
+// kBits不超过31时乘积不超过64位，否则使用128位乘法
+template <int kBits>
+class Divider {
+public:
+    Divider() : magic_(1ULL << kBits), shift_(kBits) {}
+    explicit Divider(uint64_t divisor) {
+        int l = 0;
+        while ((1ULL << l) < divisor)
+            ++l;
+        shift_ = kBits + l;
+        magic_ = (((unsigned __int128)1 << shift_) + divisor - 1) / divisor;
+    }
+
+    uint64_t Div(uint64_t n) const {
+        if (kBits <= 31)
+            return (n * magic_) >> shift_;
+        return ((unsigned __int128)n * magic_) >> shift_;
+    }
+
+private:
+    uint64_t magic_;
+    int      shift_;
+};
+
+#endif
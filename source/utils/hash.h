@@ -0,0 +1,21 @@
+#ifndef __HASH_H
+#define __HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+const uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+const uint64_t kFnvPrime  = 0x100000001b3ULL;
+
+// 64位FNV-1a，用于计算缓存的上下文、参数的键和仿真状态的哈希
+inline uint64_t HashBytes(const void *data, size_t len, uint64_t seed = kFnvOffset) {
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    uint64_t       h = seed;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= kFnvPrime;
+    }
+    return h;
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef __PARALLEL_H
+#define __PARALLEL_H
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 使用n_threads个线程执行fn(0) ~ fn(n - 1)，任务按序号动态分配，调用者线程也参与执行
+inline void ParallelFor(int n, int n_threads, const std::function<void(int)> &fn) {
+    std::atomic<int> next_idx(0);
+
+    auto worker = [&]() {
+        for (int i = next_idx++; i < n; i = next_idx++) {
+            fn(i);
+        }
+    };
+
+    n_threads = std::max(1, std::min(n_threads, n));
+    std::vector<std::thread> thread_pool;
+    thread_pool.reserve(n_threads - 1);
+    for (int i = 1; i < n_threads; ++i) {
+        thread_pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &th : thread_pool) {
+        th.join();
+    }
+}
+
+// 常驻的工作线程，每次分配任务不创建线程，也没有堆分配
+// 同一时间只能有一个调用者使用，Start之后必须Wait
+class WorkerPool {
+public:
+    explicit WorkerPool(int n_threads)
+        : call_(nullptr), fn_(nullptr), n_task_(0), next_idx_(0), n_busy_(0), round_(0), stop_(false) {
+        threads_.reserve(n_threads);
+        for (int i = 0; i < n_threads; ++i) {
+            threads_.emplace_back(&WorkerPool::Worker, this, i);
+        }
+    }
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_cv_.notify_all();
+        for (auto &th : threads_) {
+            th.join();
+        }
+    }
+
+    // 工作线程执行fn(0, worker) ~ fn(n - 1, worker)，worker为工作线程的序号，任务按序号动态分配
+    // 调用者线程不参与执行，可以同时做别的事，@fn在Wait返回之前必须有效
+    template <typename F>
+    void Start(int n, const F &fn) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            call_   = &Call<F>;
+            fn_     = &fn;
+            n_task_ = n;
+            n_busy_ = threads_.size();
+            next_idx_.store(0);
+            ++round_;
+        }
+        start_cv_.notify_all();
+    }
+
+    void Wait(void) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]() { return n_busy_ == 0; });
+    }
+
+    template <typename F>
+    void Run(int n, const F &fn) {
+        Start(n, fn);
+        Wait();
+    }
+
+    int GetThreadNum(void) const { return threads_.size(); }
+
+private:
+    template <typename F>
+    static void Call(const void *fn, int idx, int worker) {
+        (*static_cast<const F *>(fn))(idx, worker);
+    }
+
+    void Worker(int worker) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_cv_.wait(lock, [&]() { return stop_ || round_ != seen; });
+                if (stop_)
+                    return;
+                seen = round_;
+            }
+            for (int i = next_idx_++; i < n_task_; i = next_idx_++) {
+                call_(fn_, i, worker);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--n_busy_ == 0)
+                    done_cv_.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::mutex               mutex_;
+    std::condition_variable  start_cv_;
+    std::condition_variable  done_cv_;
+    void (*call_)(const void *, int, int);
+    const void *     fn_;
+    int              n_task_;
+    std::atomic<int> next_idx_;
+    int              n_busy_;
+    uint64_t         round_;
+    bool             stop_;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef __VARINT_H
+#define __VARINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// zigzag变长编码，绝对值小的负数也只占一个字节，用于记录文件中相邻数值的差
+inline size_t PutVarint(char *p, int64_t v) {
+    uint64_t u   = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+    size_t   len = 0;
+    while (u >= 0x80) {
+        p[len++] = (char)(u | 0x80);
+        u >>= 7;
+    }
+    p[len++] = (char)u;
+    return len;
+}
+
+inline void PutVarint(std::vector<char> *buf, int64_t v) {
+    char   tmp[10];
+    size_t len = PutVarint(tmp, v);
+    buf->insert(buf->end(), tmp, tmp + len);
+}
+
+// 从@data的*@pos位置读出一个数，数据不完整时返回false
+inline bool GetVarint(const std::vector<char> &data, size_t *pos, int64_t *v) {
+    uint64_t u     = 0;
+    int      shift = 0;
+    while (*pos < data.size() && shift < 64) {
+        uint8_t b = data[(*pos)++];
+        u |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "alloc_guard.h"
+#include "cpumodel.h"
+#include "json.hpp"
+#include "openga_helper.h"
+#include "workload.h"
+
+// 堆分配检查，由make check以WIPE_ALLOC_GUARD单独编译，在仓库根目录下运行
+// 每种调度器各用一个SOC，预热一次EvalTunables -> Sim::Run -> Rank::Eval，再评估一次时当前线程不应有堆分配
+// 用法：./build/check/alloc_check [walt_soc_model] [pelt_soc_model]
+
+template <typename SimType>
+bool CheckEval(Soc *soc, const Workload &work, const Workload &idle) {
+    using namespace std;
+    using Adapter = OpengaAdapter<SimType>;
+
+    Adapter                      adapter(soc, &work, &idle, "./conf.json");
+    typename Adapter::MiddleCost cost;
+    const auto                   t = adapter.GenerateDefaultTunables();
+
+    adapter.EvalSingle(t, cost);
+    const uint64_t begin = ThreadAllocCount();
+    adapter.EvalSingle(t, cost);
+    const uint64_t n_alloc = ThreadAllocCount() - begin;
+
+    if (n_alloc != 0) {
+        cout << "alloc check FAILED: " << soc->name_ << " allocated " << n_alloc << " times after warm-up" << endl;
+        return false;
+    }
+    cout << "alloc check passed: " << soc->name_ << endl;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    nlohmann::json j;
+    {
+        std::ifstream ifs("./conf.json");
+        if (!ifs.good()) {
+            using namespace std;
+            cout << "WIPE-v2 config file access ERROR: "
+                 << "./conf.json" << endl;
+            throw std::runtime_error("file access error");
+        }
+        ifs >> j;
+    }
+
+    const std::string walt_model = (argc > 1) ? argv[1] : "./dataset/soc_model/model_sdm660.json";
+    const std::string pelt_model = (argc > 2) ? argv[2] : "./dataset/soc_model/model_e8890.json";
+
+    Workload work(j["mergedWorkload"]);
+    Workload idle(j["idleWorkload"]);
+
+    bool pass = true;
+    {
+        Soc soc(walt_model);
+        pass &= CheckEval<SimQcomBL>(&soc, work, idle);
+    }
+    {
+        Soc soc(pelt_model);
+        pass &= CheckEval<SimBL>(&soc, work, idle);
+    }
+    return pass ? 0 : 1;
+}